@@ -0,0 +1,224 @@
+// Throughput benchmark endpoints for WiCap web server
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Synthetic data is generated on the fly, so the measurements reflect the
+// network stack and WiFi link, not the capture hardware. Data is written
+// directly into the connection send buffer, as with the Mongoose file server
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mongoose.h"
+#include "mg_wifi.h"
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "bench.h"
+#include "metrics.h"
+
+#define BENCH_HEADERS   "Cache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\n"
+
+uint8_t bench_block[BENCH_CHUNKLEN];
+
+bool bench_request(struct mg_connection *c, struct mg_http_message *hm);
+bool bench_upload_start(struct mg_connection *c, struct mg_http_message *hm);
+void bench_upload_data(struct mg_connection *c);
+void bench_send(struct mg_connection *c);
+
+// Handle benchmark connection event, return non-zero if event consumed
+bool bench_event(struct mg_connection *c, int ev, void *ev_data)
+{
+    BENCH_CONN *bcp = (BENCH_CONN *)c->data;
+    struct mg_http_message *hm = (struct mg_http_message *)ev_data;
+
+    if (ev == MG_EV_HTTP_MSG && mg_match(hm->uri, mg_str(BENCH_URIS), NULL))
+        return (bench_request(c, hm));
+    else if (ev == MG_EV_HTTP_HDRS && bcp->type == BENCH_NONE &&
+             mg_match(hm->uri, mg_str(BENCH_SINK), NULL))
+        return (bench_upload_start(c, hm));
+    else if (ev == MG_EV_READ && bcp->type == BENCH_UPLOAD)
+    {
+        bench_upload_data(c);
+        return (true);
+    }
+    else if ((ev == MG_EV_POLL || ev == MG_EV_WRITE) &&
+             bcp->type != BENCH_NONE && bcp->type != BENCH_UPLOAD)
+        bench_send(c);
+    return (false);
+}
+
+// Start a benchmark transfer, given HTTP request
+bool bench_request(struct mg_connection *c, struct mg_http_message *hm)
+{
+    BENCH_CONN *bcp = (BENCH_CONN *)c->data;
+    uint32_t len = BENCH_DEFAULT_LEN;
+    char s[16];
+
+    if (mg_http_get_var(&hm->query, "size", s, sizeof(s)) > 0)
+        len = MIN(strtoul(s, NULL, 10), BENCH_MAX_LEN);
+    memset(bcp, 0, sizeof(BENCH_CONN));
+    bcp->len = len;
+    bcp->start = mg_millis();
+    if (mg_match(hm->uri, mg_str(BENCH_DATA_BIN), NULL))
+    {
+        bcp->type = BENCH_BIN;
+        mg_printf(c, "HTTP/1.1 200 OK\r\n" BENCH_HEADERS 
+            "Content-Type: application/octet-stream\r\nContent-Length: %u\r\n\r\n", len);
+    }
+    else if (mg_match(hm->uri, mg_str(BENCH_DATA_TXT), NULL))
+    {
+        bcp->type = BENCH_TXT;
+        mg_printf(c, "HTTP/1.1 200 OK\r\n" BENCH_HEADERS 
+            "Content-Type: text/plain\r\nContent-Length: %u\r\n\r\n", bin_base64len(len));
+    }
+    else if (mg_match(hm->uri, mg_str(BENCH_CHUNKED), NULL))
+    {
+        bcp->type = BENCH_CHUNK;
+        mg_printf(c, "HTTP/1.1 200 OK\r\n" BENCH_HEADERS 
+            "Content-Type: application/octet-stream\r\nTransfer-Encoding: chunked\r\n\r\n");
+        if (len == 0)
+            mg_http_write_chunk(c, "", 0);
+    }
+    else if (mg_match(hm->uri, mg_str(BENCH_SINK), NULL))
+    {
+        mg_http_reply(c, 200, BENCH_HEADERS, "{\"bytes\":%u,\"msec\":0}\n", (uint)hm->body.len);
+        return (true);
+    }
+    else if (mg_match(hm->uri, mg_str(BENCH_ECHO), NULL))
+    {
+        struct mg_str *sp = hm->body.len ? &hm->body : &hm->query;
+        mg_http_reply(c, 200, BENCH_HEADERS, "%.*s", (int)sp->len, sp->buf);
+        return (true);
+    }
+    else
+    {
+        mg_http_reply(c, 404, "", "Not Found\n");
+        return (true);
+    }
+    bench_send(c);
+    return (true);
+}
+
+// Fill buffer with synthetic data, given starting offset
+void bench_fill(uint8_t *buf, uint32_t oset, int len)
+{
+    while (len--)
+    {
+        *buf++ = BENCH_DATA(oset);
+        oset++;
+    }
+}
+
+// Top up the send buffer with benchmark data, report speed when complete
+void bench_send(struct mg_connection *c)
+{
+    BENCH_CONN *bcp = (BENCH_CONN *)c->data;
+    uint32_t n, space;
+
+    if (c->send.size < MG_IO_SIZE)
+        mg_iobuf_resize(&c->send, MG_IO_SIZE);
+    space = c->send.size > c->send.len ? c->send.size - c->send.len : 0;
+    if (bcp->type == BENCH_BIN && bcp->oset < bcp->len)
+    {
+        n = MIN(space, bcp->len - bcp->oset);
+        bench_fill(c->send.buf + c->send.len, bcp->oset, n);
+        c->send.len += n;
+        bcp->oset += n;
+        METRIC_ADD(METRIC_BYTES_BENCH, n);
+    }
+    while (bcp->type == BENCH_TXT && bcp->oset < bcp->len &&
+           space >= (BENCH_B64_BINLEN * 4) / 3)
+    {
+        n = MIN(BENCH_B64_BINLEN, bcp->len - bcp->oset);
+        bench_fill(bench_block, bcp->oset, n);
+        n = base64_enc(bench_block, n, c->send.buf + c->send.len);
+        c->send.len += n;
+        space -= n;
+        METRIC_ADD(METRIC_BYTES_BENCH, n);
+        bcp->oset += BENCH_B64_BINLEN;
+    }
+    while (bcp->type == BENCH_CHUNK && bcp->oset < bcp->len && 
+           space >= BENCH_CHUNKLEN + 16)
+    {
+        n = MIN(BENCH_CHUNKLEN, bcp->len - bcp->oset);
+        bench_fill(bench_block, bcp->oset, n);
+        mg_http_write_chunk(c, (char *)bench_block, n);
+        METRIC_ADD(METRIC_BYTES_BENCH, n);
+        space -= MIN(space, n + 16);
+        bcp->oset += n;
+        if (bcp->oset >= bcp->len)
+            mg_http_write_chunk(c, "", 0);
+    }
+    if (bcp->oset >= bcp->len && c->send.len == 0)
+    {
+        uint32_t dt = mg_millis() - bcp->start;
+        uint32_t speed = dt ? (uint32_t)(((uint64_t)bcp->len * 1000) / dt) : 0;
+        xprintf("Bench %u bytes, %u msec, %u bytes/sec\n", bcp->len, dt, speed);
+        set_param_int(ARG_SPEED, speed);
+        bcp->type = BENCH_NONE;
+        c->is_resp = 0;
+    }
+}
+
+// Start streaming upload if body isn't buffered, return non-zero if started
+// The HTTP protocol handler is disabled, so the body can be discarded as it
+// arrives, instead of being buffered
+bool bench_upload_start(struct mg_connection *c, struct mg_http_message *hm)
+{
+    BENCH_CONN *bcp = (BENCH_CONN *)c->data;
+    uint32_t hdrlen = (uint32_t)(hm->body.buf - hm->message.buf);
+    uint32_t avail = c->recv.len - (uint32_t)(hm->body.buf - (char *)c->recv.buf);
+
+    if (!mg_http_get_header(hm, "Content-Length") || hm->body.len <= avail)
+        return (false);
+    memset(bcp, 0, sizeof(BENCH_CONN));
+    bcp->type = BENCH_UPLOAD;
+    bcp->hdrlen = hdrlen;
+    bcp->len = hm->body.len;
+    bcp->start = mg_millis();
+    bcp->pfn = c->pfn;
+    c->pfn = NULL;
+    return (true);
+}
+
+// Discard upload data, send reply when complete
+void bench_upload_data(struct mg_connection *c)
+{
+    BENCH_CONN *bcp = (BENCH_CONN *)c->data;
+    uint32_t skip = MIN(bcp->hdrlen, c->recv.len);
+    uint32_t n = MIN(c->recv.len - skip, bcp->len - bcp->oset);
+
+    mg_iobuf_del(&c->recv, 0, skip + n);
+    bcp->hdrlen -= skip;
+    bcp->oset += n;
+    if (bcp->oset >= bcp->len)
+    {
+        uint32_t dt = mg_millis() - bcp->start;
+        xprintf("Bench upload %u bytes, %u msec\n", bcp->len, dt);
+        mg_http_reply(c, 200, BENCH_HEADERS, "{\"bytes\":%u,\"msec\":%u}\n", bcp->len, dt);
+        c->pfn = bcp->pfn;
+        bcp->type = BENCH_NONE;
+    }
+}
+
+// EOF
@@ -0,0 +1,52 @@
+// Throughput benchmark endpoints for WiCap web server
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BENCH_URIS          "/bench/*"          // Benchmark endpoints
+#define BENCH_DATA_BIN      "/bench/data.bin"   // Binary data
+#define BENCH_DATA_TXT      "/bench/data.txt"   // Base64 data
+#define BENCH_CHUNKED       "/bench/chunked"    // Binary data, chunked encoding
+#define BENCH_SINK          "/bench/sink"       // Upload (POST) data sink
+#define BENCH_ECHO          "/bench/echo"       // Latency probe
+#define BENCH_DEFAULT_LEN   1000000     // Default data length
+#define BENCH_MAX_LEN       4000000     // Max data length
+#define BENCH_CHUNKLEN      1024        // Size of chunks in chunked encoding
+#define BENCH_B64_BINLEN    768         // Binary block size for base64 encoding
+
+// Synthetic data byte, given offset
+#define BENCH_DATA(n)       ((uint8_t)((n) * 7 + ((n) >> 8)))
+
+// Type of benchmark transfer
+typedef enum { BENCH_NONE, BENCH_BIN, BENCH_TXT, BENCH_CHUNK, BENCH_UPLOAD } BENCH_TYPE;
+
+// Benchmark state, in connection data area
+typedef struct {
+    uint8_t type;               // BENCH_TYPE
+    uint16_t hdrlen;            // Upload header length, to be discarded
+    uint32_t oset, len;         // Data offset and length
+    uint32_t start;             // Start time (msec)
+    mg_event_handler_t pfn;     // Protocol handler, saved during upload
+} BENCH_CONN;
+
+bool bench_event(struct mg_connection *c, int ev, void *ev_data);
+void bench_fill(uint8_t *buf, uint32_t oset, int len);
+
+// EOF
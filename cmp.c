@@ -0,0 +1,263 @@
+// Delta & Rice compression of captured samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The analog samples change slowly compared with their range, so each is
+// sent as the difference from the previous sample, mapped to a positive
+// number (zigzag) and Rice-coded: a unary quotient, then k remainder bits.
+// Each block of samples has a 4-bit k value, chosen from the mean difference,
+// and a flag if any digital bits change in the block; if so, each sample has
+// a 1-bit change flag, followed by the new digital bits if changed. 
+// Filtered captures are 16-bit values with no digital bits, so in wide mode
+// (CMP_WIDE header flag) the difference is taken on the whole word, with a
+// 17-bit escape value. If the coding would make the data bigger than the
+// 16-bit samples (e.g. noise), they are sent uncoded instead (CMP_RAW flag).
+// Bits are packed LS bit first, the file ends with a partial byte if needed.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "cmp.h"
+
+// Add bits to accumulator, output whole bytes (if buffer non-null)
+static inline int cmp_put(CMP_ENC *ep, uint8_t *out, int n, uint32_t val, int nbits)
+{
+    ep->acc |= val << ep->nbits;
+    ep->nbits += nbits;
+    while (ep->nbits >= 8)
+    {
+        if (out)
+            out[n] = (uint8_t)ep->acc;
+        n++;
+        ep->acc >>= 8;
+        ep->nbits -= 8;
+    }
+    return (n);
+}
+
+// Encode next block of samples, return number of bytes output
+static int cmp_block(CMP_ENC *ep, uint8_t *out)
+{
+    int nsamp = MIN(CMP_BLOCK, ep->nsamp - ep->inpos), n = 0, k = 0;
+    bool wide = ep->flags & CMP_WIDE;
+    int amask = wide ? 0xffff : ANALOG_MASK, kmax = wide ? CMP_WIDE_KMAX : CMP_KMAX;
+    int zbits = wide ? CMP_WIDE_ZBITS : CMP_ZBITS;
+    WORD *sp = &ep->samps[ep->inpos], prev = ep->prev, dchange = 0;
+    uint32_t sum = 0;
+
+    if (ep->flags & CMP_RAW)
+    {
+        for (int i = 0; i < nsamp; i++)
+            n = cmp_put(ep, out, n, sp[i], 16);
+        ep->inpos += nsamp;
+        return (n);
+    }
+    for (int i = 0; i < nsamp; i++)
+    {
+        int d = (int)(sp[i] & amask) - (int)(prev & amask);
+        sum += (uint32_t)((d << 1) ^ (d >> 31));
+        dchange |= (sp[i] ^ prev) & ~amask;
+        prev = sp[i];
+    }
+    while (k < kmax && (uint32_t)(nsamp << (k + 1)) <= sum)
+        k++;
+    n = cmp_put(ep, out, n, k | (dchange ? 1 << CMP_KBITS : 0), CMP_KBITS + 1);
+    prev = ep->prev;
+    for (int i = 0; i < nsamp; i++)
+    {
+        int d = (int)(sp[i] & amask) - (int)(prev & amask);
+        uint32_t zz = (uint32_t)((d << 1) ^ (d >> 31)), q = zz >> k;
+        if (dchange)
+        {
+            bool changed = ((sp[i] ^ prev) & ~amask) != 0;
+            n = cmp_put(ep, out, n, changed, 1);
+            if (changed)
+                n = cmp_put(ep, out, n, sp[i] >> ANALOG_BITS, CMP_DBITS);
+        }
+        if (q < CMP_QMAX)
+        {
+            n = cmp_put(ep, out, n, (1 << q) - 1, q + 1);
+            n = cmp_put(ep, out, n, zz & ((1 << k) - 1), k);
+        }
+        else
+        {
+            n = cmp_put(ep, out, n, (1 << CMP_QMAX) - 1, CMP_QMAX);
+            n = cmp_put(ep, out, n, zz, zbits);
+        }
+        prev = sp[i];
+    }
+    ep->prev = prev;
+    ep->inpos += nsamp;
+    return (n);
+}
+
+// Initialise encoder, with header in output buffer
+void cmp_init(CMP_ENC *ep, WORD *samps, int nsamp, int flags)
+{
+    CMP_HDR hdr = {.magic=CMP_MAGIC, .version=CMP_VERSION, .block=CMP_BLOCK, .flags=flags,
+        .nsamp=nsamp};
+
+    memset(ep, 0, sizeof(CMP_ENC));
+    ep->samps = samps;
+    ep->nsamp = nsamp;
+    ep->flags = flags;
+    ep->prev = flags & CMP_WIDE ? CMP_WIDE_ZERO : ANALOG_ZERO;
+    memcpy(ep->buff, &hdr, sizeof(hdr));
+    ep->outlen = sizeof(hdr);
+}
+
+// Read next block of compressed data, return byte count, 0 at end
+int cmp_read(CMP_ENC *ep, void *buf, int maxlen)
+{
+    uint8_t *out = buf;
+    int n = 0, len;
+
+    while (n < maxlen)
+    {
+        if (ep->outpos >= ep->outlen)
+        {
+            if (ep->inpos < ep->nsamp)
+                ep->outlen = cmp_block(ep, ep->buff);
+            else if (ep->nbits)
+            {
+                ep->buff[0] = (uint8_t)ep->acc;
+                ep->acc = ep->nbits = 0;
+                ep->outlen = 1;
+            }
+            else
+                break;
+            ep->outpos = 0;
+        }
+        len = MIN(maxlen - n, ep->outlen - ep->outpos);
+        memcpy(&out[n], &ep->buff[ep->outpos], len);
+        ep->outpos += len;
+        n += len;
+    }
+    return (n);
+}
+
+// Return size of compressed data, without storing it
+int cmp_size(WORD *samps, int nsamp, int flags)
+{
+    CMP_ENC enc;
+    int n = sizeof(CMP_HDR);
+
+    if (flags & CMP_RAW)
+        return (n + nsamp * (int)sizeof(WORD));
+    cmp_init(&enc, samps, nsamp, flags);
+    while (enc.inpos < enc.nsamp)
+        n += cmp_block(&enc, NULL);
+    return (n + (enc.nbits ? 1 : 0));
+}
+
+// Return coding mode, given CMP_WIDE if the samples are 16-bit values
+// Changed to CMP_RAW if coding would make the data bigger
+int cmp_mode(WORD *samps, int nsamp, int flags)
+{
+    return (cmp_size(samps, nsamp, flags) > cmp_size(samps, nsamp, CMP_RAW) ? CMP_RAW : flags);
+}
+
+// Bit reader for decoder
+typedef struct {
+    uint8_t *data;
+    int pos, len;
+    uint32_t acc, nbits;
+    bool err;
+} CMP_BITS;
+
+// Get bits from input, set error flag if none left
+static inline uint32_t cmp_get(CMP_BITS *bp, int nbits)
+{
+    uint32_t val;
+
+    while (bp->nbits < (uint32_t)nbits)
+    {
+        if (bp->pos >= bp->len)
+        {
+            bp->err = true;
+            return (0);
+        }
+        bp->acc |= (uint32_t)bp->data[bp->pos++] << bp->nbits;
+        bp->nbits += 8;
+    }
+    val = bp->acc & ((1 << nbits) - 1);
+    bp->acc >>= nbits;
+    bp->nbits -= nbits;
+    return (val);
+}
+
+// Decode compressed data, return number of samples, -1 if error
+int cmp_decode(void *inp, int inlen, WORD *outp, int maxsamp)
+{
+    CMP_HDR hdr;
+    CMP_BITS bits = {.data=(uint8_t *)inp + sizeof(hdr), .len=inlen - (int)sizeof(hdr)};
+    WORD prev;
+    int nsamp, i = 0, amask, kmax, zbits;
+    bool wide;
+
+    if (inlen < (int)sizeof(hdr))
+        return (-1);
+    memcpy(&hdr, inp, sizeof(hdr));
+    if (memcmp(hdr.magic, CMP_MAGIC, sizeof(hdr.magic)) || hdr.version != CMP_VERSION || 
+        hdr.block == 0 || hdr.flags > (CMP_WIDE | CMP_RAW))
+        return (-1);
+    nsamp = MIN((int)hdr.nsamp, maxsamp);
+    if (hdr.flags & CMP_RAW)
+    {
+        while (i < nsamp && !bits.err)
+            outp[i++] = (WORD)cmp_get(&bits, 16);
+        return (bits.err ? -1 : nsamp);
+    }
+    wide = hdr.flags & CMP_WIDE;
+    amask = wide ? 0xffff : ANALOG_MASK;
+    kmax = wide ? CMP_WIDE_KMAX : CMP_KMAX;
+    zbits = wide ? CMP_WIDE_ZBITS : CMP_ZBITS;
+    prev = wide ? CMP_WIDE_ZERO : ANALOG_ZERO;
+    while (i < nsamp && !bits.err)
+    {
+        int n = MIN(hdr.block, nsamp - i);
+        uint32_t v = cmp_get(&bits, CMP_KBITS + 1), k = v & ((1 << CMP_KBITS) - 1);
+        bool dchange = v >> CMP_KBITS;
+        if (k > (uint32_t)kmax || (wide && dchange))
+            return (-1);
+        while (n-- > 0 && !bits.err)
+        {
+            uint32_t q = 0, zz, dig = prev & ~amask;
+            int a;
+            if (dchange && cmp_get(&bits, 1))
+                dig = cmp_get(&bits, CMP_DBITS) << ANALOG_BITS;
+            while (q < CMP_QMAX && cmp_get(&bits, 1) && !bits.err)
+                q++;
+            zz = q < CMP_QMAX ? (q << k) | cmp_get(&bits, k) : cmp_get(&bits, zbits);
+            a = (int)(prev & amask) + (int)((zz >> 1) ^ -(zz & 1));
+            if (a < 0 || a > amask)
+                return (-1);
+            outp[i++] = prev = (WORD)(dig | a);
+        }
+    }
+    return (bits.err ? -1 : nsamp);
+}
+
+// EOF
@@ -0,0 +1,66 @@
+// Delta & Rice compression of captured samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define CMP_MAGIC       "WCMP"      // Compressed file marker & version
+#define CMP_VERSION     2
+#define CMP_BLOCK       32          // Samples per block, with own Rice parameter
+#define CMP_KBITS       4           // Bits in Rice parameter
+#define CMP_KMAX        (ANALOG_BITS)
+#define CMP_QMAX        16          // Max unary quotient, then escape to raw
+#define CMP_ZBITS       (ANALOG_BITS + 1)   // Bits in zigzag difference
+#define CMP_DBITS       (16 - ANALOG_BITS)  // Bits in digital value
+#define CMP_WIDE_KMAX   ((1 << CMP_KBITS) - 1)  // Wide mode: max Rice parameter,
+#define CMP_WIDE_ZBITS  17                      // bits in zigzag difference,
+#define CMP_WIDE_ZERO   0x8000                  // and initial value
+// Header flags: samples are 16-bit values (e.g. filtered), or not coded
+#define CMP_WIDE        1
+#define CMP_RAW         2
+// Max bytes in one encoded block (wide & raw blocks are smaller)
+#define CMP_BLOCK_MAXBYTES  ((CMP_KBITS + 1 + CMP_BLOCK * \
+                             (CMP_QMAX + CMP_ZBITS + 1 + CMP_DBITS) + 7) / 8 + 4)
+
+// Compressed file header, 12 bytes
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version;
+    uint8_t block, flags;
+    uint32_t nsamp;
+} CMP_HDR;
+
+// Encoder state
+typedef struct {
+    WORD *samps;                    // Sample data
+    int nsamp, inpos;               // Number of samples, next sample to encode
+    int flags;                      // Coding mode
+    uint32_t acc, nbits;            // Bit accumulator
+    WORD prev;                      // Previous sample value
+    int outpos, outlen;             // Output bytes in buffer
+    uint8_t buff[CMP_BLOCK_MAXBYTES];
+} CMP_ENC;
+
+void cmp_init(CMP_ENC *ep, WORD *samps, int nsamp, int flags);
+int cmp_read(CMP_ENC *ep, void *buf, int maxlen);
+int cmp_size(WORD *samps, int nsamp, int flags);
+int cmp_mode(WORD *samps, int nsamp, int flags);
+int cmp_decode(void *inp, int inlen, WORD *outp, int maxsamp);
+
+// EOF
@@ -0,0 +1,360 @@
+// Protocol decoders for UART, SPI and I2C logic captures
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The decoders are state machines, that are fed with blocks of samples, so
+// they can be used on a complete capture, or a stream of samples. Completed
+// frames are passed to a handler function. Each new sample is XORed with the
+// previous one, so most samples (with no change on the relevant pins) are
+// skipped with one test. Long transfers are split into several frames of
+// up to DECODE_MAXBYTES, the sample number shows the start of each frame,
+// and frames after the first are flagged as continuations.
+// UART: 8 data bits, no parity, 1 stop bit, idle high. Bytes are grouped
+//       into one frame if the gap between them is less than 2 bit-times.
+// SPI:  MSB first. If the CS pin is set, a frame is a complete transfer,
+//       otherwise each byte is a separate frame.
+// I2C:  a frame is from start to stop (or repeated start), and the first
+//       byte is the address & read/write bit.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "decode.h"
+
+#define BIT(d, pin)     (((d) >> (pin)) & 1)
+
+enum { UART_IDLE, UART_DATA, UART_SYNC };
+
+const char *proto_names[NUM_PROTOS] = { PROTO_NAMES };
+DECODE_FRAME decode_frames[DECODE_MAXFRAMES];
+int decode_nframes;
+
+void decode_uart(DECODER *dp, WORD *samps, int n);
+void decode_spi(DECODER *dp, WORD *samps, int n);
+void decode_i2c(DECODER *dp, WORD *samps, int n);
+
+// Return true if the configuration has a protocol, and its pins are valid
+// (the SPI chip select is optional)
+bool decode_cfg_valid(DECODE_CFG *cfgp)
+{
+    bool pin0_ok = cfgp->pin0 >= 0 && cfgp->pin0 < DECODE_NPINS;
+    bool pin1_ok = cfgp->pin1 >= 0 && cfgp->pin1 < DECODE_NPINS;
+    bool pin2_ok = (cfgp->pin2 >= 0 && cfgp->pin2 < DECODE_NPINS) || cfgp->pin2 == DECODE_NOPIN;
+
+    return (cfgp->proto == PROTO_UART ? pin0_ok :
+            cfgp->proto == PROTO_SPI  ? pin0_ok && pin1_ok && pin2_ok :
+            cfgp->proto == PROTO_I2C  ? pin0_ok && pin1_ok : false);
+}
+
+// Initialise a decoder; if the configuration isn't valid, it does nothing
+void decode_init(DECODER *dp, DECODE_CFG *cfgp, DECODE_HANDLER handler)
+{
+    memset(dp, 0, sizeof(DECODER));
+    dp->cfg = *cfgp;
+    if (!decode_cfg_valid(cfgp))
+        dp->cfg.proto = PROTO_NONE;
+    dp->handler = handler;
+    dp->prev = 0xffff;
+    if (cfgp->proto == PROTO_UART && cfgp->baud > 0)
+        dp->bitlen = (uint32_t)(((uint64_t)cfgp->rate << 8) / cfgp->baud);
+}
+
+// Start a new frame, given sample number
+static void frame_start(DECODER *dp, uint32_t sample)
+{
+    dp->frame.sample = sample;
+    dp->frame.proto = dp->cfg.proto;
+    dp->frame.chan = dp->cfg.pin0;
+    dp->frame.nbytes = 0;
+    dp->frame.errs = dp->cont ? DECODE_FLAG_CONT : 0;
+    memset(dp->frame.data, 0, sizeof(dp->frame.data));
+}
+
+// Send frame to handler, if not empty
+static void frame_end(DECODER *dp)
+{
+    if (dp->frame.nbytes || dp->frame.errs)
+    {
+        if (dp->handler)
+            dp->handler(dp, &dp->frame);
+        dp->frame.nbytes = dp->frame.errs = 0;
+    }
+    dp->cont = false;
+}
+
+// Add byte to frame, send frame if full
+static void frame_byte(DECODER *dp, uint8_t b, uint32_t sample)
+{
+    if (dp->frame.nbytes == 0 && !dp->frame.errs)
+        frame_start(dp, sample);
+    dp->frame.data[dp->frame.nbytes++] = b;
+    if (dp->frame.nbytes >= DECODE_MAXBYTES)
+    {
+        frame_end(dp);
+        dp->cont = true;
+    }
+}
+
+// Set error flag in frame, starting a new frame if necessary
+static void frame_error(DECODER *dp, int err, uint32_t sample)
+{
+    if (dp->frame.nbytes == 0 && !dp->frame.errs)
+        frame_start(dp, sample);
+    dp->frame.errs |= err;
+}
+
+// Decode a block of samples
+void decode_samples(DECODER *dp, WORD *samps, int n)
+{
+    if (dp->cfg.proto == PROTO_UART && dp->bitlen >= 256)
+        decode_uart(dp, samps, n);
+    else if (dp->cfg.proto == PROTO_SPI)
+        decode_spi(dp, samps, n);
+    else if (dp->cfg.proto == PROTO_I2C)
+        decode_i2c(dp, samps, n);
+    dp->count += n;
+}
+
+// End of samples: send any incomplete frame
+void decode_flush(DECODER *dp)
+{
+    if (dp->nbits)
+    {
+        frame_error(dp, DECODE_ERR_PARTIAL, dp->count);
+    }
+    frame_end(dp);
+    dp->nbits = 0;
+    dp->state = UART_IDLE;
+}
+
+// Discard the frame being decoded, without sending it, e.g. when samples
+// have been skipped, so the decoder waits for the start of a new frame.
+// The UART decoder waits for the line to be idle for a character time, so
+// a data bit isn't taken as a start bit
+void decode_resync(DECODER *dp)
+{
+    dp->frame.nbytes = dp->frame.errs = 0;
+    dp->cont = false;
+    dp->nbits = 0;
+    dp->shift = 0;
+    dp->pos = 0;
+    dp->state = dp->cfg.proto == PROTO_UART ? UART_SYNC : UART_IDLE;
+}
+
+// UART decoder
+void decode_uart(DECODER *dp, WORD *samps, int n)
+{
+    int pin = dp->cfg.pin0;
+    WORD prev = dp->prev;
+
+    for (int i = 0; i < n; i++)
+    {
+        WORD d = samps[i];
+
+        if (dp->state == UART_SYNC)
+        {
+            // Wait for line to be idle (high) for 10 bit times
+            dp->pos = BIT(d, pin) ? dp->pos + 256 : 0;
+            if (dp->pos >= dp->bitlen * 10)
+            {
+                dp->pos = 0;
+                dp->state = UART_IDLE;
+            }
+        }
+        else if (dp->state == UART_IDLE)
+        {
+            // Check for start bit (falling edge), or gap after last byte
+            if (BIT(prev & ~d, pin))
+            {
+                dp->state = UART_DATA;
+                dp->bstart = dp->count + i;
+                dp->pos = 0;
+                dp->next = dp->bitlen / 2;
+                dp->nbits = -1;
+            }
+            else if (dp->frame.nbytes && (dp->pos += 256) > dp->bitlen * 2)
+                frame_end(dp);
+        }
+        else if ((dp->pos += 256) >= dp->next)
+        {
+            // Sampling point: start bit, 8 data bits, then stop bit
+            int bit = BIT(d, pin);
+            dp->next += dp->bitlen;
+            if (dp->nbits < 0)
+            {
+                if (bit)
+                    dp->state = UART_IDLE;      // Glitch, not a start bit
+                else
+                    dp->nbits = dp->shift = 0;
+            }
+            else if (dp->nbits < 8)
+            {
+                dp->shift |= bit << dp->nbits;
+                dp->nbits++;
+            }
+            else
+            {
+                if (!bit)
+                    frame_error(dp, DECODE_ERR_FRAMING, dp->bstart);
+                frame_byte(dp, (uint8_t)dp->shift, dp->bstart);
+                if (!bit)
+                    frame_end(dp);
+                dp->nbits = 0;
+                dp->pos = 0;
+                dp->state = UART_IDLE;
+            }
+        }
+        prev = d;
+    }
+    dp->prev = prev;
+}
+
+// SPI decoder
+void decode_spi(DECODER *dp, WORD *samps, int n)
+{
+    int sck = dp->cfg.pin0, dat = dp->cfg.pin1, cs = dp->cfg.pin2;
+    bool use_cs = cs != DECODE_NOPIN, cpol = dp->cfg.mode & 2, cpha = dp->cfg.mode & 1;
+    WORD prev = dp->prev, edgemask = 1 << sck, csmask = use_cs ? 1 << cs : 0;
+    int sample_level = cpol ^ cpha ? 0 : 1;     // Clock level after sampling edge
+
+    for (int i = 0; i < n; i++)
+    {
+        WORD d = samps[i], x = d ^ prev;
+
+        if (x & (edgemask | csmask))
+        {
+            if (x & csmask)
+            {
+                // Chip select: rising edge ends frame
+                if (BIT(d, cs))
+                {
+                    if (dp->nbits)
+                        frame_error(dp, DECODE_ERR_PARTIAL, dp->bstart);
+                    frame_end(dp);
+                }
+                dp->nbits = dp->shift = 0;
+            }
+            else if ((!use_cs || !BIT(d, cs)) && BIT(d, sck) == sample_level)
+            {
+                if (dp->nbits == 0)
+                    dp->bstart = dp->count + i;
+                dp->shift = (dp->shift << 1) | BIT(d, dat);
+                if (++dp->nbits >= 8)
+                {
+                    frame_byte(dp, (uint8_t)dp->shift, dp->bstart);
+                    if (!use_cs)
+                        frame_end(dp);
+                    dp->nbits = dp->shift = 0;
+                }
+            }
+        }
+        prev = d;
+    }
+    dp->prev = prev;
+}
+
+// I2C decoder
+void decode_i2c(DECODER *dp, WORD *samps, int n)
+{
+    int scl = dp->cfg.pin0, sda = dp->cfg.pin1;
+    WORD prev = dp->prev, mask = (1 << scl) | (1 << sda);
+
+    for (int i = 0; i < n; i++)
+    {
+        WORD d = samps[i], x = d ^ prev;
+
+        if (x & mask)
+        {
+            if (BIT(x, scl))
+            {
+                // Clock rising edge: data bit or acknowledge
+                if (BIT(d, scl) && dp->state)
+                {
+                    if (dp->nbits < 8)
+                    {
+                        if (dp->nbits == 0)
+                            dp->bstart = dp->count + i;
+                        dp->shift = (dp->shift << 1) | BIT(d, sda);
+                        dp->nbits++;
+                    }
+                    else
+                    {
+                        if (BIT(d, sda))
+                            frame_error(dp, DECODE_ERR_NACK, dp->bstart);
+                        frame_byte(dp, (uint8_t)dp->shift, dp->bstart);
+                        dp->nbits = dp->shift = 0;
+                    }
+                }
+            }
+            else if (BIT(d, scl))
+            {
+                // Data change while clock high: start or stop. The clock
+                // rising edge before this isn't a data bit, so is ignored
+                if (dp->state && dp->nbits > 1)
+                    frame_error(dp, DECODE_ERR_PARTIAL, dp->bstart);
+                frame_end(dp);
+                dp->nbits = dp->shift = 0;
+                dp->state = !BIT(d, sda);
+            }
+        }
+        prev = d;
+    }
+    dp->prev = prev;
+}
+
+// Handler to store frames from a capture
+static void decode_store(DECODER *dp, DECODE_FRAME *fp)
+{
+    if (decode_nframes < DECODE_MAXFRAMES)
+        decode_frames[decode_nframes++] = *fp;
+}
+
+// Decode a complete capture, storing the frames
+void decode_capture(DECODE_CFG *cfgp, WORD *samps, int nsamp)
+{
+    DECODER dec;
+
+    decode_nframes = 0;
+    if (!decode_cfg_valid(cfgp))
+        return;
+    decode_init(&dec, cfgp, decode_store);
+    if (nsamp > 0)
+        dec.prev = samps[0];
+    decode_samples(&dec, samps, nsamp);
+    decode_flush(&dec);
+}
+
+// Get the decoded frames, return the number of frames
+int decode_get(DECODE_FRAME **framesp)
+{
+    *framesp = decode_frames;
+    return (decode_nframes);
+}
+
+// Return protocol name
+const char *decode_proto_name(int proto)
+{
+    return (proto >= 0 && proto < NUM_PROTOS ? proto_names[proto] : "");
+}
+
+// EOF
@@ -0,0 +1,90 @@
+// Protocol decoders for UART, SPI and I2C logic captures
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define DECODE_MAXBYTES     8       // Max data bytes in a frame record
+#define DECODE_MAXFRAMES    256     // Max number of frame records
+#define DECODE_NPINS        16      // Number of input pins (bits in sample)
+#define DECODE_NOPIN        0xff    // Pin number if not used
+#define DECODE_MAGIC        "WDEC"  // Binary file marker & version
+#define DECODE_VERSION      1
+
+// Protocols
+typedef enum { PROTO_NONE, PROTO_UART, PROTO_SPI, PROTO_I2C, NUM_PROTOS } PROTO_TYPE;
+#define PROTO_NAMES "none", "uart", "spi", "i2c"
+
+// Frame error flags
+#define DECODE_ERR_FRAMING  0x01    // UART stop bit low
+#define DECODE_ERR_NACK     0x02    // I2C byte not acknowledged
+#define DECODE_ERR_PARTIAL  0x04    // Incomplete byte at end of frame
+#define DECODE_FLAG_CONT    0x80    // Not an error: continues previous frame
+#define DECODE_ERRS         (DECODE_ERR_FRAMING | DECODE_ERR_NACK | DECODE_ERR_PARTIAL)
+
+// Decoder configuration
+// UART: pin0 RxD; SPI: pin0 SCK, pin1 data, pin2 CS (active low, optional)
+// I2C: pin0 SCL, pin1 SDA. SPI mode is 0 - 3 (CPOL * 2 + CPHA)
+typedef struct {
+    int proto, rate, baud, pin0, pin1, pin2, mode;
+} DECODE_CFG;
+
+// Frame record, 16 bytes
+typedef struct __attribute__((packed)) {
+    uint32_t sample;                // Sample number at start of frame
+    uint8_t proto, chan;            // Protocol, and channel (pin0)
+    uint8_t nbytes, errs;           // Number of data bytes, error flags
+    uint8_t data[DECODE_MAXBYTES];
+} DECODE_FRAME;
+
+// Binary file header, 16 bytes, followed by frame records
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version, recsize;
+    uint32_t nframes, rate;
+} DECODE_HDR;
+
+typedef struct DECODER DECODER;
+typedef void (*DECODE_HANDLER)(DECODER *dp, DECODE_FRAME *fp);
+
+// Decoder state, persists between blocks of samples
+struct DECODER {
+    DECODE_CFG cfg;
+    WORD prev;                      // Previous sample
+    uint32_t count;                 // Total samples processed
+    uint32_t bitlen, pos, next;     // UART: bit time, time since start edge, and
+                                    // next sampling point (24.8 fixed-point)
+    uint32_t bstart;                // Sample number at start of current byte
+    int nbits, state;
+    bool cont;                      // Next frame continues the current one
+    uint16_t shift;
+    DECODE_FRAME frame;             // Frame being decoded
+    DECODE_HANDLER handler;         // Handler for completed frames
+};
+
+bool decode_cfg_valid(DECODE_CFG *cfgp);
+void decode_init(DECODER *dp, DECODE_CFG *cfgp, DECODE_HANDLER handler);
+void decode_samples(DECODER *dp, WORD *samps, int n);
+void decode_flush(DECODER *dp);
+void decode_resync(DECODER *dp);
+void decode_capture(DECODE_CFG *cfgp, WORD *samps, int nsamp);
+int decode_get(DECODE_FRAME **framesp);
+const char *decode_proto_name(int proto);
+
+// EOF
@@ -0,0 +1,245 @@
+// Fixed-point FFT, for spectrum of captured analog samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The real input samples are windowed, and packed into a complex array of
+// half the size (even samples real, odd imaginary). This is transformed by
+// radix-4 decimation-in-frequency stages, with a final radix-2 stage if
+// needed, then the outputs are unscrambled, and split into the real spectrum.
+// Each radix-4 butterfly is scaled by 1/4 (radix-2 by 1/2) so the 16-bit
+// values can't overflow. A sine wave of amplitude A (ADC units) at the centre
+// of a frequency bin gives a magnitude of 16*A, irrespective of the number of
+// points, as the Hann window has a coherent gain of 0.5
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "fft.h"
+
+#define FFT_QUARTER     (FFT_MAX_N / 4)
+
+int16_t fft_sintab[FFT_QUARTER + 1];    // Quarter-wave sine table
+FFT_CPX fft_buff[FFT_MAX_N / 2];        // Workspace
+uint16_t spec_mags[FFT_MAX_N / 2];      // Averaged spectrum magnitudes
+int spec_n, spec_count;                 // Number of points, and averages
+
+// Initialise FFT sine table
+void fft_init(void)
+{
+    for (int k = 0; k <= FFT_QUARTER; k++)
+        fft_sintab[k] = (int16_t)(32767.0 * sin(2 * M_PI * k / FFT_MAX_N) + 0.5);
+}
+
+// Return sine in Q15 format, given angle in units of 2*pi/FFT_MAX_N
+static inline int fft_sin(int k)
+{
+    k &= FFT_MAX_N - 1;
+    if (k <= FFT_QUARTER)
+        return (fft_sintab[k]);
+    if (k <= FFT_QUARTER * 2)
+        return (fft_sintab[FFT_QUARTER * 2 - k]);
+    if (k <= FFT_QUARTER * 3)
+        return (-fft_sintab[k - FFT_QUARTER * 2]);
+    return (-fft_sintab[FFT_QUARTER * 4 - k]);
+}
+
+// Return cosine in Q15 format, given angle in units of 2*pi/FFT_MAX_N
+static inline int fft_cos(int k)
+{
+    return (fft_sin(k + FFT_QUARTER));
+}
+
+// Multiply complex value by twiddle factor exp(-j * angle)
+static inline void fft_twiddle(int32_t *rp, int32_t *ip, int k)
+{
+    int32_t c = fft_cos(k), s = fft_sin(k), r = *rp, i = *ip;
+
+    *rp = (r * c + i * s + 0x4000) >> 15;
+    *ip = (i * c - r * s + 0x4000) >> 15;
+}
+
+// Return non-zero if number of points is valid
+bool fft_valid_n(int n)
+{
+    return (n >= FFT_MIN_N && n <= FFT_MAX_N && (n & (n - 1)) == 0);
+}
+
+// Complex FFT, in-place, scaled by 1/n
+// n must be a power of 2, and no more than FFT_MAX_N/2
+void fft_cpx(FFT_CPX *data, int n)
+{
+    int span, q, tstep = FFT_MAX_N / n, bits = 0, i, j, k;
+    FFT_CPX *p, t;
+
+    for (span = n; span >= 4; span /= 4, tstep *= 4)
+    {
+        q = span / 4;
+        for (j = 0; j < q; j++)
+        {
+            for (p = &data[j]; p < &data[n]; p += span)
+            {
+                int32_t t0r = p[0].re + p[2*q].re, t0i = p[0].im + p[2*q].im;
+                int32_t t1r = p[0].re - p[2*q].re, t1i = p[0].im - p[2*q].im;
+                int32_t t2r = p[q].re + p[3*q].re, t2i = p[q].im + p[3*q].im;
+                int32_t t3r = p[q].re - p[3*q].re, t3i = p[q].im - p[3*q].im;
+                int32_t y1r = (t1r + t3i + 2) >> 2, y1i = (t1i - t3r + 2) >> 2;
+                int32_t y2r = (t0r - t2r + 2) >> 2, y2i = (t0i - t2i + 2) >> 2;
+                int32_t y3r = (t1r - t3i + 2) >> 2, y3i = (t1i + t3r + 2) >> 2;
+
+                p[0].re = (t0r + t2r + 2) >> 2;
+                p[0].im = (t0i + t2i + 2) >> 2;
+                if (j)
+                {
+                    fft_twiddle(&y1r, &y1i, j * tstep);
+                    fft_twiddle(&y2r, &y2i, 2 * j * tstep);
+                    fft_twiddle(&y3r, &y3i, 3 * j * tstep);
+                }
+                // Outputs 1 & 2 are exchanged, so overall order is bit-reversed
+                p[q].re = y2r;
+                p[q].im = y2i;
+                p[2*q].re = y1r;
+                p[2*q].im = y1i;
+                p[3*q].re = y3r;
+                p[3*q].im = y3i;
+            }
+        }
+    }
+    if (span == 2)
+    {
+        for (p = data; p < &data[n]; p += 2)
+        {
+            int32_t ar = p[0].re, ai = p[0].im, br = p[1].re, bi = p[1].im;
+            p[0].re = (ar + br + 1) >> 1;
+            p[0].im = (ai + bi + 1) >> 1;
+            p[1].re = (ar - br + 1) >> 1;
+            p[1].im = (ai - bi + 1) >> 1;
+        }
+    }
+    while ((1 << bits) < n)
+        bits++;
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0, k = i, q = 0; q < bits; q++, k >>= 1)
+            j = (j << 1) | (k & 1);
+        if (i < j)
+        {
+            t = data[i];
+            data[i] = data[j];
+            data[j] = t;
+        }
+    }
+}
+
+// Return integer square root
+static uint32_t isqrt32(uint32_t val)
+{
+    uint32_t res = 0, bit = 1UL << 30;
+
+    while (bit > val)
+        bit >>= 2;
+    while (bit)
+    {
+        if (val >= res + bit)
+        {
+            val -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+            res >>= 1;
+        bit >>= 2;
+    }
+    return (res);
+}
+
+// Get magnitudes of n/2 frequency bins, given n analog samples
+// Magnitudes are averaged with existing values, given number of averages
+// (including the new value), so navg=1 replaces the old values
+bool fft_mags(WORD *samps, int n, uint16_t *mags, int navg)
+{
+    int m = n / 2, tstep = FFT_MAX_N / n;
+
+    if (!fft_valid_n(n))
+        return (false);
+    // Hann window, pack into complex array
+    for (int i = 0; i < n; i++)
+    {
+        int32_t x = ((int32_t)(samps[i] & ANALOG_MASK) - ANALOG_ZERO) << FFT_INSHIFT;
+        int32_t w = (32767 - fft_cos(i * tstep)) >> 1;
+        x = (x * w + 0x4000) >> 15;
+        if (i & 1)
+            fft_buff[i / 2].im = x;
+        else
+            fft_buff[i / 2].re = x;
+    }
+    fft_cpx(fft_buff, m);
+    // Split into spectrum of real signal
+    for (int k = 0; k < m; k++)
+    {
+        FFT_CPX *zk = &fft_buff[k], *zm = &fft_buff[(m - k) & (m - 1)];
+        int32_t er = (zk->re + zm->re) >> 1, ei = (zk->im - zm->im) >> 1;
+        int32_t odr = (zk->im + zm->im) >> 1, odi = (zm->re - zk->re) >> 1;
+        uint32_t mag;
+
+        fft_twiddle(&odr, &odi, k * tstep);
+        er += odr;
+        ei += odi;
+        mag = isqrt32((uint32_t)(er * er) + (uint32_t)(ei * ei));
+        mags[k] = navg <= 1 ? (int)mag : (int)mags[k] + ((int)mag - (int)mags[k]) / navg;
+    }
+    return (true);
+}
+
+// Update averaged spectrum from new capture, using current parameters
+// Return number of frequency bins, 0 if not enough samples
+int spectrum_update(WORD *samps, int nsamp)
+{
+    int n = get_param_int(ARG_FFTN), navg = get_param_int(ARG_FAVG);
+
+    if (!fft_valid_n(n) || nsamp < n)
+        return (0);
+    if (n != spec_n)
+    {
+        spec_n = n;
+        spec_count = 0;
+    }
+    spec_count = MIN(spec_count + 1, MAX(navg, 1));
+    fft_mags(samps, n, spec_mags, spec_count);
+    return (n / 2);
+}
+
+// Clear the spectrum average
+void spectrum_reset(void)
+{
+    spec_count = 0;
+}
+
+// Get the averaged spectrum, return number of bins
+int spectrum_get(uint16_t **magsp)
+{
+    *magsp = spec_mags;
+    return (spec_count ? spec_n / 2 : 0);
+}
+
+// EOF
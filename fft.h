@@ -0,0 +1,40 @@
+// Fixed-point FFT, for spectrum of captured analog samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define FFT_MIN_N       256         // Min and max number of points (power of 2)
+#define FFT_MAX_N       8192
+#define FFT_INSHIFT     5           // Shift to convert 10-bit ADC value to Q15
+
+// Complex value, real & imaginary parts in Q15 format
+typedef struct {
+    int16_t re, im;
+} FFT_CPX;
+
+void fft_init(void);
+bool fft_valid_n(int n);
+void fft_cpx(FFT_CPX *data, int n);
+bool fft_mags(WORD *samps, int n, uint16_t *mags, int navg);
+int spectrum_update(WORD *samps, int nsamp);
+void spectrum_reset(void);
+int spectrum_get(uint16_t **magsp);
+
+// EOF
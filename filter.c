@@ -0,0 +1,189 @@
+// Filtering & decimation of analog samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The analog part of each sample is low-pass filtered, and decimated by a
+// power of 2, giving 16-bit unsigned values; full-scale is the same as the
+// ADC, so the extra bits hold the resolution gained by oversampling.
+// Boxcar: average of each block of 'dec' samples
+// CIC:    cascaded integrator-comb, 3 stages, sharper cut-off than boxcar
+// FIR:    CIC decimation to twice the output rate, then a windowed-sinc
+//         low-pass FIR with cut-off at 80% of the output Nyquist frequency,
+//         decimating by 2, so only calculated for the output samples
+// Filters are fed with blocks of samples, so can be used on a complete
+// capture or a stream; the output can overwrite the input, as it is shorter.
+// The first few outputs include the filter start-up transient.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "filter.h"
+
+#define FILT_CUTOFF     0.4         // FIR cut-off, relative to output rate
+#define FILT_HMASK      (FILT_MAXTAPS - 1)
+
+FILTER cap_filter;
+
+// Design FIR low-pass filter, Hamming window, coefficients sum to 1.0 (Q15)
+static void filter_design(FILTER *fp)
+{
+    double fc = FILT_CUTOFF / (fp->log2cic < 0 ? 1 : FILT_FIR_DEC), mid = (fp->ntaps - 1) / 2.0, h[FILT_MAXTAPS], sum = 0;
+    int total = 0;
+
+    for (int k = 0; k < fp->ntaps; k++)
+    {
+        double x = k - mid, w = 0.54 - 0.46 * cos(2 * M_PI * k / MAX(fp->ntaps - 1, 1));
+        h[k] = w * (x == 0 ? 2 * fc : sin(2 * M_PI * fc * x) / (M_PI * x));
+        sum += h[k];
+    }
+    for (int k = 0; k < fp->ntaps; k++)
+        total += fp->coeffs[k] = (int16_t)floor(h[k] / sum * 32768 + 0.5);
+    fp->coeffs[fp->ntaps / 2] += 32768 - total;
+}
+
+// Return log2 of decimation factor, rounded down to a power of 2
+static int filter_log2dec(int dec)
+{
+    int n = 0;
+
+    while ((2 << n) <= MIN(dec, FILT_MAXDEC))
+        n++;
+    return (n);
+}
+
+// Return decimation factor that will be used, given the requested value
+int filter_dec(int dec)
+{
+    return (1 << filter_log2dec(dec));
+}
+
+// Initialise filter, given type, decimation factor & number of FIR taps
+// The decimation factor is rounded down to a power of 2
+void filter_init(FILTER *fp, int type, int dec, int ntaps)
+{
+    memset(fp, 0, sizeof(FILTER));
+    fp->type = type;
+    fp->log2dec = filter_log2dec(dec);
+    fp->dec = 1 << fp->log2dec;
+    fp->ntaps = MAX(1, MIN(ntaps, FILT_MAXTAPS));
+    fp->log2cic = type == FILT_FIR ? fp->log2dec - 1 : fp->log2dec;
+    fp->cicdec = 1 << MAX(fp->log2cic, 0);
+    if (type == FILT_FIR)
+        filter_design(fp);
+}
+
+// Scale filter output, given the log2 of the filter gain, and output bits
+static inline uint16_t filter_scale(uint32_t val, int log2gain, int bits)
+{
+    int shift = log2gain - (bits - ANALOG_BITS);
+
+    if (shift > 0)
+        val = (val + (1u << (shift - 1))) >> shift;
+    else
+        val <<= -shift;
+    return (val > 0xffff ? 0xffff : (uint16_t)val);
+}
+
+// CIC filter, given input value, return true if there is an output value
+static inline bool filter_cic(FILTER *fp, uint32_t val, int bits, uint16_t *outp)
+{
+    // Integer overflow is harmless, as long as the output fits in 32 bits
+    fp->integ[0] += val;
+    fp->integ[1] += fp->integ[0];
+    fp->integ[2] += fp->integ[1];
+    if (++fp->cicphase >= fp->cicdec)
+    {
+        uint32_t c0 = fp->integ[2] - fp->comb[0], c1 = c0 - fp->comb[1], c2 = c1 - fp->comb[2];
+        fp->comb[0] = fp->integ[2];
+        fp->comb[1] = c0;
+        fp->comb[2] = c1;
+        fp->cicphase = 0;
+        *outp = filter_scale(c2, fp->log2cic * FILT_CIC_ORDER, bits);
+        return (true);
+    }
+    return (false);
+}
+
+// Filter a block of samples, return the number of output values
+// The output can be the same buffer as the input
+int filter_block(FILTER *fp, WORD *in, int n, uint16_t *out)
+{
+    int nout = 0, dec = fp->dec;
+
+    if (fp->type == FILT_BOXCAR)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            fp->acc += in[i] & ANALOG_MASK;
+            if (++fp->phase >= dec)
+            {
+                out[nout++] = filter_scale(fp->acc, fp->log2dec, FILT_OUTBITS);
+                fp->acc = fp->phase = 0;
+            }
+        }
+    }
+    else if (fp->type == FILT_CIC)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (filter_cic(fp, in[i] & ANALOG_MASK, FILT_OUTBITS, &out[nout]))
+                nout++;
+        }
+    }
+    else if (fp->type == FILT_FIR)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            uint16_t val;
+            if (fp->log2cic < 0)
+                val = filter_scale(in[i] & ANALOG_MASK, 0, FILT_FIR_BITS);
+            else if (!filter_cic(fp, in[i] & ANALOG_MASK, FILT_FIR_BITS, &val))
+                continue;
+            fp->hist[fp->hpos++ & FILT_HMASK] = val;
+            if (++fp->phase >= FILT_FIR_DEC || fp->log2cic < 0)
+            {
+                int32_t acc = 0;
+                for (int k = 0, j = fp->hpos - 1; k < fp->ntaps; k++, j--)
+                    acc += fp->coeffs[k] * fp->hist[j & FILT_HMASK];
+                out[nout++] = filter_scale(acc < 0 ? 0 : acc, 15 + FILT_FIR_BITS - FILT_OUTBITS, ANALOG_BITS);
+                fp->phase = 0;
+            }
+        }
+    }
+    return (nout);
+}
+
+// Filter a complete capture in place, return the new number of samples
+// If no filter is selected, the samples are unchanged
+int filter_capture(WORD *samps, int nsamp, int type, int dec, int ntaps)
+{
+    if (type <= FILT_NONE || type >= NUM_FILTS)
+        return (nsamp);
+    filter_init(&cap_filter, type, dec, ntaps);
+    return (filter_block(&cap_filter, samps, nsamp, samps));
+}
+
+// EOF
@@ -0,0 +1,50 @@
+// Filtering & decimation of analog samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define FILT_MAXDEC     128         // Max decimation factor (power of 2)
+#define FILT_MAXTAPS    64          // Max number of FIR taps (power of 2)
+#define FILT_DEFTAPS    32          // Default number of FIR taps
+#define FILT_OUTBITS    16          // Number of bits in output value
+#define FILT_CIC_ORDER  3           // Number of CIC integrator & comb stages
+#define FILT_FIR_DEC    2           // Decimation factor of FIR stage
+#define FILT_FIR_BITS   14          // Number of bits in FIR input value
+
+// Filter types
+typedef enum { FILT_NONE, FILT_BOXCAR, FILT_CIC, FILT_FIR, NUM_FILTS } FILT_TYPE;
+
+// Filter state, persists between blocks of samples
+typedef struct {
+    int type, dec, log2dec, ntaps, phase, hpos;
+    int cicdec, log2cic, cicphase;  // CIC decimation, before FIR
+    uint32_t acc;                   // Boxcar accumulator
+    uint32_t integ[FILT_CIC_ORDER]; // CIC integrators & comb delays
+    uint32_t comb[FILT_CIC_ORDER];
+    int16_t coeffs[FILT_MAXTAPS];   // FIR coefficients (Q15) and input history
+    uint16_t hist[FILT_MAXTAPS];
+} FILTER;
+
+int filter_dec(int dec);
+void filter_init(FILTER *fp, int type, int dec, int ntaps);
+int filter_block(FILTER *fp, WORD *in, int n, uint16_t *out);
+int filter_capture(WORD *samps, int nsamp, int type, int dec, int ntaps);
+
+// EOF
@@ -0,0 +1,222 @@
+// Compress WiFi firmware & CLM data for PicoWi, using LZSS
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Host (PC) build step, e.g.
+//   gcc -O2 -o fw_pack fw_pack.c ../picowi/picowi_lz.c
+//   ./fw_pack fw_43439.c fw_43439_lz.c
+// The input C file is copied up to the firmware array (so the NVRAM data is
+// unchanged), then the firmware & CLM arrays are compressed. Each compressed
+// array is checked by decompressing it with the PicoWi code, and comparing
+// the result byte-for-byte with the original.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../picowi/picowi_lz.h"
+
+#define FW_NAME         "fw_firmware_data"
+#define CLM_NAME        "fw_clm_data"
+#define HASH_SIZE       0x10000
+#define LINE_BYTES      12
+#define MAX(a,b)        (((a)>(b))?(a):(b))
+
+char *read_file(char *fname, long *lenp);
+uint8_t *get_array(char *text, char *name, int *lenp);
+int lz_compress(uint8_t *inp, int inlen, uint8_t *outp);
+int lz_verify(uint8_t *lzdata, int lzlen, uint8_t *data, int len);
+void write_array(FILE *out, char *name, uint8_t *data, int len);
+
+int main(int argc, char *argv[])
+{
+    char *text, *end, *name;
+    uint8_t *fw, *clm, *fwlz, *clmlz;
+    int fwlen, clmlen, fwlzlen, clmlzlen;
+    long textlen;
+    FILE *out;
+
+    if (argc < 3)
+    {
+        printf("Usage: fw_pack infile.c outfile.c\n");
+        return (1);
+    }
+    if (!(text = read_file(argv[1], &textlen)))
+        return (1);
+    if (!(fw = get_array(text, FW_NAME, &fwlen)) ||
+        !(clm = get_array(text, CLM_NAME, &clmlen)))
+        return (1);
+    fwlz = malloc(fwlen + fwlen/8 + 16);
+    clmlz = malloc(clmlen + clmlen/8 + 16);
+    fwlzlen = lz_compress(fw, fwlen, fwlz);
+    clmlzlen = lz_compress(clm, clmlen, clmlz);
+    printf("Firmware %d -> %d bytes, CLM %d -> %d bytes\n", fwlen, fwlzlen, clmlen, clmlzlen);
+    if (!lz_verify(fwlz, fwlzlen, fw, fwlen) || !lz_verify(clmlz, clmlzlen, clm, clmlen))
+    {
+        printf("Error: decompressed data doesn't match\n");
+        return (1);
+    }
+    if (!(out = fopen(argv[2], "w")))
+    {
+        printf("Can't open %s\n", argv[2]);
+        return (1);
+    }
+    end = strstr(text, "const unsigned char " FW_NAME);
+    fwrite(text, 1, end - text, out);
+    fprintf(out, "// Firmware and CLM are LZSS compressed, see picowi/picowi_lz.c\n");
+    name = MAX(strrchr(argv[1], '/'), strrchr(argv[1], '\\'));
+    fprintf(out, "// Generated from %s by fw_pack.c, do not edit\n\n", name ? name+1 : argv[1]);
+    write_array(out, "fw_firmware", fwlz, fwlzlen);
+    fprintf(out, "const unsigned int fw_firmware_len = %d;\n\n", fwlen);
+    write_array(out, "fw_clm", clmlz, clmlzlen);
+    fprintf(out, "const unsigned int fw_clm_len = %d;\n\n// EOF\n", clmlen);
+    fclose(out);
+    return (0);
+}
+
+// Read text file into memory, with null terminator
+char *read_file(char *fname, long *lenp)
+{
+    FILE *in;
+    char *text;
+
+    if (!(in = fopen(fname, "rb")))
+    {
+        printf("Can't open %s\n", fname);
+        return (0);
+    }
+    fseek(in, 0, SEEK_END);
+    *lenp = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    text = malloc(*lenp + 1);
+    *lenp = fread(text, 1, *lenp, in);
+    text[*lenp] = 0;
+    fclose(in);
+    return (text);
+}
+
+// Get hex byte values of a C array, given its name
+uint8_t *get_array(char *text, char *name, int *lenp)
+{
+    char *s = strstr(text, name), *end;
+    uint8_t *data;
+    int n = 0;
+
+    if (!s || !(s = strchr(s, '{')) || !(end = strchr(s, '}')))
+    {
+        printf("Can't find array %s\n", name);
+        return (0);
+    }
+    data = malloc(end - s);
+    while ((s = strstr(s, "0x")) != 0 && s < end)
+    {
+        data[n++] = (uint8_t)strtoul(s, &s, 16);
+    }
+    *lenp = n;
+    return (data);
+}
+
+// Compress data using LZSS, with hash chains to find matches
+int lz_compress(uint8_t *inp, int inlen, uint8_t *outp)
+{
+    static int head[HASH_SIZE], prev[LZ_WINDOW];
+    int pos = 0, outlen = 0, flagpos = 0, nitems = 8, i, h, cand, len, bestlen, bestdist;
+
+    for (i = 0; i < HASH_SIZE; i++)
+        head[i] = -1;
+    while (pos < inlen)
+    {
+        if (nitems == 8)
+        {
+            flagpos = outlen++;
+            outp[flagpos] = 0;
+            nitems = 0;
+        }
+        bestlen = bestdist = 0;
+        if (pos + LZ_MINMATCH <= inlen)
+        {
+            h = (inp[pos] << 8 ^ inp[pos+1] << 4 ^ inp[pos+2]) & (HASH_SIZE - 1);
+            for (cand = head[h]; cand >= 0 && pos - cand <= LZ_WINDOW; cand = prev[cand & LZ_WINDOW_MASK])
+            {
+                for (len = 0; len < LZ_MAXMATCH && pos + len < inlen && inp[cand+len] == inp[pos+len]; len++) ;
+                if (len > bestlen)
+                {
+                    bestlen = len;
+                    bestdist = pos - cand;
+                    if (len == LZ_MAXMATCH)
+                        break;
+                }
+            }
+        }
+        if (bestlen >= LZ_MINMATCH)
+        {
+            outp[outlen++] = (uint8_t)(bestdist - 1);
+            outp[outlen++] = (uint8_t)(((bestdist - 1) >> 4 & 0xf0) | (bestlen - LZ_MINMATCH));
+        }
+        else
+        {
+            outp[flagpos] |= 1 << nitems;
+            outp[outlen++] = inp[pos];
+            bestlen = 1;
+        }
+        nitems++;
+        while (bestlen--)
+        {
+            if (pos + LZ_MINMATCH <= inlen)
+            {
+                h = (inp[pos] << 8 ^ inp[pos+1] << 4 ^ inp[pos+2]) & (HASH_SIZE - 1);
+                prev[pos & LZ_WINDOW_MASK] = head[h];
+                head[h] = pos;
+            }
+            pos++;
+        }
+    }
+    return (outlen);
+}
+
+// Decompress data in small blocks, as on the Pico, and check it matches
+int lz_verify(uint8_t *lzdata, int lzlen, uint8_t *data, int len)
+{
+    static LZ_STATE lzs;
+    uint8_t buff[64];
+    int n, total = 0;
+
+    lz_init(&lzs, lzdata, lzlen);
+    while ((n = lz_read(&lzs, buff, sizeof(buff))) > 0)
+    {
+        if (total + n > len || memcmp(buff, &data[total], n))
+            return (0);
+        total += n;
+    }
+    return (total == len);
+}
+
+// Write C array of compressed data, and its length
+void write_array(FILE *out, char *name, uint8_t *data, int len)
+{
+    fprintf(out, "const unsigned char %s_lzdata[] = {", name);
+    for (int i = 0; i < len; i++)
+        fprintf(out, "%s0x%02X%s", i % LINE_BYTES ? " " : "\n\t", data[i], i < len-1 ? "," : "");
+    fprintf(out, "\n};\nconst unsigned int %s_lzlen = sizeof(%s_lzdata);\n", name, name);
+}
+
+// EOF
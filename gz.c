@@ -0,0 +1,317 @@
+// Streaming gzip (deflate) compression, for HTTP Content-Encoding
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The data is compressed in chunks, as it is generated, into a single deflate
+// block (RFC 1951), with gzip header & trailer (RFC 1952). LZ77 matches are
+// found using a hash of the next 3 bytes, that gives the last position where
+// they occurred, within a small history window, so the RAM use is bounded.
+// The block can use the fixed Huffman codes, which suit general text, or a 
+// constant 'dynamic' table for base64 text: 6 bits for most base64 chars,
+// which removes the base64 expansion, but 13 or 14 bits for other symbols.
+// A match is only used if its length & distance codes take fewer bits than
+// the literals it replaces; with the base64 table, short matches at a long
+// distance cost more than the 6-bit literals, so are rejected. As a result,
+// the output per byte can't exceed the longest literal code.
+// Calling with a null output pointer just returns the size.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "gz.h"
+
+#define GZ_NLENS        29          // Number of length & distance codes
+#define GZ_NDISTS       30
+#define GZ_NLITS        (257 + GZ_NLENS)    // Literal, end & length codes
+#define GZ_NCODES       288         // Including 2 unused codes, for fixed table
+#define GZ_END          256         // End-of-block code
+#define GZ_NCLENS       19          // Number of code length codes
+#define GZ_HCLEN        17          // Code length codes sent (up to length 14)
+
+// Huffman code table, with codes bit-reversed for sending LS bit first
+typedef struct {
+    uint16_t code[GZ_NCODES], dcode[GZ_NDISTS];
+    uint8_t len[GZ_NCODES], dlen[GZ_NDISTS];
+} GZ_CODES;
+
+static const uint8_t gz_hdr[GZ_HDR_LEN] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+static const uint16_t gz_len_base[GZ_NLENS] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 
+    19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t gz_len_extra[GZ_NLENS] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 
+    2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t gz_dist_base[GZ_NDISTS] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 
+    65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 
+    12289, 16385, 24577};
+static const uint8_t gz_dist_extra[GZ_NDISTS] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 
+    5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint32_t gz_crc_tab[16] = {0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8,
+    0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+// Order of code length codes, and their lengths for the base64 table
+static const uint8_t gz_clen_order[GZ_NCLENS] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 
+    12, 3, 13, 2, 14, 1, 15};
+static const uint8_t gz_clen_lens[GZ_NCLENS] = {[4]=3, [5]=3, [6]=2, [7]=3, [13]=3, [14]=2};
+static const char gz_b64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+static GZ_CODES gz_codes[GZ_NMODES];
+static uint16_t gz_clen_codes[GZ_NCLENS];
+static bool gz_codes_ok;
+
+// Make canonical Huffman codes from code lengths, bit-reversed
+static void gz_make_codes(const uint8_t *lens, uint16_t *codes, int n)
+{
+    uint16_t count[16] = {0}, next[16];
+    int code = 0;
+
+    for (int i = 0; i < n; i++)
+        count[lens[i]]++;
+    count[0] = 0;
+    for (int b = 1; b < 16; b++)
+        next[b] = code = (code + count[b - 1]) << 1;
+    for (int i = 0; i < n; i++)
+    {
+        int len = lens[i], c = len ? next[len]++ : 0, rev = 0;
+        for (int b = 0; b < len; b++, c >>= 1)
+            rev = (rev << 1) | (c & 1);
+        codes[i] = rev;
+    }
+}
+
+// Set code lengths & make code tables, for fixed & base64 modes
+static void gz_init_codes(void)
+{
+    GZ_CODES *fp = &gz_codes[GZ_FIXED], *bp = &gz_codes[GZ_BASE64];
+
+    for (int i = 0; i < GZ_NCODES; i++)
+    {
+        fp->len[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        // Base64 chars 6 bits, '+' '/' 7 bits, end & lengths 13 bits, other
+        // chars 14 bits, apart from 4 at 13 bits, so total 2^-len is 1
+        bp->len[i] = i >= GZ_NLITS ? 0 : i >= GZ_END ? 13 : i == '+' || i == '/' ? 7 : 
+                     strchr(gz_b64_chars, i) && i ? 6 : 14;
+    }
+    for (const char *s = "= \r\n"; *s; s++)
+        bp->len[(uint8_t)*s] = 13;
+    for (int i = 0; i < GZ_NDISTS; i++)
+    {
+        fp->dlen[i] = 5;
+        bp->dlen[i] = i < 2 ? 4 : 5;
+    }
+    for (int m = 0; m < GZ_NMODES; m++)
+    {
+        gz_make_codes(gz_codes[m].len, gz_codes[m].code, GZ_NCODES);
+        gz_make_codes(gz_codes[m].dlen, gz_codes[m].dcode, GZ_NDISTS);
+    }
+    gz_make_codes(gz_clen_lens, gz_clen_codes, GZ_NCLENS);
+    gz_codes_ok = true;
+}
+
+// Initialise encoder
+void gz_init(GZ_ENC *ep, GZ_MODE mode)
+{
+    if (!gz_codes_ok)
+        gz_init_codes();
+    ep->total = ep->hist = ep->acc = ep->nbits = 0;
+    ep->crc = 0xffffffff;
+    ep->started = false;
+    ep->mode = mode;
+    ep->outpos = ep->outlen = 0;
+}
+
+// Add bits to accumulator, output whole bytes (if buffer non-null)
+static inline int gz_put(GZ_ENC *ep, uint8_t *out, int n, uint32_t val, int nbits)
+{
+    ep->acc |= val << ep->nbits;
+    ep->nbits += nbits;
+    while (ep->nbits >= 8)
+    {
+        if (out)
+            out[n] = (uint8_t)ep->acc;
+        n++;
+        ep->acc >>= 8;
+        ep->nbits -= 8;
+    }
+    return (n);
+}
+
+// Add block header, and for base64 mode, the code lengths
+static int gz_block_hdr(GZ_ENC *ep, uint8_t *out, int n)
+{
+    GZ_CODES *cp = &gz_codes[GZ_BASE64];
+
+    if (ep->mode == GZ_FIXED)
+        return (gz_put(ep, out, n, 3, 3));  // Final block, fixed codes
+    n = gz_put(ep, out, n, 5, 3);           // Final block, dynamic codes
+    n = gz_put(ep, out, n, GZ_NLITS - 257, 5);
+    n = gz_put(ep, out, n, GZ_NDISTS - 1, 5);
+    n = gz_put(ep, out, n, GZ_HCLEN - 4, 4);
+    for (int i = 0; i < GZ_HCLEN; i++)
+        n = gz_put(ep, out, n, gz_clen_lens[gz_clen_order[i]], 3);
+    for (int i = 0; i < GZ_NLITS + GZ_NDISTS; i++)
+    {
+        int len = i < GZ_NLITS ? cp->len[i] : cp->dlen[i - GZ_NLITS];
+        n = gz_put(ep, out, n, gz_clen_codes[len], gz_clen_lens[len]);
+    }
+    return (n);
+}
+
+// Return index of length code for match length
+static inline int gz_len_index(int len)
+{
+    int i = GZ_NLENS - 1;
+
+    while (len < gz_len_base[i])
+        i--;
+    return (i);
+}
+
+// Return index of distance code for match distance
+static inline int gz_dist_index(int dist)
+{
+    int i = GZ_NDISTS - 1;
+
+    while (dist < gz_dist_base[i])
+        i--;
+    return (i);
+}
+
+// Return true if a match costs fewer bits than the literals it replaces
+static bool gz_match_better(GZ_CODES *cp, uint8_t *p, int len, int dist)
+{
+    int li = gz_len_index(len), di = gz_dist_index(dist), lbits = 0;
+    int mbits = cp->len[257 + li] + gz_len_extra[li] + cp->dlen[di] + gz_dist_extra[di];
+
+    for (int i = 0; i < len && lbits <= mbits; i++)
+        lbits += cp->len[p[i]];
+    return (mbits < lbits);
+}
+
+// Add match length & distance codes
+static int gz_match(GZ_ENC *ep, GZ_CODES *cp, uint8_t *out, int n, int len, int dist)
+{
+    int i = gz_len_index(len);
+
+    n = gz_put(ep, out, n, cp->code[257 + i], cp->len[257 + i]);
+    n = gz_put(ep, out, n, len - gz_len_base[i], gz_len_extra[i]);
+    i = gz_dist_index(dist);
+    n = gz_put(ep, out, n, cp->dcode[i], cp->dlen[i]);
+    return (gz_put(ep, out, n, dist - gz_dist_base[i], gz_dist_extra[i]));
+}
+
+// Return hash of 3 bytes
+static inline int gz_hash(uint8_t *p)
+{
+    return (((p[0] | p[1] << 8 | p[2] << 16) * 2654435761u) >> (32 - GZ_HASH_BITS));
+}
+
+// Compress a chunk of data (max GZ_CHUNK bytes), with header if the first,
+// and trailer if final. Return the number of bytes output (stored if non-null)
+int gz_compress(GZ_ENC *ep, const void *inp, int len, bool final, uint8_t *out)
+{
+    GZ_CODES *cp = &gz_codes[ep->mode];
+    uint8_t *bp = ep->buff;
+    int n = 0, i = GZ_WINDOW, end = GZ_WINDOW + len, start = GZ_WINDOW - ep->hist;
+
+    if (!ep->started)
+    {
+        if (out)
+            memcpy(out, gz_hdr, GZ_HDR_LEN);
+        n = gz_block_hdr(ep, out, GZ_HDR_LEN);
+        ep->started = true;
+    }
+    memcpy(&bp[GZ_WINDOW], inp, len);
+    for (int j = GZ_WINDOW; j < end; j++)
+    {
+        ep->crc = (ep->crc >> 4) ^ gz_crc_tab[(ep->crc ^ bp[j]) & 15];
+        ep->crc = (ep->crc >> 4) ^ gz_crc_tab[(ep->crc ^ (bp[j] >> 4)) & 15];
+    }
+    while (i < end)
+    {
+        int mlen = 0, dist = 0;
+        if (end - i >= GZ_MINMATCH)
+        {
+            int h = gz_hash(&bp[i]), maxlen = MIN(GZ_MAXMATCH, end - i);
+            uint16_t pos = (uint16_t)(ep->total + i - GZ_WINDOW);
+            dist = (uint16_t)(pos - ep->head[h]);
+            ep->head[h] = pos;
+            if (dist > 0 && i - dist >= start)
+            {
+                uint8_t *p = &bp[i], *q = &bp[i - dist];
+                while (mlen < maxlen && p[mlen] == q[mlen])
+                    mlen++;
+            }
+        }
+        if (mlen >= GZ_MINMATCH && gz_match_better(cp, &bp[i], mlen, dist))
+        {
+            n = gz_match(ep, cp, out, n, mlen, dist);
+            for (int j = i + 1; j < i + mlen && end - j >= GZ_MINMATCH; j++)
+                ep->head[gz_hash(&bp[j])] = (uint16_t)(ep->total + j - GZ_WINDOW);
+            i += mlen;
+        }
+        else
+        {
+            n = gz_put(ep, out, n, cp->code[bp[i]], cp->len[bp[i]]);
+            i++;
+        }
+    }
+    memmove(bp, &bp[len], GZ_WINDOW);
+    ep->total += len;
+    ep->hist = MIN(ep->hist + len, GZ_WINDOW);
+    if (final)
+    {
+        uint32_t crc = ~ep->crc, total = ep->total;
+        n = gz_put(ep, out, n, cp->code[GZ_END], cp->len[GZ_END]);
+        n = gz_put(ep, out, n, 0, (8 - ep->nbits) & 7);
+        for (int j = 0; j < 4; j++, crc >>= 8, total >>= 8)
+        {
+            if (out)
+            {
+                out[n + j] = (uint8_t)crc;
+                out[n + j + 4] = (uint8_t)total;
+            }
+        }
+        n += GZ_TRL_LEN;
+    }
+    return (n);
+}
+
+// Return compressed size of data, without storing it
+int gz_size(GZ_ENC *ep, GZ_MODE mode, const void *inp, int len)
+{
+    const uint8_t *p = inp;
+    int n = 0;
+
+    gz_init(ep, mode);
+    do
+    {
+        int chunk = MIN(len, GZ_CHUNK);
+        n += gz_compress(ep, p, chunk, chunk == len, NULL);
+        p += chunk;
+        len -= chunk;
+    } while (len > 0);
+    gz_init(ep, mode);
+    return (n);
+}
+
+// EOF
@@ -0,0 +1,56 @@
+// Streaming gzip (deflate) compression, for HTTP Content-Encoding
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define GZ_WINDOW       1024        // Bytes of history for LZ77 matches
+#define GZ_CHUNK        256         // Max bytes of input per compress call
+#define GZ_HASH_BITS    9           // Bits in hash of 3 input bytes
+#define GZ_HASH_SIZE    (1 << GZ_HASH_BITS)
+#define GZ_MINMATCH     3           // Min & max match lengths
+#define GZ_MAXMATCH     258
+#define GZ_HDR_LEN      10          // gzip header & trailer lengths
+#define GZ_TRL_LEN      8
+#define GZ_DYN_HDR_MAX  128         // Max length of dynamic Huffman table
+#define GZ_MAXBITS      14          // Max bits in literal code
+// Max bytes output by one compress call: literals, headers & trailer
+#define GZ_OUT_MAX      ((GZ_CHUNK * GZ_MAXBITS + 7) / 8 + GZ_HDR_LEN + \
+                         GZ_DYN_HDR_MAX + GZ_TRL_LEN + 4)
+
+// Huffman code tables: fixed, or tuned for base64 text
+typedef enum {GZ_FIXED, GZ_BASE64, GZ_NMODES} GZ_MODE;
+
+// Encoder state
+typedef struct {
+    uint8_t buff[GZ_WINDOW + GZ_CHUNK]; // History, then current input
+    uint16_t head[GZ_HASH_SIZE];    // Last position of each hash value
+    uint32_t total, hist;           // Total bytes input, bytes of history
+    uint32_t crc, acc, nbits;       // CRC, and bit accumulator
+    bool inuse, started;
+    GZ_MODE mode;
+    int outpos, outlen;             // Output bytes in buffer
+    uint8_t out[GZ_OUT_MAX];
+} GZ_ENC;
+
+void gz_init(GZ_ENC *ep, GZ_MODE mode);
+int gz_compress(GZ_ENC *ep, const void *inp, int len, bool final, uint8_t *out);
+int gz_size(GZ_ENC *ep, GZ_MODE mode, const void *inp, int len);
+
+// EOF
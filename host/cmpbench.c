@@ -0,0 +1,226 @@
+// Benchmark of delta & Rice compression of captured samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Test signals are compressed by the streaming encoder (cmp.c), in blocks of
+// random size as the web server would read them, and the result is checked
+// against the precomputed size, and decoded to check it matches the input.
+// The signals are: slow & fast sine waves with a small amount of noise, a
+// square wave with a logic counter, and random values (the worst case); also
+// 16-bit values like filter output, as a sine wave with noise in the low bits
+// (wide mode) and random values (sent raw). A raw 16-bit capture file can be
+// added. The output shows the compressed
+// size relative to the 16-bit binary data, bits per sample, and the encoder
+// time per sample on this host (also in TSC cycles on x86).
+// Alternatively, a compressed file (e.g. from /data.cmp) can be decoded, and
+// the 16-bit samples written to stdout.
+//
+// Usage: cmpbench [-n samples] [-i iterations] [-f capture_file] [-s seed]
+//        cmpbench -d compressed_file > capture_file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "../cmp.h"
+#include "testutil.h"
+
+#define NUM_SIGS        7
+#define SIG_WIDE        5           // First signal with 16-bit values
+#define MAX_CHUNK       1460        // Max block size requested by server
+
+const char *sig_names[NUM_SIGS] = {"sine_slow", "sine_fast", "noisy", "square_logic", "random",
+    "sine_16bit", "random_16bit"};
+WORD samps[XSAMP_MAX], decoded[XSAMP_MAX];
+uint8_t cmpdata[XSAMP_MAX * 4];
+CMP_ENC enc;
+
+// Generate test signal, return number of samples
+int make_signal(int sig, int n)
+{
+    if (sig == 0)
+        test_sine(samps, n, 1 / 1000.0, 400, 1, false);
+    else if (sig == 1)
+        test_sine(samps, n, 1 / 20.0, 400, 1, false);
+    else if (sig == 2)
+        test_sine(samps, n, 1 / 100.0, 200, 20, false);
+    else if (sig == 5)
+    {
+        test_sine(samps, n, 1 / 200.0, 400, 0, false);
+        for (int i = 0; i < n; i++)
+            samps[i] = (WORD)((samps[i] & ANALOG_MASK) << CMP_DBITS | (rand() & 0xf));
+    }
+    else if (sig == 6)
+    {
+        for (int i = 0; i < n; i++)
+            samps[i] = (WORD)rand();
+    }
+    else
+    {
+        for (int i = 0; i < n; i++)
+            samps[i] = sig == 3 ? test_sample((i / 50) & 1 ? 300 : -300, (WORD)((i / 64) << ANALOG_BITS)) :
+                                  test_sample((rand() & ANALOG_MASK) - ANALOG_ZERO, 0);
+    }
+    return (n);
+}
+
+// Load raw 16-bit capture file, return number of samples
+int load_file(char *fname, int maxsamp)
+{
+    FILE *fp = fopen(fname, "rb");
+    int n = 0;
+
+    if (fp)
+    {
+        n = fread(samps, sizeof(WORD), maxsamp, fp);
+        fclose(fp);
+    }
+    return (n);
+}
+
+// Decode compressed file to stdout, return number of samples, -1 if error
+int decode_file(char *fname)
+{
+    FILE *fp = fopen(fname, "rb");
+    int len = 0, n = -1;
+
+    if (fp)
+    {
+        len = fread(cmpdata, 1, sizeof(cmpdata), fp);
+        fclose(fp);
+        if ((n = cmp_decode(cmpdata, len, decoded, XSAMP_MAX)) > 0)
+            fwrite(decoded, sizeof(WORD), n, stdout);
+    }
+    return (n);
+}
+
+// Compress & check signal, print results, return false if error
+bool test_signal(const char *name, int nsamp, int iters, bool wide)
+{
+    int mode = cmp_mode(samps, nsamp, wide ? CMP_WIDE : 0);
+    int size = cmp_size(samps, nsamp, mode), len = 0, n, ndec;
+    double start, nsecs;
+    uint64_t cycles;
+    bool ok;
+
+    cmp_init(&enc, samps, nsamp, mode);
+    while ((n = cmp_read(&enc, &cmpdata[len], 1 + rand() % MAX_CHUNK)) > 0)
+        len += n;
+    ndec = cmp_decode(cmpdata, len, decoded, nsamp);
+    ok = len == size && ndec == nsamp && !memcmp(samps, decoded, nsamp * sizeof(WORD));
+    start = get_secs();
+    cycles = get_cycles();
+    for (int i = 0; i < iters; i++)
+    {
+        cmp_init(&enc, samps, nsamp, mode);
+        for (len = 0; (n = cmp_read(&enc, &cmpdata[len], MAX_CHUNK)) > 0; )
+            len += n;
+    }
+    cycles = get_cycles() - cycles;
+    nsecs = (get_secs() - start) * 1e9 / ((double)iters * nsamp);
+    printf("%-14s %7d %8d %7.2f %7.2f %8.2f", name, nsamp, len, 
+        (double)nsamp * 2 / MAX(len, 1), len * 8.0 / nsamp, nsecs);
+    if (cycles)
+        printf(" %8.1f", (double)cycles / ((double)iters * nsamp));
+    printf(" %4s %s\n", mode & CMP_RAW ? "raw" : mode & CMP_WIDE ? "wide" : "", TEST_RESULT(ok));
+    return (ok);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, nsamp = 10000, iters = 100, fails = 0;
+    char *fname = NULL;
+
+    while ((opt = getopt(argc, argv, "n:i:f:s:d:")) != -1)
+    {
+        if (opt == 'n')
+            nsamp = MIN(MAX(1, atoi(optarg)), XSAMP_MAX);
+        else if (opt == 'i')
+            iters = MAX(1, atoi(optarg));
+        else if (opt == 'f')
+            fname = optarg;
+        else if (opt == 's')
+            srand(atoi(optarg));
+        else if (opt == 'd')
+        {
+            int n = decode_file(optarg);
+            if (n < 0)
+                fprintf(stderr, "Can't decode %s\n", optarg);
+            return (n < 0 ? 1 : 0);
+        }
+        else
+        {
+            printf("Usage: cmpbench [-n samples] [-i iterations] [-f capture_file] [-s seed]\n");
+            printf("       cmpbench -d compressed_file > capture_file\n");
+            return (1);
+        }
+    }
+    printf("%-14s %7s %8s %7s %7s %8s%s Mode Result\n", "Signal", "Samples", "Bytes", "Ratio", 
+        "Bits", "ns/samp", get_cycles() ? "  cyc/samp" : "");
+    for (int sig = 0; sig < NUM_SIGS; sig++)
+        fails += !test_signal(sig_names[sig], make_signal(sig, nsamp), iters, sig >= SIG_WIDE);
+    if (fname)
+    {
+        int n = load_file(fname, XSAMP_MAX);
+        if (n > 0)
+            fails += !test_signal(fname, n, iters, false);
+        else
+        {
+            printf("Can't read %s\n", fname);
+            fails++;
+        }
+    }
+    // Small captures, including empty and partial blocks, in all modes
+    for (int n = 0; n <= CMP_BLOCK * 2 + 1; n++)
+    {
+        int len = 0, k, mode = n % 3 == 2 ? CMP_RAW : n % 3 == 1 ? CMP_WIDE : 0;
+        make_signal(n % NUM_SIGS, n);
+        cmp_init(&enc, samps, n, mode);
+        while ((k = cmp_read(&enc, &cmpdata[len], 1)) > 0)
+            len += k;
+        if (len != cmp_size(samps, n, mode) || cmp_decode(cmpdata, len, decoded, n) != n ||
+            memcmp(samps, decoded, n * sizeof(WORD)))
+        {
+            printf("Error: %d samples\n", n);
+            fails++;
+        }
+    }
+    // Truncated data must give an error, in all modes
+    make_signal(0, 100);
+    for (int mode = 0; mode <= CMP_RAW; mode++)
+    {
+        cmp_init(&enc, samps, 100, mode);
+        cmp_read(&enc, cmpdata, sizeof(cmpdata));
+        if (cmp_decode(cmpdata, cmp_size(samps, 100, mode) / 2, decoded, 100) >= 0)
+        {
+            printf("Error: truncated data not detected, mode %d\n", mode);
+            fails++;
+        }
+    }
+    return (test_end(fails));
+}
+
+// EOF
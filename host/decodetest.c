@@ -0,0 +1,436 @@
+// Test & benchmark of the WiCap protocol decoders
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Synthetic UART, SPI and I2C bitstreams are generated, with unrelated
+// activity on other pins, and the decoded bytes & errors are checked.
+// Each test is also decoded in random-sized blocks, as when streaming,
+// which must give the same result as decoding the whole capture.
+// A triggered capture is simulated, using a small ring buffer that is filled
+// in random-sized blocks, to check the trigger position & samples.
+// Then the decoding speed is measured, in millions of samples per second.
+//
+// Usage: decodetest [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../decode.h"
+#include "../trigger.h"
+#include "testutil.h"
+
+#define MAX_SAMPS   1000000
+#define NOISE_PIN   15              // Pin with unrelated activity
+#define SAMP_RATE   1000000
+
+// Triggered capture: ring size, pre-samples, samples, samples after trigger,
+// and maximum block of new samples between trigger polls
+#define TRIG_RING       8192
+#define TRIG_PRE        20
+#define TRIG_NSAMP      3000
+#define TRIG_NPOST      1000
+#define TRIG_MAXBLOCK   2000
+#define TRIG_ARMED      (TRIG_PRE + TRIG_NSAMP - TRIG_NPOST)
+
+WORD samps[MAX_SAMPS];
+int nsamps;
+uint8_t exp_bytes[1000], got_bytes[1000];
+int nexp, ngot, got_errs, nfails;
+double uart_t;
+DECODE_FRAME frames2[DECODE_MAXFRAMES];
+int nframes2;
+
+// Add samples with given pin levels, and noise on another pin
+void add_samps(int pins, int vals, int n)
+{
+    static WORD last;
+
+    for (int i = 0; i < n && nsamps < MAX_SAMPS; i++)
+    {
+        last = (last & ~pins) | (vals & pins);
+        if (rand() % 3 == 0)
+            last ^= 1 << NOISE_PIN;
+        samps[nsamps++] = last;
+    }
+}
+
+// Generate UART byte, with time in 1/256 sample units
+void gen_uart_byte(int pin, double bitlen, uint8_t b, bool stop)
+{
+    int bits = (b << 1) | (stop ? 0x200 : 0);
+
+    uart_t = MAX(uart_t, nsamps);
+    for (int i = 0; i < 10; i++)
+    {
+        uart_t += bitlen;
+        add_samps(1 << pin, (bits >> i) & 1 ? 0xffff : 0, (int)(uart_t + 0.5) - nsamps);
+    }
+}
+
+// Generate SPI transfer
+void gen_spi(int mode, int sck, int dat, int cs, uint8_t *data, int n, int h)
+{
+    int cpol = mode & 2 ? 1 << sck : 0, cpha = mode & 1, pins = (1 << sck) | (1 << dat);
+    int csmask = cs < 16 ? 1 << cs : 0;
+
+    add_samps(pins | csmask, cpol | csmask, h * 2);
+    add_samps(csmask, 0, h);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 7; j >= 0; j--)
+        {
+            int d = (data[i] >> j) & 1 ? 1 << dat : 0;
+            if (!cpha)
+            {
+                add_samps(pins, cpol | d, h);
+                add_samps(pins, (cpol ^ (1 << sck)) | d, h);
+            }
+            else
+            {
+                add_samps(pins, (cpol ^ (1 << sck)) | d, h);
+                add_samps(pins, cpol | d, h);
+            }
+        }
+    }
+    add_samps(pins, cpol, h);
+    add_samps(csmask, csmask, h * 2);
+}
+
+// Generate I2C transfer, with NACK on last byte if required
+void gen_i2c(int scl, int sda, uint8_t *data, int n, bool nack, int h)
+{
+    int c = 1 << scl, d = 1 << sda, pins = c | d;
+
+    add_samps(pins, c | d, h * 2);
+    add_samps(pins, c, h);                  // Start
+    add_samps(pins, 0, h);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 8; j >= 0; j--)
+        {
+            int v = j > 0 ? ((data[i] >> (j - 1)) & 1) : (nack && i == n - 1);
+            add_samps(pins, v ? d : 0, h);
+            add_samps(pins, c | (v ? d : 0), h);
+            add_samps(pins, v ? d : 0, h);
+        }
+    }
+    add_samps(pins, 0, h);
+    add_samps(pins, c, h);                  // Stop
+    add_samps(pins, c | d, h * 2);
+}
+
+// Handler to store frames when decoding in blocks
+void store_frame(DECODER *dp, DECODE_FRAME *fp)
+{
+    if (nframes2 < DECODE_MAXFRAMES)
+        frames2[nframes2++] = *fp;
+}
+
+// Decode the samples, check the results, return number of frames
+int check(char *name, DECODE_CFG *cfgp, int exp_errs)
+{
+    DECODE_FRAME *frames;
+    DECODER dec;
+    int nframes, i, n;
+    bool ok;
+
+    decode_capture(cfgp, samps, nsamps);
+    nframes = decode_get(&frames);
+    ngot = got_errs = 0;
+    for (i = 0; i < nframes; i++)
+    {
+        memcpy(&got_bytes[ngot], frames[i].data, frames[i].nbytes);
+        ngot += frames[i].nbytes;
+        got_errs |= frames[i].errs & DECODE_ERRS;
+    }
+    // Decode again in random-sized blocks
+    nframes2 = 0;
+    decode_init(&dec, cfgp, store_frame);
+    dec.prev = samps[0];
+    for (i = 0; i < nsamps; i += n)
+    {
+        n = 1 + rand() % 1000;
+        n = MIN(n, nsamps - i);
+        decode_samples(&dec, &samps[i], n);
+    }
+    decode_flush(&dec);
+    ok = ngot == nexp && !memcmp(got_bytes, exp_bytes, nexp) && got_errs == exp_errs &&
+         nframes2 == nframes && !memcmp(frames, frames2, nframes * sizeof(DECODE_FRAME));
+    printf("%-22s %7d samples, %3d frames, %4d bytes, errors 0x%02x %s\n", 
+           name, nsamps, nframes, ngot, got_errs, TEST_RESULT(ok));
+    nfails += !ok;
+    return (nframes);
+}
+
+// Find the first frame after the trigger is armed, that starts with the
+// given byte, or has the given error, return its sample number
+uint32_t find_frame(int first, int errs)
+{
+    DECODE_FRAME *frames;
+    int nframes = decode_get(&frames);
+
+    for (int i = 0; i < nframes; i++)
+    {
+        if (frames[i].sample >= TRIG_ARMED && (errs ? (frames[i].errs & errs) != 0 : 
+            !(frames[i].errs & DECODE_FLAG_CONT) && frames[i].data[0] == first))
+            return (frames[i].sample);
+    }
+    return (0);
+}
+
+// Simulate a triggered capture, with samples written to a ring buffer in
+// random-sized blocks; check the trigger position, and the samples around it.
+// If a skip position is given, the decoder falls behind at that sample, and
+// if no trigger is expected, check there isn't one
+void check_trig(char *name, DECODE_CFG *dcp, TRIG_CFG *tcp, int first, int errs, int skip)
+{
+    static WORD ring[TRIG_RING];
+    TRIGGER trig;
+    uint64_t count = 0;
+    uint32_t exp_trig;
+    bool stop = false, ok = false;
+
+    decode_capture(dcp, samps, nsamps);
+    exp_trig = find_frame(first, errs);
+    trig_start(&trig, dcp, tcp, ring, TRIG_RING, TRIG_PRE, TRIG_NSAMP, TRIG_NPOST);
+    while (!stop && count < (uint64_t)nsamps)
+    {
+        int n = 1 + rand() % TRIG_MAXBLOCK;
+        if (skip && count == (uint64_t)skip)
+            n = TRIG_RING + TRIG_MAXBLOCK;
+        else if (skip && count < (uint64_t)skip)
+            n = MIN(n, skip - (int)count);
+        for (int i = 0; i < n && count < (uint64_t)nsamps; i++, count++)
+            ring[count % TRIG_RING] = samps[count];
+        stop = trig_poll(&trig, count) == TRIG_STOP;
+    }
+    if (!exp_trig)
+        ok = !stop && !trig.triggered;
+    else if (stop && trig_end(&trig, count))
+    {
+        uint64_t start = trig.trig + TRIG_NPOST - TRIG_NSAMP;
+        ok = exp_trig && trig.trig == exp_trig &&
+             !memcmp(&ring[TRIG_PRE], &samps[start], TRIG_NSAMP * sizeof(WORD));
+    }
+    printf("%-22s %7d samples, trigger at %6u, expected %6u %s\n", 
+           name, nsamps, (uint)trig.trig, exp_trig, TEST_RESULT(ok));
+    nfails += !ok;
+}
+
+// Generate random bytes, for expected data
+void make_bytes(int n)
+{
+    for (nexp = 0; nexp < n; nexp++)
+        exp_bytes[nexp] = rand();
+}
+
+// Measure decoding speed, using current samples
+void bench(char *name, DECODE_CFG *cfgp)
+{
+    int n = 0;
+    double start = get_secs(), secs;
+
+    do
+    {
+        decode_capture(cfgp, samps, nsamps);
+        n++;
+    } while ((secs = get_secs() - start) < 0.5);
+    printf("%-6s decode speed %.1f Msamples/sec\n", name, n * (double)nsamps / secs / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    DECODE_CFG uart = {.proto=PROTO_UART, .rate=SAMP_RATE, .baud=115200, .pin0=3};
+    DECODE_CFG spi = {.proto=PROTO_SPI, .rate=SAMP_RATE, .pin0=4, .pin1=5, .pin2=6};
+    DECODE_CFG i2c = {.proto=PROTO_I2C, .rate=SAMP_RATE, .pin0=8, .pin1=9};
+    DECODE_CFG bad;
+    DECODE_FRAME *frames;
+    TRIG_CFG tcfg;
+    char name[40];
+    int opt, skip;
+    bool ok;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1)
+    {
+        if (opt == 's')
+            srand(atoi(optarg));
+        else
+        {
+            printf("Usage: decodetest [-s seed]\n");
+            return (1);
+        }
+    }
+    // UART at 2 baud rates, with random gaps between bytes
+    for (int baud = 9600; baud <= 115200; baud *= 12)
+    {
+        nsamps = uart_t = 0;
+        uart.baud = baud;
+        make_bytes(40);
+        add_samps(0xffff, 0xffff, 100);
+        for (int i = 0; i < nexp; i++)
+        {
+            gen_uart_byte(uart.pin0, (double)SAMP_RATE / baud, exp_bytes[i], true);
+            add_samps(0xffff, 0xffff, rand() % 3 ? 0 : rand() % (SAMP_RATE / baud * 4));
+        }
+        add_samps(0xffff, 0xffff, 100);
+        sprintf(name, "UART %d baud", baud);
+        check(name, &uart, 0);
+    }
+    // UART framing error
+    nsamps = uart_t = 0;
+    make_bytes(10);
+    add_samps(0xffff, 0xffff, 100);
+    for (int i = 0; i < nexp; i++)
+    {
+        gen_uart_byte(uart.pin0, (double)SAMP_RATE / uart.baud, exp_bytes[i], i != 5);
+        if (i == 5)
+            add_samps(0xffff, 0xffff, SAMP_RATE / uart.baud * 2);
+    }
+    add_samps(0xffff, 0xffff, 100);
+    check("UART framing error", &uart, DECODE_ERR_FRAMING);
+    // SPI in all 4 modes, with and without chip select
+    for (int mode = 0; mode < 8; mode++)
+    {
+        nsamps = uart_t = 0;
+        spi.mode = mode & 3;
+        spi.pin2 = mode < 4 ? 6 : DECODE_NOPIN;
+        make_bytes(60);
+        for (int i = 0; i < nexp; i += 20)
+            gen_spi(spi.mode, spi.pin0, spi.pin1, spi.pin2, &exp_bytes[i], 20, 3);
+        sprintf(name, "SPI mode %d%s", spi.mode, mode < 4 ? "" : " no CS");
+        check(name, &spi, 0);
+    }
+    // I2C write, and read with NACK on last byte
+    nsamps = uart_t = 0;
+    make_bytes(13);
+    exp_bytes[0] = 0x50 << 1;
+    exp_bytes[10] = (0x50 << 1) | 1;
+    gen_i2c(i2c.pin0, i2c.pin1, exp_bytes, 10, false, 4);
+    gen_i2c(i2c.pin0, i2c.pin1, &exp_bytes[10], 3, true, 4);
+    check("I2C write & read", &i2c, DECODE_ERR_NACK);
+    // Pin numbers out of range are rejected, so nothing is decoded
+    bad = i2c;
+    bad.pin1 = 255;
+    decode_capture(&bad, samps, nsamps);
+    ok = !decode_cfg_valid(&bad) && decode_get(&frames) == 0;
+    bad = spi;
+    bad.pin2 = 16;
+    ok = ok && !decode_cfg_valid(&bad);
+    bad.pin2 = DECODE_NOPIN;
+    ok = ok && decode_cfg_valid(&bad);
+    bad = uart;
+    bad.pin0 = 40;
+    ok = ok && !decode_cfg_valid(&bad);
+    test_check("Invalid pins", ok, &nfails);
+    // Trigger on UART data, with a match before trigger is armed
+    nsamps = uart_t = 0;
+    make_bytes(60);
+    add_samps(0xffff, 0xffff, 100);
+    for (int i = 0; i < nexp; i++)
+    {
+        if (i == 5 || i == 40)
+        {
+            add_samps(0xffff, 0xffff, 50);
+            exp_bytes[i] = 0xa5;
+            exp_bytes[i + 1] = 0x5a;
+        }
+        else if (exp_bytes[i] == 0xa5 && i != 41 && i != 6)
+            exp_bytes[i] = 0;
+        gen_uart_byte(uart.pin0, (double)SAMP_RATE / uart.baud, exp_bytes[i], true);
+    }
+    add_samps(0xffff, 0xffff, TRIG_NPOST + TRIG_MAXBLOCK);
+    tcfg = (TRIG_CFG){.type=TRIG_DATA, .len=2, .data=0xa55a};
+    check_trig("Trigger UART data", &uart, &tcfg, 0xa5, 0, 0);
+    // Trigger on UART framing error
+    nsamps = uart_t = 0;
+    make_bytes(60);
+    add_samps(0xffff, 0xffff, 100);
+    for (int i = 0; i < nexp; i++)
+    {
+        gen_uart_byte(uart.pin0, (double)SAMP_RATE / uart.baud, exp_bytes[i], i != 45);
+        if (i == 45)
+            add_samps(0xffff, 0xffff, 50);
+    }
+    add_samps(0xffff, 0xffff, TRIG_NPOST + TRIG_MAXBLOCK);
+    tcfg = (TRIG_CFG){.type=TRIG_ERROR};
+    check_trig("Trigger UART error", &uart, &tcfg, 0, DECODE_ERR_FRAMING, 0);
+    // Decoder falls behind in the middle of a byte, then catches up; it must
+    // not give an error, and must find data after the skipped samples. There
+    // is a gap longer than a character every 10 bytes, to resynchronise
+    nsamps = uart_t = 0;
+    make_bytes(300);
+    add_samps(0xffff, 0xffff, 100);
+    for (int i = 0; i < nexp; i++)
+    {
+        if (i % 10 == 0)
+            add_samps(0xffff, 0xffff, 100);
+        if (i == 50)
+            skip = nsamps + 3 * SAMP_RATE / uart.baud;
+        if (i == 250)
+        {
+            exp_bytes[i] = 0xa5;
+            exp_bytes[i + 1] = 0x5a;
+        }
+        else if (exp_bytes[i] == 0xa5 && i != 251)
+            exp_bytes[i] = 0;
+        gen_uart_byte(uart.pin0, (double)SAMP_RATE / uart.baud, exp_bytes[i], true);
+    }
+    add_samps(0xffff, 0xffff, TRIG_NPOST + TRIG_MAXBLOCK);
+    tcfg = (TRIG_CFG){.type=TRIG_ERROR};
+    check_trig("Trigger UART skip error", &uart, &tcfg, 0, DECODE_ERR_FRAMING, skip);
+    tcfg = (TRIG_CFG){.type=TRIG_DATA, .len=2, .data=0xa55a};
+    check_trig("Trigger UART skip data", &uart, &tcfg, 0xa5, 0, skip);
+    // Trigger on I2C address, with a match before trigger is armed
+    nsamps = uart_t = 0;
+    for (int i = 0; i < 12; i++)
+    {
+        make_bytes(4);
+        exp_bytes[0] = (i == 0 || i == 8 ? 0x50 : 0x20) << 1;
+        gen_i2c(i2c.pin0, i2c.pin1, exp_bytes, 4, false, 4);
+    }
+    add_samps(0xffff, 0xffff, TRIG_NPOST + TRIG_MAXBLOCK);
+    tcfg = (TRIG_CFG){.type=TRIG_ADDR, .data=0x50};
+    check_trig("Trigger I2C address", &i2c, &tcfg, 0x50 << 1, 0, 0);
+    // Speed, using long captures
+    nsamps = uart_t = 0;
+    make_bytes(1000);
+    for (int i = 0; i < nexp; i++)
+        gen_uart_byte(uart.pin0, (double)SAMP_RATE / uart.baud, exp_bytes[i], true);
+    bench("UART", &uart);
+    nsamps = uart_t = 0;
+    spi.mode = 0;
+    spi.pin2 = 6;
+    for (int i = 0; i < nexp; i += 20)
+        gen_spi(0, spi.pin0, spi.pin1, spi.pin2, &exp_bytes[i], 20, 4);
+    bench("SPI", &spi);
+    nsamps = uart_t = 0;
+    for (int i = 0; i < nexp; i += 20)
+        gen_i2c(i2c.pin0, i2c.pin1, &exp_bytes[i], 20, false, 4);
+    bench("I2C", &i2c);
+    return (test_end(nfails));
+}
+
+// EOF
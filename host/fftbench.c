@@ -0,0 +1,205 @@
+// Accuracy test & benchmark of the WiCap fixed-point FFT
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The Q15 FFT (fft.c) is compared with a double-precision FFT of the same
+// windowed input, for each number of points from FFT_MIN_N to FFT_MAX_N.
+// Test signals are a sine wave at a bin centre, a sine wave between bins,
+// two tones with random noise, and a full-scale square wave; the digital
+// input bits are set randomly, to check they are masked off.
+// The errors are shown as the maximum difference in magnitude units, and
+// the signal-to-error ratio (peak magnitude / rms error) in dB. The timing
+// is the average time per transform on this host, including the window.
+//
+// Usage: fftbench [-n iterations] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "../fft.h"
+#include "testutil.h"
+
+#define MAX_ERR         16          // Max error (1 ADC unit) for OK result
+#define MIN_SNR         60.0        // Minimum signal/error ratio (dB)
+#define NUM_SIGS        4
+
+const char *sig_names[NUM_SIGS] = {"sine", "sine_offbin", "tones_noise", "square"};
+WORD samps[FFT_MAX_N];
+uint16_t mags[FFT_MAX_N / 2];
+double ref_re[FFT_MAX_N], ref_im[FFT_MAX_N], ref_mags[FFT_MAX_N / 2];
+int fftn = FFT_MIN_N, favg = 1;
+
+// Parameter values, normally in picocap.c
+int get_param_int(SERVER_ARG_NUM n)
+{
+    return (n == ARG_FFTN ? fftn : n == ARG_FAVG ? favg : 0);
+}
+
+// Generate test signal, with random digital bits
+void make_signal(int sig, int n)
+{
+    if (sig == 0)
+        test_sine(samps, n, 1.0 / 8, 400, 0, true);
+    else if (sig == 1)
+        test_sine(samps, n, (n / 8 + 0.37) / n, 400, 0, true);
+    else
+    {
+        for (int i = 0; i < n; i++)
+        {
+            double t = (double)i / n;
+            double v = sig == 2 ? 300 * sin(2 * M_PI * t * n / 16) + 
+                50 * sin(2 * M_PI * t * n / 5.3) + (rand() % 9) - 4 : (i / 32) & 1 ? 511 : -512;
+            samps[i] = test_sample(v, test_digital());
+        }
+    }
+}
+
+// Double-precision complex FFT, in-place, radix-2
+void ref_fft(double *re, double *im, int n)
+{
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        double ang = -2 * M_PI / len;
+        for (int i = 0; i < n; i += len)
+        {
+            for (int k = 0; k < len / 2; k++)
+            {
+                double wr = cos(ang * k), wi = sin(ang * k);
+                double *ar = &re[i+k], *ai = &im[i+k], *br = &re[i+k+len/2], *bi = &im[i+k+len/2];
+                double tr = *br * wr - *bi * wi, ti = *br * wi + *bi * wr;
+                *br = *ar - tr;
+                *bi = *ai - ti;
+                *ar += tr;
+                *ai += ti;
+            }
+        }
+    }
+}
+
+// Reference magnitudes, with same window & scaling as fixed-point version
+void ref_mags_calc(int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        double w = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+        ref_re[i] = ((samps[i] & ANALOG_MASK) - ANALOG_ZERO) * (1 << FFT_INSHIFT) * w;
+        ref_im[i] = 0;
+    }
+    ref_fft(ref_re, ref_im, n);
+    for (int k = 0; k < n / 2; k++)
+        ref_mags[k] = sqrt(ref_re[k] * ref_re[k] + ref_im[k] * ref_im[k]) / (n / 2);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, iters = 100, fails = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        if (opt == 'n')
+            iters = MAX(1, atoi(optarg));
+        else if (opt == 's')
+            srand(atoi(optarg));
+        else
+        {
+            printf("Usage: fftbench [-n iterations] [-s seed]\n");
+            return (1);
+        }
+    }
+    fft_init();
+    printf("%5s %-12s %8s %8s %8s %8s %10s\n", "N", "Signal", "Peak", "MaxErr", "SNR_dB", "Result", "usec/FFT");
+    for (int n = FFT_MIN_N; n <= FFT_MAX_N; n *= 2)
+    {
+        for (int sig = 0; sig < NUM_SIGS; sig++)
+        {
+            double peak = 0, maxerr = 0, sumsq = 0, snr, start, usec = 0;
+            bool ok;
+
+            make_signal(sig, n);
+            ref_mags_calc(n);
+            fft_mags(samps, n, mags, 1);
+            for (int k = 0; k < n / 2; k++)
+            {
+                double err = fabs(mags[k] - ref_mags[k]);
+                peak = MAX(peak, ref_mags[k]);
+                maxerr = MAX(maxerr, err);
+                sumsq += err * err;
+            }
+            snr = 20 * log10(peak / MAX(sqrt(sumsq / (n / 2)), 1e-9));
+            ok = maxerr <= MAX_ERR && snr >= MIN_SNR;
+            fails += !ok;
+            if (sig == 0)
+            {
+                start = get_secs();
+                for (int i = 0; i < iters; i++)
+                    fft_mags(samps, n, mags, 1);
+                usec = (get_secs() - start) * 1e6 / iters;
+            }
+            printf("%5d %-12s %8.1f %8.1f %8.1f %8s", n, sig_names[sig], peak, maxerr, snr, TEST_RESULT(ok));
+            if (sig == 0)
+                printf(" %10.1f", usec);
+            printf("\n");
+        }
+    }
+    // Averaging: same signal repeated should give the same spectrum
+    fftn = 1024;
+    favg = 4;
+    make_signal(0, fftn);
+    fft_mags(samps, fftn, mags, 1);
+    {
+        uint16_t *avgs, first[FFT_MAX_N / 2];
+        int nbins, diffs = 0;
+        bool ok;
+
+        memcpy(first, mags, sizeof(first));
+        spectrum_reset();
+        for (int i = 0; i < 10; i++)
+            nbins = spectrum_update(samps, fftn);
+        nbins = spectrum_get(&avgs);
+        for (int k = 0; k < nbins; k++)
+            diffs += avgs[k] != first[k];
+        ok = nbins == fftn / 2 && !diffs;
+        printf("Averaging: %d bins, %d differences %s\n", nbins, diffs, TEST_RESULT(ok));
+        fails += !ok;
+    }
+    return (test_end(fails));
+}
+
+// EOF
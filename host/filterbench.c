@@ -0,0 +1,207 @@
+// Test & benchmark of the WiCap analog filters
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// For each filter type and decimation factor, the tests are:
+// DC:     a constant input (with random digital bits) must give a constant
+//         output, scaled to 16 bits, after the start-up transient
+// Blocks: filtering in random-sized blocks must match the whole capture
+// ENOB:   a sine wave with random noise is filtered, a sine wave is fitted to
+//         the output, and the effective number of bits is calculated from
+//         the residual error; this must increase with decimation.
+// FIR:    a sine wave above the output Nyquist frequency must be attenuated
+// The timing is the input sample rate this host can handle, in millions of
+// samples per second. On the target, see the filter time in /profile.json.
+//
+// Usage: filterbench [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "../filter.h"
+#include "testutil.h"
+
+#define NSAMP           65536       // Number of input samples
+#define SIG_FREQ        0.02        // Sine frequency, relative to output rate
+#define SIG_AMPL        400.0       // Sine amplitude, and noise (ADC units)
+#define SIG_NOISE       3.0
+#define DC_VAL          500         // DC input value
+#define MIN_ENOB_GAIN   1.5         // Min gain in ENOB from 1 to 16x decimation
+#define MIN_FIR_ATTEN   40.0        // Min FIR stop-band attenuation (dB)
+
+const char *filt_names[NUM_FILTS] = {"none", "boxcar", "cic", "fir"};
+WORD samps[NSAMP], inbuff[NSAMP];
+uint16_t outs[NSAMP], outs2[NSAMP];
+int nfails;
+
+// Fit sine wave of known frequency to output values (least-squares fit of
+// sine, cosine & offset), ignoring start-up, return rms error
+double fit_sine(uint16_t *vals, int n, double freq)
+{
+    double s[3][3] = {{0}}, r[3] = {0}, c[3], resid = 0;
+    int skip = FILT_MAXTAPS, count = n - skip;
+
+    for (int i = skip; i < n; i++)
+    {
+        double b[3] = {sin(2 * M_PI * freq * i), cos(2 * M_PI * freq * i), 1};
+        for (int j = 0; j < 3; j++)
+        {
+            r[j] += b[j] * vals[i];
+            for (int k = 0; k < 3; k++)
+                s[j][k] += b[j] * b[k];
+        }
+    }
+    // Solve 3x3 equations by Gaussian elimination
+    for (int j = 0; j < 3; j++)
+    {
+        for (int k = j + 1; k < 3; k++)
+        {
+            double m = s[k][j] / s[j][j];
+            for (int l = j; l < 3; l++)
+                s[k][l] -= m * s[j][l];
+            r[k] -= m * r[j];
+        }
+    }
+    for (int j = 2; j >= 0; j--)
+    {
+        c[j] = r[j];
+        for (int k = j + 1; k < 3; k++)
+            c[j] -= s[j][k] * c[k];
+        c[j] /= s[j][j];
+    }
+    for (int i = skip; i < n; i++)
+    {
+        double e = vals[i] - (c[0] * sin(2 * M_PI * freq * i) + c[1] * cos(2 * M_PI * freq * i) + c[2]);
+        resid += e * e;
+    }
+    return (sqrt(resid / count));
+}
+
+// Return AC rms value of output, ignoring start-up
+double ac_rms(uint16_t *vals, int n)
+{
+    double sum = 0, sumsq = 0;
+    int skip = FILT_MAXTAPS, count = n - skip;
+
+    for (int i = skip; i < n; i++)
+    {
+        sum += vals[i];
+        sumsq += (double)vals[i] * vals[i];
+    }
+    return (sqrt(MAX(0, sumsq / count - (sum / count) * (sum / count))));
+}
+
+// Filter input samples, return number of outputs
+int filter_run(FILTER *fp, int type, int dec, uint16_t *out)
+{
+    filter_init(fp, type, dec, FILT_DEFTAPS);
+    memcpy(inbuff, samps, sizeof(inbuff));
+    return (filter_block(fp, inbuff, NSAMP, out));
+}
+
+int main(int argc, char *argv[])
+{
+    FILTER filt;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1)
+    {
+        if (opt == 's')
+            srand(atoi(optarg));
+        else
+        {
+            printf("Usage: filterbench [-s seed]\n");
+            return (1);
+        }
+    }
+    printf("%-7s %4s %6s %6s %6s %8s %8s\n", "Filter", "Dec", "DC", "Blocks", "ENOB", "Msamp/s", "Result");
+    for (int type = FILT_BOXCAR; type < NUM_FILTS; type++)
+    {
+        double enob1 = 0;
+        for (int dec = 1; dec <= FILT_MAXDEC; dec *= 4)
+        {
+            int n, n2 = 0, i, dcerrs = 0, blockerrs = 0, iters = 0;
+            double rms, enob, start, secs;
+            bool ok;
+
+            // DC, with random digital bits
+            for (i = 0; i < NSAMP; i++)
+                samps[i] = test_sample(DC_VAL - ANALOG_ZERO, test_digital());
+            n = filter_run(&filt, type, dec, outs);
+            for (i = FILT_MAXTAPS; i < n; i++)
+                dcerrs += outs[i] != DC_VAL << (FILT_OUTBITS - ANALOG_BITS);
+            // Sine with noise, check ENOB
+            test_sine(samps, NSAMP, SIG_FREQ / dec, SIG_AMPL, SIG_NOISE, true);
+            n = filter_run(&filt, type, dec, outs);
+            rms = fit_sine(outs, n, SIG_FREQ) / (1 << (FILT_OUTBITS - ANALOG_BITS));
+            enob = ANALOG_BITS - log2(rms * sqrt(12));
+            if (dec == 1)
+                enob1 = enob;
+            // Same input in random-sized blocks, in place
+            filter_init(&filt, type, dec, FILT_DEFTAPS);
+            memcpy(inbuff, samps, sizeof(inbuff));
+            for (i = 0; i < NSAMP; )
+            {
+                int len = 1 + rand() % 1000;
+                len = MIN(len, NSAMP - i);
+                n2 += filter_block(&filt, &inbuff[i], len, &outs2[n2]);
+                i += len;
+            }
+            blockerrs = n2 != n || memcmp(outs, outs2, n * sizeof(uint16_t));
+            // Speed
+            start = get_secs();
+            do
+            {
+                filter_run(&filt, type, dec, outs2);
+                iters++;
+            } while ((secs = get_secs() - start) < 0.2);
+            ok = !dcerrs && !blockerrs && n == NSAMP / dec &&
+                 (dec < 16 || enob > enob1 + MIN_ENOB_GAIN);
+            printf("%-7s %4d %6s %6s %6.2f %8.1f %8s\n", filt_names[type], dec, TEST_RESULT(!dcerrs),
+                   TEST_RESULT(!blockerrs), enob, iters * (double)NSAMP / secs / 1e6, TEST_RESULT(ok));
+            nfails += !ok;
+        }
+    }
+    // FIR stop-band: sine at 1.5 times the output Nyquist frequency
+    for (int dec = 2; dec <= FILT_MAXDEC; dec *= 4)
+    {
+        int n;
+        double atten;
+        bool ok;
+
+        test_sine(samps, NSAMP, 0.75 / dec, SIG_AMPL, 0, true);
+        n = filter_run(&filt, FILT_FIR, dec, outs);
+        atten = 20 * log10(SIG_AMPL / sqrt(2) / MAX(ac_rms(outs, n) / (1 << (FILT_OUTBITS - ANALOG_BITS)), 1e-3));
+        ok = atten >= MIN_FIR_ATTEN;
+        printf("FIR decimation %3d, stop-band attenuation %.1f dB %s\n", dec, atten, TEST_RESULT(ok));
+        nfails += !ok;
+    }
+    return (test_end(nfails));
+}
+
+// EOF
@@ -0,0 +1,239 @@
+// Test & benchmark of streaming gzip compression
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Test data is compressed by the streaming gzip encoder (gz.c) in chunks, as
+// the web server would, and decompressed by zlib to check it matches the
+// input; this is done with random chunk sizes, then the normal size, which
+// should give the precomputed length. The data is:
+// base64 text of sample data (as /data.txt) for a sine wave with a logic
+// counter, and for random samples, a JSON status string, and random bytes.
+// Base64 text uses the base64 code table, the rest use the fixed codes.
+// The output shows the compressed size as a percentage of the input, the
+// zlib (level 6) size for comparison, with its normal 32K window, and with
+// the same window as the encoder, and the encoder time per byte.
+// Base64 output must not exceed the size with literals only, so a match
+// must never cost more than the literals it replaces.
+//
+// Usage: gzbench [-n samples] [-i iterations] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "../gz.h"
+#include "testutil.h"
+
+#define NUM_TESTS       4
+#define MAX_INLEN       (XSAMP_MAX * 3)
+#define GZ_WBITS        10          // Log2 of encoder window size
+
+const char *test_names[NUM_TESTS] = {"base64_sine", "base64_random", "json_status", "random"};
+const char b64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+uint8_t indata[MAX_INLEN], outdata[MAX_INLEN * 2], checkdata[MAX_INLEN];
+WORD samps[XSAMP_MAX];
+GZ_ENC enc;
+
+// Encode data as base64, return length
+int base64(uint8_t *inp, int len, uint8_t *outp)
+{
+    int n = 0;
+
+    for (int i = 0; i < len; i += 3)
+    {
+        uint32_t v = inp[i] << 16 | (i + 1 < len ? inp[i + 1] << 8 : 0) | (i + 2 < len ? inp[i + 2] : 0);
+        for (int j = 0; j < 4; j++)
+            outp[n++] = j <= len - i ? b64_chars[(v >> (18 - j * 6)) & 0x3f] : '=';
+    }
+    return (n);
+}
+
+// Return Huffman table mode for test data
+GZ_MODE test_mode(int test)
+{
+    return (test <= 1 ? GZ_BASE64 : GZ_FIXED);
+}
+
+// Generate test data, return length
+int make_data(int test, int nsamp)
+{
+    int n = 0;
+
+    if (test <= 1)
+    {
+        for (int i = 0; i < nsamp; i++)
+        {
+            samps[i] = test == 0 ? test_sample(400 * sin(2 * M_PI * i / 10.0), ((i / 16) & 0x3f) << ANALOG_BITS) :
+                                   test_sample((rand() & ANALOG_MASK) - ANALOG_ZERO, 0);
+        }
+        n = base64((uint8_t *)samps, nsamp * 2, indata);
+    }
+    else if (test == 2)
+    {
+        n = snprintf((char *)indata, MAX_INLEN, "{\"state\":1,\"nsamp\":%d,\"speed\":0,"
+            "\"tstart\":12345678,\"tend\":12445678,\"arate\":10000,\"overruns\":0,\"pcount\":0,"
+            "\"mpass\":0,\"mfail\":0,\"cmd\":0,\"xsamp\":%d,\"xrate\":10000,\"profile\":0,"
+            "\"fftn\":1024,\"favg\":1,\"dproto\":0,\"dbaud\":9600,\"dpin0\":0,\"dpin1\":1,"
+            "\"dpin2\":255,\"dmode\":0,\"ttype\":0,\"tdata\":0,\"tlen\":1,\"tpost\":500,"
+            "\"filter\":0,\"fdec\":4,\"ftaps\":32,\"pers\":0,\"pdiv\":1,\"plevel\":512,"
+            "\"mask\":0,\"security\":\"\",\"ssid\":\"testnet\",\"passwd\":\"\",\"unit\":1,"
+            "\"ip_base\":\"0.0.0.0\",\"gateway\":\"0.0.0.0\"}", nsamp, nsamp);
+    }
+    else
+    {
+        for (n = 0; n < nsamp * 2; n++)
+            indata[n] = (uint8_t)rand();
+    }
+    return (n);
+}
+
+// Compress data in chunks (random size if not specified), return output length
+int compress_data(GZ_MODE mode, int len, int chunksize)
+{
+    int n = 0, pos = 0;
+
+    gz_init(&enc, mode);
+    do
+    {
+        int chunk = chunksize ? chunksize : 1 + rand() % GZ_CHUNK;
+        chunk = MIN(len - pos, chunk);
+        n += gz_compress(&enc, &indata[pos], chunk, pos + chunk == len, &outdata[n]);
+        pos += chunk;
+    } while (pos < len);
+    return (n);
+}
+
+// Decompress gzip data using zlib, return length, -1 if error
+int zlib_decompress(uint8_t *inp, int inlen, uint8_t *outp, int maxlen)
+{
+    z_stream zs = {.next_in=inp, .avail_in=inlen, .next_out=outp, .avail_out=maxlen};
+    int n = -1;
+
+    if (inflateInit2(&zs, 16 + MAX_WBITS) == Z_OK)
+    {
+        if (inflate(&zs, Z_FINISH) == Z_STREAM_END)
+            n = zs.total_out;
+        inflateEnd(&zs);
+    }
+    return (n);
+}
+
+// Return zlib compressed size, for comparison, given log2 of window size
+int zlib_size(int len, int wbits)
+{
+    z_stream zs = {.next_in=indata, .avail_in=len, .next_out=checkdata, .avail_out=sizeof(checkdata)};
+    int n = -1;
+
+    if (deflateInit2(&zs, 6, Z_DEFLATED, wbits, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+        if (deflate(&zs, Z_FINISH) == Z_STREAM_END)
+            n = zs.total_out;
+        deflateEnd(&zs);
+    }
+    return (n);
+}
+
+// Return max size of base64 text with literal codes only: 6 bits for most
+// chars, 7 bits for '+' & '/', 13 bits for '=', plus header & trailer
+int literal_size(int len)
+{
+    int nbits = 0;
+
+    for (int i = 0; i < len; i++)
+        nbits += indata[i] == '=' ? 13 : indata[i] == '+' || indata[i] == '/' ? 7 : 6;
+    return ((nbits + 13 + 7) / 8 + GZ_HDR_LEN + GZ_DYN_HDR_MAX + GZ_TRL_LEN);
+}
+
+// Compress & check test data, print results, return false if error
+bool test_data(int test, int nsamp, int iters)
+{
+    GZ_MODE mode = test_mode(test);
+    int len = make_data(test, nsamp), size = gz_size(&enc, mode, indata, len);
+    int zsize = zlib_size(len, MAX_WBITS), wsize = zlib_size(len, GZ_WBITS), n, dlen;
+    double start, nsecs;
+    bool ok;
+
+    n = compress_data(mode, len, 0);
+    dlen = zlib_decompress(outdata, n, checkdata, sizeof(checkdata));
+    ok = dlen == len && !memcmp(indata, checkdata, len);
+    n = compress_data(mode, len, GZ_CHUNK);
+    dlen = zlib_decompress(outdata, n, checkdata, sizeof(checkdata));
+    ok = ok && n == size && dlen == len && !memcmp(indata, checkdata, len);
+    ok = ok && (mode != GZ_BASE64 || n <= literal_size(len));
+    start = get_secs();
+    for (int i = 0; i < iters; i++)
+        gz_size(&enc, mode, indata, len);
+    nsecs = (get_secs() - start) * 1e9 / ((double)iters * MAX(len, 1));
+    printf("%-14s %-6s %8d %8d %7.1f %7.1f %7.1f %8.2f %s\n", test_names[test], 
+        mode == GZ_BASE64 ? "base64" : "fixed", len, n, 100.0 * n / MAX(len, 1),
+        100.0 * zsize / MAX(len, 1), 100.0 * wsize / MAX(len, 1), nsecs, TEST_RESULT(ok));
+    return (ok);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, nsamp = 10000, iters = 20, fails = 0;
+
+    while ((opt = getopt(argc, argv, "n:i:s:")) != -1)
+    {
+        if (opt == 'n')
+            nsamp = MIN(MAX(1, atoi(optarg)), XSAMP_MAX);
+        else if (opt == 'i')
+            iters = MAX(1, atoi(optarg));
+        else if (opt == 's')
+            srand(atoi(optarg));
+        else
+        {
+            printf("Usage: gzbench [-n samples] [-i iterations] [-s seed]\n");
+            return (1);
+        }
+    }
+    printf("%-14s %-6s %8s %8s %7s %7s %7s %8s Result\n", "Data", "Codes", "Bytes", "Gzip", "Gzip%", 
+        "Zlib%", "ZlibW%", "ns/byte");
+    for (int test = 0; test < NUM_TESTS; test++)
+        fails += !test_data(test, nsamp, iters);
+    // Small inputs, including empty, with both code tables
+    for (int len = 0; len <= (GZ_CHUNK + 2) * 2; len++)
+    {
+        GZ_MODE mode = len & 1 ? GZ_BASE64 : GZ_FIXED;
+        int n;
+        for (int i = 0; i < len; i++)
+            indata[i] = "ab+ab=\x80"[rand() % 7];
+        n = compress_data(mode, len, GZ_CHUNK);
+        if (n != gz_size(&enc, mode, indata, len) || 
+            zlib_decompress(outdata, n, checkdata, sizeof(checkdata)) != len || 
+            memcmp(indata, checkdata, len))
+        {
+            printf("Error: %d bytes\n", len);
+            fails++;
+        }
+    }
+    return (test_end(fails));
+}
+
+// EOF
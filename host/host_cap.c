@@ -0,0 +1,246 @@
+// WiCap host build: simulated capture hardware
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The capture API is the same as picocap.c, but samples are produced at the
+// current sample rate, using the wall-clock time since the capture started.
+// They are taken from a synthetic signal generator, or a recorded file of
+// 16-bit values (file name in environment variable WICAP_CAPFILE)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "host_cap.h"
+#include "../picowi/picowi_defs.h"
+#include "../picowi/picowi_trace.h"
+#include "../picocap.h"
+
+extern uint config_flash_oset;
+
+WORD *cap_destp, *cap_file_data;
+int cap_total, cap_done, cap_file_len;
+uint64_t cap_start_usec, cap_sample_count, cap_ring_done;
+bool cap_running, cap_ring;
+uint8_t host_flash[HOST_FLASH_SIZE];
+
+// Return microsecond time
+uint64_t host_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+// Return microsecond time, as used by picowi
+uint32_t ustime(void)
+{
+    return ((uint32_t)host_usec());
+}
+
+// Load recorded samples from file, return count
+int cap_file_load(char *fname)
+{
+    FILE *fp = fopen(fname, "rb");
+    long len;
+
+    if (!fp)
+    {
+        printf("Can't open %s\n", fname);
+        return (0);
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp) / 2;
+    fseek(fp, 0, SEEK_SET);
+    if (len > 0 && (cap_file_data = malloc(len * 2)) != 0)
+        len = fread(cap_file_data, 2, len, fp);
+    else
+        len = 0;
+    fclose(fp);
+    printf("Loaded %ld samples from %s\n", len, fname);
+    return (len);
+}
+
+// Load configuration sector of simulated flash from file
+void flash_load(void)
+{
+    FILE *fp = fopen(HOST_FLASH_FNAME, "rb");
+
+    memset(host_flash, 0xff, sizeof(host_flash));
+    if (fp)
+    {
+        if (fread(&host_flash[config_flash_oset], 1, FLASH_SECTOR_SIZE, fp) != FLASH_SECTOR_SIZE)
+            memset(&host_flash[config_flash_oset], 0xff, FLASH_SECTOR_SIZE);
+        fclose(fp);
+    }
+}
+
+// Initialise simulated capture
+void cap_init(void)
+{
+    char *fname = getenv(HOST_CAPFILE_ENV);
+
+    if (fname)
+        cap_file_len = cap_file_load(fname);
+    config_flash_oset = flash_size() - FLASH_SECTOR_SIZE;
+    flash_load();
+}
+
+// Initialise PIO for data capture (not needed)
+void cap_pio_init(void)
+{
+}
+
+// Initialise capture clock pulse output (not needed)
+void cap_pout_init(int pin, int freq) 
+{
+}
+
+// Set capture frequency (not needed, rate is taken from parameter)
+void cap_pout_freq(int pin, int freq)
+{
+}
+
+// Return a sample value, given overall sample number
+WORD cap_sample(uint64_t n)
+{
+    double t;
+    int analog, digital;
+
+    if (cap_file_len > 0)
+        return (cap_file_data[n % cap_file_len]);
+    t = (double)n / get_param_int(ARG_XRATE);
+    analog = SIM_ZERO + (int)(SIM_AMPLITUDE * sin(2 * M_PI * SIM_FREQ * t));
+    digital = (int)(t * SIM_FREQ * 2);
+    return ((WORD)(analog | (digital << SIM_ANALOG_BITS)));
+}
+
+// Start a capture
+void cap_start(void *destp, int nsamp)
+{
+    cap_dma_start(destp, nsamp, false);
+}
+
+// Start a continuous capture into a ring buffer
+void cap_ring_start(void *destp, int nsamp)
+{
+    cap_dma_start(destp, nsamp, true);
+}
+
+// Start simulated capture, single or continuous
+void cap_dma_start(void *destp, int nsamp, bool ring)
+{
+    cap_destp = (WORD *)destp;
+    cap_total = nsamp;
+    cap_done = 0;
+    cap_ring = ring;
+    cap_ring_done = 0;
+    cap_start_usec = host_usec();
+    cap_running = true;
+    TRACE(TRACE_DMA_START, 0, 0, nsamp, 0);
+}
+
+// Return total number of samples in a ring capture, adding samples up to
+// the current time
+uint64_t cap_ring_count(void)
+{
+    uint64_t n = (host_usec() - cap_start_usec) * get_param_int(ARG_XRATE) / 1000000;
+
+    while (cap_ring && cap_running && cap_ring_done < n)
+        cap_destp[cap_ring_done++ % cap_total] = cap_sample(cap_sample_count++);
+    return (cap_ring_done);
+}
+
+// Check progress of capture, adding samples up to the current time
+// A ring capture continues until stopped, the count is of samples in the ring
+bool cap_capturing(void)
+{
+    uint64_t dt = host_usec() - cap_start_usec;
+    int n = cap_running ? (int)MIN(dt * get_param_int(ARG_XRATE) / 1000000, (uint64_t)cap_total) : cap_done;
+    int rem, nsamp;
+
+    if (cap_ring)
+    {
+        nsamp = (int)MIN(cap_ring_count(), (uint64_t)cap_total) - XSAMP_PRE;
+        set_param_int(ARG_NSAMP, nsamp<0 ? 0 : nsamp);
+        return (cap_running);
+    }
+    while (cap_done < n)
+        cap_destp[cap_done++] = cap_sample(cap_sample_count++);
+    rem = cap_total - cap_done;
+    nsamp = cap_total - rem - XSAMP_PRE;
+    set_param_int(ARG_NSAMP, nsamp<0 ? 0 : nsamp);
+    return (cap_running && rem > 0);
+}
+
+// End a capture, set timing values if it was completed
+// The simulated capture is exact, so end time is calculated from the rate
+void cap_end(void)
+{
+    int rate = get_param_int(ARG_XRATE);
+    uint64_t n = cap_ring_count();
+
+    if (cap_ring && cap_running && rate > 0)
+        cap_set_timing(cap_start_usec, cap_start_usec + n * 1000000 / rate, n, rate);
+    else if (cap_running && cap_done == cap_total && rate > 0)
+        cap_set_timing(cap_start_usec, cap_start_usec + (uint64_t)cap_total * 1000000 / rate,
+                       cap_total, rate);
+    cap_running = cap_ring = false;
+    TRACE(TRACE_DMA_END, 0, 0, get_param_int(ARG_NSAMP), 0);
+}
+
+// Set or clear the capture LED (not needed)
+void cap_set_led(bool on) 
+{
+}
+
+// Return size of simulated flash memory
+uint flash_size(void) 
+{
+    return (HOST_FLASH_SIZE);
+}
+
+// Erase & write a single sector of simulated flash
+// If it is the configuration sector, save it to file
+void flash_sector_write(uint oset, void *data, int dlen)
+{
+    FILE *fp;
+
+    memset(&host_flash[oset], 0xff, FLASH_SECTOR_SIZE);
+    memcpy(&host_flash[oset], data, dlen);
+    if (oset == config_flash_oset && (fp = fopen(HOST_FLASH_FNAME, "wb")) != 0)
+    {
+        fwrite(&host_flash[oset], 1, FLASH_SECTOR_SIZE, fp);
+        fclose(fp);
+    }
+}
+
+// Return pointer to simulated flash sector, given offset
+void *flash_sector_ptr(uint oset)
+{
+    return (&host_flash[oset]);
+}
+
+// EOF
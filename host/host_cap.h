@@ -0,0 +1,44 @@
+// Definitions for WiCap host build, with simulated capture hardware
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <sys/types.h>
+#include <stdint.h>
+
+// Simulated flash memory
+#define FLASH_SECTOR_SIZE   4096
+#define FLASH_PAGE_SIZE     256
+#define HOST_FLASH_SIZE     (2 * 1024 * 1024)
+#define HOST_FLASH_FNAME    "wicap_flash.bin"   // File for configuration sector
+
+// Environment variable with name of recorded sample file (16-bit values)
+// If not set, a synthetic signal is generated
+#define HOST_CAPFILE_ENV    "WICAP_CAPFILE"
+
+// Synthetic signal: analog sine wave on 10 bits, digital counter on upper bits
+#define SIM_FREQ            1000    // Signal frequency (Hz)
+#define SIM_ZERO            512     // Analog zero value
+#define SIM_AMPLITUDE       400     // Analog amplitude
+#define SIM_ANALOG_BITS     10      // Number of analog bits
+
+uint64_t host_usec(void);
+
+// EOF
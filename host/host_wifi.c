@@ -0,0 +1,67 @@
+// WiCap host build: WiFi functions, replaced by host network interface
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Mongoose uses the host TCP/IP stack (sockets), so there is no WiFi
+// interface; these functions just keep the application code unchanged
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picowi/picowi_join.h"
+
+int wifi_profile_num;
+
+// Set or clear the WiFi LED (not needed)
+void wifi_set_led(bool on)
+{
+}
+
+// Check network link, always up
+int link_check(void)
+{
+    return (1);
+}
+
+// Return number of network join retries, always 0
+int join_retries(void)
+{
+    return (0);
+}
+
+// Select WiFi power/performance profile (only the number is stored)
+bool wifi_set_profile(int n)
+{
+    bool ok = n>=0 && n<NUM_WIFI_PROFILES;
+
+    if (ok)
+        wifi_profile_num = n;
+    return (ok);
+}
+
+// Return current WiFi profile number
+int wifi_get_profile(void)
+{
+    return (wifi_profile_num);
+}
+
+// EOF
@@ -0,0 +1,211 @@
+// Mongoose driver using a packet pipe, with link model
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Ethernet frames are passed between 2 Mongoose TCP/IP interfaces in the
+// same process, with a given latency, bandwidth and loss. Time is simulated,
+// so results are reproducible; the caller advances the clock.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../mongoose.h"
+#include "mg_pipe.h"
+#include "../picowi/picowi_trace.h"
+
+// Offsets in Ethernet / IPv4 / TCP frame
+#define ETH_TYPE_OSET   12
+#define ETH_HDR_LEN     14
+#define IP_PROTO_TCP    6
+
+#ifndef MIN
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a)>(b))?(a):(b))
+#endif
+
+uint64_t pipe_now_usec;
+
+// Return current time (usec)
+uint64_t pipe_usec(void)
+{
+    return (pipe_now_usec);
+}
+
+// Set current time (usec)
+void pipe_set_usec(uint64_t usec)
+{
+    pipe_now_usec = usec;
+}
+
+// Initialise pipe, port 0 transmits on direction 0, port 1 on direction 1
+void pipe_init(PIPE *pp, PIPE_LINK *lp)
+{
+    memset(pp, 0, sizeof(PIPE));
+    for (int i = 0; i < 2; i++)
+    {
+        pp->dirs[i].link = lp;
+        pp->dirs[i].rand = lp->seed + i + 1;
+        pp->ports[i].tx = &pp->dirs[i];
+        pp->ports[i].rx = &pp->dirs[i ^ 1];
+    }
+}
+
+// Return pseudo-random number (xorshift)
+static uint32_t pipe_rand(PIPE_DIR *dp)
+{
+    uint32_t x = dp->rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (dp->rand = x);
+}
+
+// Count TCP retransmissions, i.e. data sent that is below highest sequence number
+// Assumes a single TCP connection in each direction
+static void pipe_tcp_check(PIPE_DIR *dp, const uint8_t *data, int len)
+{
+    const uint8_t *ip = &data[ETH_HDR_LEN], *tcp;
+    uint32_t seq, end;
+    int iphdr, tcphdr, dlen;
+
+    if (len < ETH_HDR_LEN + 40 || data[ETH_TYPE_OSET] != 0x08 || 
+        data[ETH_TYPE_OSET+1] != 0x00 || ip[9] != IP_PROTO_TCP)
+        return;
+    iphdr = (ip[0] & 0xf) * 4;
+    tcp = &ip[iphdr];
+    tcphdr = (tcp[12] >> 4) * 4;
+    dlen = ((ip[2] << 8) | ip[3]) - iphdr - tcphdr;
+    seq = (uint32_t)tcp[4]<<24 | tcp[5]<<16 | tcp[6]<<8 | tcp[7];
+    if (tcp[13] & 0x02)
+        dp->seq_end = seq + 1;
+    else if (dlen > 0)
+    {
+        end = seq + dlen;
+        if ((int32_t)(end - dp->seq_end) <= 0)
+            dp->nretrans++;
+        else
+            dp->seq_end = end;
+    }
+}
+
+// Return non-zero if a frame is due for delivery on either port
+bool pipe_due(PIPE *pp)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        PIPE_DIR *dp = &pp->dirs[i];
+        if (dp->count && dp->frames[dp->out].due <= pipe_now_usec)
+            return (true);
+    }
+    return (false);
+}
+
+// Return time of next frame delivery, 0 if none
+uint64_t pipe_next_due(PIPE *pp)
+{
+    uint64_t t = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        PIPE_DIR *dp = &pp->dirs[i];
+        if (dp->count && (t == 0 || dp->frames[dp->out].due < t))
+            t = dp->frames[dp->out].due;
+    }
+    return (t);
+}
+
+// Initialise driver
+static bool mg_pipe_init(struct mg_tcpip_if *ifp)
+{
+    return (ifp->driver_data != NULL);
+}
+
+// Transmit frame, apply link model
+static size_t mg_pipe_tx(const void *buf, size_t len, struct mg_tcpip_if *ifp)
+{
+    PIPE_DIR *dp = ((PIPE_PORT *)ifp->driver_data)->tx;
+    PIPE_LINK *lp = dp->link;
+    PIPE_FRAME *fp;
+    uint64_t t;
+
+    if (len > PIPE_FRAMESIZE)
+        return (0);
+    // If the queue is full, refuse the frame so the stack keeps the data
+    // and sends it later, as the WiFi driver does when the chip has no credit
+    if (dp->count >= (int)(lp->queue ? MIN(lp->queue, PIPE_NFRAMES) : PIPE_NFRAMES))
+    {
+        dp->nblocked++;
+        return (0);
+    }
+    if (((PIPE_PORT *)ifp->driver_data)->trace)
+        TRACE_FRAME(true, buf, len);
+    dp->nframes++;
+    dp->nbytes += len;
+    pipe_tcp_check(dp, buf, len);
+    if (lp->loss_ppm && pipe_rand(dp) % 1000000 < lp->loss_ppm)
+    {
+        dp->nlost++;
+        return (len);
+    }
+    t = MAX(dp->free_usec, pipe_now_usec);
+    if (lp->bandwidth)
+        t += (uint64_t)len * 1000000 / lp->bandwidth;
+    dp->free_usec = t;
+    fp = &dp->frames[dp->in];
+    fp->due = t + lp->latency_us;
+    fp->len = len;
+    memcpy(fp->data, buf, len);
+    dp->in = (dp->in + 1) % PIPE_NFRAMES;
+    dp->count++;
+    return (len);
+}
+
+// Receive frame, if one is due
+static size_t mg_pipe_rx(void *buf, size_t buflen, struct mg_tcpip_if *ifp)
+{
+    PIPE_DIR *dp = ((PIPE_PORT *)ifp->driver_data)->rx;
+    PIPE_FRAME *fp = &dp->frames[dp->out];
+    size_t n = 0;
+
+    if (dp->count && fp->due <= pipe_now_usec)
+    {
+        if (fp->len <= buflen)
+            memcpy(buf, fp->data, n = fp->len);
+        if (n && ((PIPE_PORT *)ifp->driver_data)->trace)
+            TRACE_FRAME(false, buf, n);
+        dp->out = (dp->out + 1) % PIPE_NFRAMES;
+        dp->count--;
+    }
+    return (n);
+}
+
+// Return link state, always up
+static bool mg_pipe_up(struct mg_tcpip_if *ifp)
+{
+    return (true);
+}
+
+struct mg_tcpip_driver mg_tcpip_driver_pipe = { mg_pipe_init, mg_pipe_tx, mg_pipe_rx, mg_pipe_up };
+
+// EOF
@@ -0,0 +1,76 @@
+// Definitions for Mongoose packet pipe driver, with link model
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define PIPE_FRAMESIZE      1540    // Maximum frame size
+#define PIPE_NFRAMES        256     // Maximum frames queued in each direction
+
+// Link model, applied to each direction
+typedef struct {
+    uint32_t latency_us;            // One-way latency (usec)
+    uint32_t bandwidth;             // Bandwidth (bytes/sec), 0 if unlimited
+    uint32_t loss_ppm;              // Frame loss (parts per million)
+    uint32_t queue;                 // Frames queued before dropping, 0 for max
+    uint32_t seed;                  // Seed for loss generator
+} PIPE_LINK;
+
+// Frame in transit
+typedef struct {
+    uint64_t due;                   // Delivery time (usec)
+    uint16_t len;
+    uint8_t data[PIPE_FRAMESIZE];
+} PIPE_FRAME;
+
+// One direction of a pipe: frame queue and statistics
+typedef struct {
+    PIPE_LINK *link;
+    PIPE_FRAME frames[PIPE_NFRAMES];
+    int in, out, count;
+    uint64_t free_usec;             // Time link is free for next frame
+    uint32_t rand;                  // Loss generator state
+    uint32_t seq_end;               // Highest TCP sequence number sent
+    uint32_t nframes, nbytes;       // Frames and bytes sent
+    uint32_t nlost;                 // Frames lost by link model
+    uint32_t nblocked;              // Frames refused, queue full
+    uint32_t nretrans;              // TCP retransmissions
+} PIPE_DIR;
+
+// Driver data for one end of a pipe
+typedef struct {
+    PIPE_DIR *tx, *rx;
+    bool trace;                     // Set to add frames to event trace
+} PIPE_PORT;
+
+// Pipe connecting 2 interfaces
+typedef struct {
+    PIPE_DIR dirs[2];
+    PIPE_PORT ports[2];
+} PIPE;
+
+extern struct mg_tcpip_driver mg_tcpip_driver_pipe;
+
+void pipe_init(PIPE *pp, PIPE_LINK *lp);
+uint64_t pipe_usec(void);
+void pipe_set_usec(uint64_t usec);
+bool pipe_due(PIPE *pp);
+uint64_t pipe_next_due(PIPE *pp);
+
+// EOF
@@ -0,0 +1,306 @@
+// WiCap network benchmark, using packet pipe with link model
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The WiCap web server and a test client run on Mongoose TCP/IP stacks,
+// connected by a packet pipe (mg_pipe.c). The client fetches /data.bin, and
+// checks the data; the transfer rate, link statistics and heap high-water
+// mark are then displayed. Time is simulated, so the results are reproducible.
+//
+// Usage: netbench [options]
+//   -b <bytes/sec>  link bandwidth, 0 for unlimited (default 1000000)
+//   -l <usec>       one-way latency (default 2000)
+//   -p <ppm>        frame loss, parts per million (default 0)
+//   -q <frames>     frames queued on link, before new frames are refused
+//                   (default 64; at least 2, since a refused ARP isn't resent)
+//   -n <samples>    number of samples to transfer (default 100000)
+//   -s <seed>       seed for loss generator (default 1)
+//   -t <file>       save server event trace, see trace2json.c
+// A check is then run with a 2-frame link queue, to make sure that frames
+// refused by a full queue are sent later, and the data is complete.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#include "../mongoose.h"
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "mg_pipe.h"
+#include "../picowi/picowi_trace.h"
+
+#define SERVER_IP       MG_U32(192, 168, 9, 1)
+#define CLIENT_IP       MG_U32(192, 168, 9, 2)
+#define NET_MASK        MG_U32(255, 255, 255, 0)
+#define GATEWAY_IP      MG_U32(192, 168, 9, 254)    // Not used, must not be peer
+#define SERVER_URL      "http://0.0.0.0:80"
+#define CLIENT_URL      "tcp://192.168.9.1:80"
+#define DATA_FNAME      "/data.bin"
+#define TIMEOUT_USEC    600000000ULL
+#define TICK_USEC       1000
+#define CHECK_QUEUE     2           // Link queue for overflow check
+#define CHECK_NSAMP     20000       // Samples for overflow check
+
+// State of test client
+typedef struct {
+    bool done, hdr_ok, data_ok;
+    int hdrlen, status;
+    size_t rxlen, total;
+    uint64_t start_usec, end_usec;  // Time of request, and last data
+} CLIENT_STATE;
+
+extern WORD samples[XSAMP_MAX+XSAMP_PRE];
+void listener(struct mg_connection *c, int ev, void *ev_data);
+
+PIPE pipe_link;
+size_t heap_max;
+
+// Simulated millisecond time for Mongoose
+uint64_t mg_millis(void)
+{
+    return (pipe_usec() / 1000);
+}
+
+// Repeatable random numbers for Mongoose (TCP sequence numbers, ports)
+void mg_random(void *buf, size_t len)
+{
+    static uint32_t x = 1;
+    uint8_t *p = (uint8_t *)buf;
+
+    while (len--)
+    {
+        x = x * 1103515245 + 12345;
+        *p++ = (uint8_t)(x >> 16);
+    }
+}
+
+// Update heap high-water mark
+void heap_check(void)
+{
+    struct mallinfo2 mi = mallinfo2();
+
+    if (mi.uordblks > heap_max)
+        heap_max = mi.uordblks;
+}
+
+// Check received data against sample values
+bool data_check(size_t oset, uint8_t *data, size_t len)
+{
+    uint8_t *dp = (uint8_t *)&samples[XSAMP_PRE];
+
+    return (memcmp(&dp[oset], data, len) == 0);
+}
+
+// Test client callback
+void client_fn(struct mg_connection *c, int ev, void *ev_data)
+{
+    CLIENT_STATE *csp = (CLIENT_STATE *)c->fn_data;
+    struct mg_http_message hm;
+    size_t n;
+
+    if (ev == MG_EV_CONNECT)
+    {
+        mg_printf(c, "GET %s HTTP/1.1\r\nHost: wicap\r\n\r\n", DATA_FNAME);
+        csp->start_usec = pipe_usec();
+    }
+    else if (ev == MG_EV_READ)
+    {
+        if (!csp->hdr_ok && (csp->hdrlen = mg_http_parse((char *)c->recv.buf, c->recv.len, &hm)) > 0)
+        {
+            csp->hdr_ok = true;
+            csp->data_ok = true;
+            csp->status = mg_http_status(&hm);
+            csp->total = hm.body.len;
+            mg_iobuf_del(&c->recv, 0, csp->hdrlen);
+        }
+        if (csp->hdr_ok && c->recv.len)
+        {
+            n = MIN(c->recv.len, csp->total - csp->rxlen);
+            csp->data_ok = csp->data_ok && data_check(csp->rxlen, c->recv.buf, n);
+            csp->rxlen += n;
+            csp->end_usec = pipe_usec();
+            c->recv.len = 0;
+            if (csp->rxlen >= csp->total)
+            {
+                csp->done = true;
+                c->is_closing = 1;
+            }
+        }
+    }
+    else if (ev == MG_EV_CLOSE || ev == MG_EV_ERROR)
+        csp->done = true;
+}
+
+// Initialise a TCP/IP interface using a pipe port
+void net_init(struct mg_mgr *mgr, struct mg_tcpip_if *ifp, int port, uint32_t ip)
+{
+    memset(ifp, 0, sizeof(struct mg_tcpip_if));
+    ifp->driver = &mg_tcpip_driver_pipe;
+    ifp->driver_data = &pipe_link.ports[port];
+    ifp->mac[0] = 2;
+    ifp->mac[5] = port + 1;
+    ifp->ip = mg_htonl(ip);
+    ifp->mask = mg_htonl(NET_MASK);
+    ifp->gw = mg_htonl(GATEWAY_IP);
+    mg_mgr_init(mgr);
+    mg_tcpip_init(mgr, ifp);
+}
+
+// Poll both interfaces, advance simulated time if nothing to do
+void net_poll(struct mg_mgr *smgr, struct mg_mgr *cmgr)
+{
+    uint64_t t, next;
+
+    mg_mgr_poll(smgr, 0);
+    mg_mgr_poll(cmgr, 0);
+    heap_check();
+    if (!pipe_due(&pipe_link))
+    {
+        t = pipe_usec();
+        next = pipe_next_due(&pipe_link);
+        pipe_set_usec(next && next < t + TICK_USEC ? next : t + TICK_USEC);
+    }
+}
+
+// Save event trace to file
+bool trace_save(char *fname)
+{
+    FILE *fp = fopen(fname, "wb");
+    TRACE_HDR hdr;
+    TRACE_REC *recs1, *recs2;
+    int n1, n2;
+
+    if (!fp)
+        return (false);
+    trace_get(&hdr, &recs1, &n1, &recs2, &n2);
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    fwrite(recs1, sizeof(TRACE_REC), n1, fp);
+    fwrite(recs2, sizeof(TRACE_REC), n2, fp);
+    fclose(fp);
+    return (true);
+}
+
+// Display statistics for one direction of pipe
+void disp_dir(char *name, PIPE_DIR *dp)
+{
+    printf("%s: %u frames, %u bytes, %u lost, %u blocked, %u retransmissions\n",
+        name, dp->nframes, dp->nbytes, dp->nlost, dp->nblocked, dp->nretrans);
+}
+
+// Run a transfer over the link, display the results if required
+// Return true if the data was received correctly
+bool transfer(PIPE_LINK *lp, int nsamp, bool trace, bool disp)
+{
+    struct mg_mgr smgr, cmgr;
+    struct mg_tcpip_if sif, cif;
+    CLIENT_STATE cs = {0};
+    uint64_t dt, tmax = pipe_usec() + TIMEOUT_USEC;
+    bool ok;
+
+    set_param_int(ARG_XSAMP, nsamp);
+    set_param_int(ARG_NSAMP, nsamp);
+    pipe_init(&pipe_link, lp);
+    pipe_link.ports[0].trace = trace;
+    net_init(&smgr, &sif, 0, SERVER_IP);
+    net_init(&cmgr, &cif, 1, CLIENT_IP);
+    mg_http_listen(&smgr, SERVER_URL, listener, NULL);
+    while (pipe_usec() < tmax && 
+           (sif.state != MG_TCPIP_STATE_READY || cif.state != MG_TCPIP_STATE_READY))
+        net_poll(&smgr, &cmgr);
+    mg_connect(&cmgr, CLIENT_URL, client_fn, &cs);
+    while (pipe_usec() < tmax && !cs.done)
+        net_poll(&smgr, &cmgr);
+    // Allow connection to close
+    for (int i = 0; i < 100; i++)
+        net_poll(&smgr, &cmgr);
+    mg_mgr_free(&smgr);
+    mg_mgr_free(&cmgr);
+    mg_tcpip_free(&sif);
+    mg_tcpip_free(&cif);
+
+    ok = cs.data_ok && cs.total == (size_t)nsamp * 2 && cs.rxlen == cs.total;
+    dt = cs.end_usec > cs.start_usec ? cs.end_usec - cs.start_usec : 0;
+    if (disp)
+    {
+        printf("Link: %u bytes/sec, latency %u usec, loss %u ppm, queue %u, seed %u\n",
+            lp->bandwidth, lp->latency_us, lp->loss_ppm, lp->queue, lp->seed);
+        printf("Transfer: status %d, %zu of %zu bytes, %.3f sec, %.0f bytes/sec, %s\n",
+            cs.status, cs.rxlen, cs.total, dt / 1e6, dt ? cs.rxlen * 1e6 / dt : 0.0,
+            ok ? "OK" : !cs.hdr_ok ? "no response" : !cs.data_ok ? "data error" : "incomplete");
+        disp_dir("Server->client", &pipe_link.dirs[0]);
+        disp_dir("Client->server", &pipe_link.dirs[1]);
+    }
+    return (ok);
+}
+
+int main(int argc, char *argv[])
+{
+    PIPE_LINK link = {.latency_us=2000, .bandwidth=1000000, .loss_ppm=0, .queue=64, .seed=1};
+    PIPE_LINK check = {.latency_us=2000, .bandwidth=1000000, .queue=CHECK_QUEUE, .seed=1};
+    int nsamp = 100000, opt;
+    char *trace_fname = NULL;
+    bool ok;
+
+    while ((opt = getopt(argc, argv, "b:l:p:q:n:s:t:h")) != -1)
+    {
+        if (opt == 'b')
+            link.bandwidth = atoi(optarg);
+        else if (opt == 'l')
+            link.latency_us = atoi(optarg);
+        else if (opt == 'p')
+            link.loss_ppm = atoi(optarg);
+        else if (opt == 'q')
+            link.queue = atoi(optarg);
+        else if (opt == 'n')
+            nsamp = MIN(atoi(optarg), XSAMP_MAX);
+        else if (opt == 's')
+            link.seed = atoi(optarg);
+        else if (opt == 't')
+            trace_fname = optarg;
+        else
+        {
+            printf("Usage: netbench [-b bytes/sec] [-l latency_usec] [-p loss_ppm] [-q frames] [-n nsamp] [-s seed] [-t trace_file]\n");
+            return (opt == 'h' ? 0 : 1);
+        }
+    }
+    cap_init();
+    for (int i = 0; i < XSAMP_MAX + XSAMP_PRE; i++)
+        samples[i] = (WORD)(i * 7 + (i >> 8));
+    mg_log_set(MG_LL_NONE);
+
+    ok = transfer(&link, nsamp, trace_fname != NULL, true);
+    if (trace_fname && !trace_save(trace_fname))
+        printf("Can't save trace file %s\n", trace_fname);
+    // Regression check: a small link queue must not lose data
+    if (transfer(&check, CHECK_NSAMP, false, false) && pipe_link.dirs[0].nblocked)
+        printf("Queue overflow check: OK\n");
+    else
+    {
+        printf("Queue overflow check: FAILED\n");
+        ok = false;
+    }
+    printf("Heap high-water mark: %zu bytes\n", heap_max);
+    return (ok ? 0 : 1);
+}
+
+// EOF
@@ -0,0 +1,137 @@
+// Convert WiCap binary event trace to Chrome trace-event JSON
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Test of the inter-core SPSC queues (see spsc.c), using 2 threads to
+// stand in for the 2 CPU cores. As in WiCap, each thread is the producer for
+// one queue, and the consumer for the other. Every value is a sequence number,
+// so any lost, duplicated or corrupted entry is detected. A random delay
+// can be inserted between operations, to vary the interleaving of the threads.
+// For a stronger check, build with -fsanitize=thread
+//
+// Usage: spsctest [-n count] [-s seed] [-d max_delay_loops]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../spsc.h"
+
+// Test context for one thread
+typedef struct {
+    SPSC_QUEUE *txq, *rxq;
+    uint32_t ntx, nrx, errors, maxcount, seed;
+} TEST_THREAD;
+
+SPSC_QUEUE queues[2];
+uint32_t count = 1000000, max_delay;
+
+// Random delay between operations
+void test_delay(TEST_THREAD *ttp)
+{
+    if (max_delay)
+    {
+        volatile uint32_t n = rand_r(&ttp->seed) % max_delay;
+        while (n)
+            n--;
+    }
+}
+
+// Thread to send & receive sequence numbers
+void *test_thread(void *arg)
+{
+    TEST_THREAD *ttp = (TEST_THREAD *)arg;
+    uint32_t val;
+    int n;
+    bool busy;
+
+    while (ttp->ntx < count || ttp->nrx < count)
+    {
+        busy = false;
+        if (ttp->ntx < count && spsc_put(ttp->txq, ttp->ntx))
+        {
+            ttp->ntx++;
+            busy = true;
+        }
+        test_delay(ttp);
+        if (spsc_get(ttp->rxq, &val))
+        {
+            if (val != ttp->nrx && ttp->errors++ < 10)
+                printf("Error: expected %u, got %u\n", ttp->nrx, val);
+            ttp->nrx++;
+            busy = true;
+        }
+        // Let the other thread run if no progress (for single-CPU hosts)
+        if (!busy)
+            sched_yield();
+        n = spsc_count(ttp->txq);
+        if (n < 0 || n > SPSC_SIZE)
+            ttp->errors++;
+        else if ((uint32_t)n > ttp->maxcount)
+            ttp->maxcount = n;
+        test_delay(ttp);
+    }
+    return (0);
+}
+
+int main(int argc, char *argv[])
+{
+    TEST_THREAD threads[2] = {{.txq=&queues[0], .rxq=&queues[1], .seed=1},
+                              {.txq=&queues[1], .rxq=&queues[0], .seed=2}};
+    pthread_t tids[2];
+    int opt, errors;
+
+    while ((opt = getopt(argc, argv, "n:s:d:")) != -1)
+    {
+        if (opt == 'n')
+            count = strtoul(optarg, NULL, 10);
+        else if (opt == 's')
+        {
+            threads[0].seed = strtoul(optarg, NULL, 10);
+            threads[1].seed = threads[0].seed * 7 + 1;
+        }
+        else if (opt == 'd')
+            max_delay = strtoul(optarg, NULL, 10);
+        else
+        {
+            printf("Usage: spsctest [-n count] [-s seed] [-d max_delay_loops]\n");
+            return (1);
+        }
+    }
+    spsc_init(&queues[0]);
+    spsc_init(&queues[1]);
+    for (int i = 0; i < 2; i++)
+        pthread_create(&tids[i], 0, test_thread, &threads[i]);
+    for (int i = 0; i < 2; i++)
+        pthread_join(tids[i], 0);
+    errors = threads[0].errors + threads[1].errors;
+    for (int i = 0; i < 2; i++)
+        printf("Thread %d: sent %u, received %u, max queued %u, errors %u\n", i,
+               threads[i].ntx, threads[i].nrx, threads[i].maxcount, threads[i].errors);
+    printf("%s\n", errors ? "FAILED" : "OK");
+    return (errors ? 1 : 0);
+}
+
+// EOF
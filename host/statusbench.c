@@ -0,0 +1,144 @@
+// Test & benchmark of WiCap status records and JSON rendering
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The parameter values are set randomly (including negative values, and
+// the extremes), and the JSON from the field table (status.c) is compared
+// with the output of the original sprintf-based code. The binary record
+// is checked against the parameter values, and its sequence number must
+// only change when a value changes. The timing is the average time per
+// status request on this host, for each method.
+//
+// Usage: statusbench [-n iterations] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "../status.h"
+#include "testutil.h"
+
+#define NUM_TESTS       1000
+
+SERVER_PARAM server_params[] = { SERVER_PARAM_VALS };
+char ref_buff[TEMPS_SIZE], test_buff[TEMPS_SIZE];
+
+// Parameter values, normally in picocap.c
+int get_param_int(SERVER_ARG_NUM n)
+{
+    return (n <= ARG_END) ? server_params[n].val : 0;
+}
+
+// Reference status JSON, using sprintf for each field
+int ref_json(char *buff, int maxlen)
+{
+    SERVER_PARAM *arg = server_params;
+    int i = 0, n = sprintf(buff, "{");
+
+    while (arg[i].name[0] && n < maxlen - 20)
+    {
+        if (i < ARG_SECURITY)
+            n += sprintf(&buff[n], arg[i].type == ARG_STATUS_T ? "%s\"%s\":%u" : "%s\"%s\":%d", 
+                n > 2 ? "," : "", arg[i].name, arg[i].val);
+        i++;
+    }
+    return (n += sprintf(&buff[n], "}"));
+}
+
+// Set random parameter values
+void set_random(int test)
+{
+    static const uint32_t extremes[] = {0, 1, 9, 10, 0x7fffffff, 0x80000000, 0xffffffff};
+
+    for (int i = 0; i < STATUS_NVALS; i++)
+    {
+        uint32_t r = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+        int k = rand() % 4;
+        server_params[i].val = test < 7 ? extremes[test] : k == 0 ? r : k == 1 ? r % 1000 : 
+            k == 2 ? (uint32_t)-(int)(r % 1000) : r % 10;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, iters = 100000, fails = 0, len = 0;
+    uint32_t seq;
+    double start, ref_usec, test_usec;
+    STATUS_REC *sp;
+    bool ok;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        if (opt == 'n')
+            iters = MAX(1, atoi(optarg));
+        else if (opt == 's')
+            srand(atoi(optarg));
+        else
+        {
+            printf("Usage: statusbench [-n iterations] [-s seed]\n");
+            return (1);
+        }
+    }
+    for (int test = 0; test < NUM_TESTS; test++)
+    {
+        set_random(test);
+        ref_json(ref_buff, sizeof(ref_buff) - 1);
+        len = status_json(test_buff, sizeof(test_buff));
+        if (strcmp(ref_buff, test_buff) || len != (int)strlen(test_buff))
+        {
+            if (fails++ == 0)
+                printf("JSON mismatch:\n%s\n%s\n", ref_buff, test_buff);
+        }
+        sp = status_get();
+        for (int i = 0; i < STATUS_NVALS; i++)
+            fails += sp->vals[i] != (uint32_t)server_params[i].val;
+    }
+    test_check("JSON", !fails, &fails);
+
+    // Sequence number must only change when values change
+    sp = status_get();
+    seq = sp->seq;
+    status_update();
+    ok = sp->seq == seq && !memcmp(sp->magic, STATUS_MAGIC, 4) && 
+        sp->version == STATUS_VERSION && sp->nvals == STATUS_NVALS;
+    server_params[ARG_NSAMP].val++;
+    ok = ok && status_update() && sp->seq == seq + 1;
+    test_check("Record", ok, &fails);
+    printf("Record %u bytes, JSON %d bytes\n", (uint)sizeof(STATUS_REC), len);
+
+    start = get_secs();
+    for (int i = 0; i < iters; i++)
+        ref_json(ref_buff, sizeof(ref_buff) - 1);
+    ref_usec = (get_secs() - start) * 1e6 / iters;
+    start = get_secs();
+    for (int i = 0; i < iters; i++)
+        status_json(test_buff, sizeof(test_buff));
+    test_usec = (get_secs() - start) * 1e6 / iters;
+    printf("usec/request: sprintf %.3f, table %.3f\n", ref_usec, test_usec);
+    return (test_end(fails));
+}
+
+// EOF
@@ -0,0 +1,100 @@
+// Helpers shared by the WiCap host test & benchmark tools
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_TSC 1
+#endif
+
+#include "../picowi/picowi_defs.h"
+#include "../picocap.h"
+#include "testutil.h"
+
+// Return time in seconds
+double get_secs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+// Return CPU timestamp counter, 0 if not available
+uint64_t get_cycles(void)
+{
+#if HAS_TSC
+    return (__rdtsc());
+#else
+    return (0);
+#endif
+}
+
+// Return sample, given analog value relative to zero, and digital bits
+// The analog value is rounded, and limited to the ADC range
+WORD test_sample(double v, WORD dig)
+{
+    long a = MIN(MAX(lround(v) + ANALOG_ZERO, 0), ANALOG_MASK);
+
+    return ((WORD)a | (dig & ~ANALOG_MASK));
+}
+
+// Return random digital bits
+WORD test_digital(void)
+{
+    return ((WORD)(rand() << ANALOG_BITS));
+}
+
+// Generate sine wave (frequency in cycles per sample) with uniform noise,
+// and random digital bits if required
+void test_sine(WORD *samps, int n, double freq, double ampl, double noise, bool digital)
+{
+    for (int i = 0; i < n; i++)
+    {
+        double v = ampl * sin(2 * M_PI * freq * i);
+        if (noise)
+            v += noise * ((double)rand() / RAND_MAX * 2 - 1);
+        samps[i] = test_sample(v, digital ? test_digital() : 0);
+    }
+}
+
+// Display result of a test, and update failure count
+bool test_check(const char *name, bool ok, int *fails)
+{
+    printf("%-20s %s\n", name, TEST_RESULT(ok));
+    *fails += !ok;
+    return (ok);
+}
+
+// Display overall result, return exit code
+int test_end(int fails)
+{
+    printf("%s\n", TEST_RESULT(!fails));
+    return (fails ? 1 : 0);
+}
+
+// EOF
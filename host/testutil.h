@@ -0,0 +1,37 @@
+// Helpers shared by the WiCap host test & benchmark tools
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Timing, test signals in the capture sample format, and the reporting of
+// results; each tool prints a table with OK or FAIL for each test, then a
+// final line of OK or FAIL, and returns a non-zero exit code on failure.
+
+#define TEST_RESULT(ok)     ((ok) ? "OK" : "FAIL")
+
+double get_secs(void);
+uint64_t get_cycles(void);
+WORD test_sample(double v, WORD dig);
+WORD test_digital(void);
+void test_sine(WORD *samps, int n, double freq, double ampl, double noise, bool digital);
+bool test_check(const char *name, bool ok, int *fails);
+int test_end(int fails);
+
+// EOF
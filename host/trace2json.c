@@ -0,0 +1,164 @@
+// Convert WiCap binary event trace to Chrome trace-event JSON
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The trace file is fetched from /trace.bin (see picowi/picowi_trace.c), or
+// saved by 'netbench -t'. The JSON output can be viewed as a timeline using
+// chrome://tracing or https://ui.perfetto.dev. Network frames, SDPCM headers,
+// TCP segments and capture events are shown on separate tracks, with SDPCM
+// credit and TCP sequence numbers also shown as counters.
+//
+// Usage: trace2json <trace.bin> [output.json]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picowi/picowi_trace.h"
+#include "../picocap.h"
+
+// Tracks (thread IDs) in the timeline
+enum { TRACK_FRAME=1, TRACK_SDPCM, TRACK_TCP, TRACK_CAPTURE };
+const char *track_names[] = { "", "Frames", "SDPCM", "TCP", "Capture" };
+const char *state_strs[NUM_STATES] = { STATE_STRS };
+
+FILE *outf;
+int nevents;
+
+// Start a trace event, given phase, track, name and time
+void event_start(char ph, int track, const char *name, uint64_t usec)
+{
+    fprintf(outf, "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%llu",
+        nevents++ ? "," : "", ph, track, name, (unsigned long long)usec);
+    if (ph == 'i')
+        fprintf(outf, ",\"s\":\"t\"");
+}
+
+// Output a record as trace event(s)
+void rec_json(TRACE_REC *trp, uint64_t usec)
+{
+    bool tx = trp->type == TRACE_TX_FRAME || trp->type == TRACE_SDPCM_TX || 
+              trp->type == TRACE_TCP_TX;
+
+    switch (trp->type)
+    {
+    case TRACE_RX_FRAME:
+    case TRACE_TX_FRAME:
+        event_start('i', TRACK_FRAME, tx ? "Tx" : "Rx", usec);
+        fprintf(outf, ",\"args\":{\"len\":%u,\"ethertype\":\"0x%04X\"}}", trp->b, trp->c);
+        break;
+    case TRACE_SDPCM_RX:
+        event_start('i', TRACK_SDPCM, "Rx", usec);
+        fprintf(outf, ",\"args\":{\"seq\":%u,\"len\":%u,\"credit\":%u,\"chan\":%u}}",
+            trp->a, trp->b, trp->c, trp->d);
+        event_start('C', TRACK_SDPCM, "credit", usec);
+        fprintf(outf, ",\"args\":{\"credit\":%u}}", trp->c);
+        break;
+    case TRACE_SDPCM_TX:
+        event_start('i', TRACK_SDPCM, "Tx", usec);
+        fprintf(outf, ",\"args\":{\"seq\":%u,\"len\":%u,\"chan\":%u}}", 
+            trp->a, trp->b, trp->d);
+        break;
+    case TRACE_TCP_RX:
+    case TRACE_TCP_TX:
+        event_start('i', TRACK_TCP, tx ? "Tx" : "Rx", usec);
+        fprintf(outf, ",\"args\":{\"flags\":\"%s%s%s%s%s\",\"len\":%u,\"seq\":%u,\"ack\":%u}}",
+            trp->a & 0x02 ? "S" : "", trp->a & 0x10 ? "A" : "", trp->a & 0x08 ? "P" : "",
+            trp->a & 0x01 ? "F" : "", trp->a & 0x04 ? "R" : "", trp->b, trp->c, trp->d);
+        event_start('C', TRACK_TCP, tx ? "Tx seq" : "Rx seq", usec);
+        fprintf(outf, ",\"args\":{\"seq\":%u}}", trp->c);
+        break;
+    case TRACE_DMA_START:
+        event_start('B', TRACK_CAPTURE, "DMA", usec);
+        fprintf(outf, ",\"args\":{\"nsamp\":%u}}", trp->c);
+        break;
+    case TRACE_DMA_END:
+        event_start('E', TRACK_CAPTURE, "DMA", usec);
+        fprintf(outf, ",\"args\":{\"nsamp\":%u}}", trp->c);
+        break;
+    case TRACE_STATE:
+        event_start('i', TRACK_CAPTURE, trp->a < NUM_STATES ? state_strs[trp->a] : "?", usec);
+        fprintf(outf, "}");
+        break;
+    default:
+        event_start('i', TRACK_FRAME, "Unknown", usec);
+        fprintf(outf, ",\"args\":{\"type\":%u}}", trp->type);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *inf;
+    TRACE_HDR hdr;
+    TRACE_REC rec;
+    uint32_t n = 0, last = 0;
+    uint64_t usec = 0;
+
+    if (argc < 2)
+    {
+        printf("Usage: trace2json <trace.bin> [output.json]\n");
+        return (1);
+    }
+    if (!(inf = fopen(argv[1], "rb")))
+    {
+        fprintf(stderr, "Can't open %s\n", argv[1]);
+        return (1);
+    }
+    if (fread(&hdr, sizeof(hdr), 1, inf) != 1 || memcmp(hdr.magic, TRACE_MAGIC, 4) ||
+        hdr.version != TRACE_VERSION || hdr.recsize != sizeof(TRACE_REC))
+    {
+        fprintf(stderr, "Invalid trace file %s\n", argv[1]);
+        return (1);
+    }
+    outf = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!outf)
+    {
+        fprintf(stderr, "Can't create %s\n", argv[2]);
+        return (1);
+    }
+    fprintf(outf, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (int i = TRACK_FRAME; i <= TRACK_CAPTURE; i++)
+    {
+        fprintf(outf, "%s\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+            "\"args\":{\"name\":\"%s\"}}", nevents++ ? "," : "", i, track_names[i]);
+    }
+    // Timestamps are 32-bit microseconds, so convert the differences
+    while (n < hdr.nrecs && fread(&rec, sizeof(rec), 1, inf) == 1)
+    {
+        usec += n++ ? (uint32_t)(rec.usec - last) : 0;
+        last = rec.usec;
+        rec_json(&rec, usec);
+    }
+    fprintf(outf, "\n]}\n");
+    if (n < hdr.nrecs)
+        fprintf(stderr, "Trace file truncated, %u of %u records\n", n, hdr.nrecs);
+    fprintf(stderr, "%u records (%u since reset)\n", n, hdr.total);
+    fclose(inf);
+    if (outf != stdout)
+        fclose(outf);
+    return (n < hdr.nrecs ? 1 : 0);
+}
+
+// EOF
@@ -0,0 +1,241 @@
+// WiCap web server load generator, for the benchmark endpoints
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// A number of concurrent clients each send a sequence of requests to one of
+// the /bench endpoints (see bench.c), over a keep-alive connection. Received
+// data is checked against the synthetic data pattern, and the result is
+// printed as a single line of JSON, so it can be logged for comparison.
+//
+// Usage: wicap_load [options] [url]
+//   -c <clients>    number of concurrent clients (default 1)
+//   -n <requests>   requests per client (default 10)
+//   -t <test>       bin, txt, chunked, sink or echo (default bin)
+//   -s <bytes>      data size per request (default 100000)
+//   -w <secs>       timeout (default 60)
+// The default URL is http://127.0.0.1:8080 (the host build of WiCap)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../mongoose.h"
+#include "../bench.h"
+
+#define DEFAULT_URL     "http://127.0.0.1:8080"
+#define MAX_CLIENTS     64
+#define MIN(a,b)        (((a)<(b))?(a):(b))
+#define MAX(a,b)        (((a)>(b))?(a):(b))
+
+// Test types, with URI and method
+typedef enum { TEST_BIN, TEST_TXT, TEST_CHUNKED, TEST_SINK, TEST_ECHO, NUM_TESTS } TEST_TYPE;
+const char *test_names[NUM_TESTS] = { "bin", "txt", "chunked", "sink", "echo" };
+const char *test_uris[NUM_TESTS] = 
+    { BENCH_DATA_BIN, BENCH_DATA_TXT, BENCH_CHUNKED, BENCH_SINK, BENCH_ECHO };
+
+// State of one client
+typedef struct {
+    int index, nreq;
+    bool done;
+    double req_usec;
+    struct mg_connection *conn;
+} CLIENT_STATE;
+
+CLIENT_STATE clients[MAX_CLIENTS];
+TEST_TYPE test = TEST_BIN;
+int nclients = 1, nrequests = 10, nlatencies, errors;
+uint32_t size = 100000;
+size_t total_bytes;
+double *latencies;
+char *url = DEFAULT_URL;
+uint8_t *txdata, *rxdata;
+
+// Return monotonic time in microseconds
+double usec_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e6 + ts.tv_nsec / 1e3);
+}
+
+// Send a request
+void send_request(struct mg_connection *c, CLIENT_STATE *csp)
+{
+    struct mg_str host = mg_url_host(url);
+
+    if (test == TEST_SINK)
+    {
+        mg_printf(c, "POST %s HTTP/1.1\r\nHost: %.*s\r\nContent-Length: %u\r\n\r\n",
+            BENCH_SINK, (int)host.len, host.buf, size);
+        mg_send(c, txdata, size);
+    }
+    else if (test == TEST_ECHO)
+        mg_printf(c, "GET %s?client=%d&req=%d HTTP/1.1\r\nHost: %.*s\r\n\r\n",
+            BENCH_ECHO, csp->index, csp->nreq, (int)host.len, host.buf);
+    else
+        mg_printf(c, "GET %s?size=%u HTTP/1.1\r\nHost: %.*s\r\n\r\n",
+            test_uris[test], size, (int)host.len, host.buf);
+    csp->req_usec = usec_time();
+}
+
+// Check response, return data byte count, or -1 if error
+long check_response(CLIENT_STATE *csp, struct mg_http_message *hm)
+{
+    char s[32];
+    size_t n;
+
+    if (mg_http_status(hm) != 200)
+        return (-1);
+    if (test == TEST_BIN || test == TEST_CHUNKED)
+        return (hm->body.len == size && !memcmp(hm->body.buf, txdata, size) ? (long)size : -1);
+    if (test == TEST_TXT)
+    {
+        n = mg_base64_decode(hm->body.buf, hm->body.len, (char *)rxdata, size + 4);
+        return (n == size && !memcmp(rxdata, txdata, size) ? (long)size : -1);
+    }
+    if (test == TEST_SINK)
+        return (mg_json_get_long(hm->body, "$.bytes", -1) == (long)size ? (long)size : -1);
+    n = snprintf(s, sizeof(s), "client=%d&req=%d", csp->index, csp->nreq);
+    return (hm->body.len == n && !memcmp(hm->body.buf, s, n) ? (long)n : -1);
+}
+
+// Client callback
+void client_fn(struct mg_connection *c, int ev, void *ev_data)
+{
+    CLIENT_STATE *csp = (CLIENT_STATE *)c->fn_data;
+
+    if (ev == MG_EV_CONNECT)
+        send_request(c, csp);
+    else if (ev == MG_EV_HTTP_MSG)
+    {
+        long n = check_response(csp, (struct mg_http_message *)ev_data);
+
+        latencies[nlatencies++] = (usec_time() - csp->req_usec) / 1000;
+        if (n < 0)
+            errors++;
+        else
+            total_bytes += n;
+        if (++csp->nreq < nrequests)
+            send_request(c, csp);
+        else
+        {
+            csp->done = true;
+            c->is_draining = 1;
+        }
+    }
+    else if (ev == MG_EV_ERROR || ev == MG_EV_CLOSE)
+    {
+        if (!csp->done)
+        {
+            errors += nrequests - csp->nreq;
+            csp->done = true;
+        }
+    }
+}
+
+// Compare two latency values, for sorting
+int latency_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+// Return latency value at given percentile
+double percentile(int pc)
+{
+    return (nlatencies ? latencies[(nlatencies - 1) * pc / 100] : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    struct mg_mgr mgr;
+    int opt, ndone = 0, timeout = 60;
+    double start, secs;
+
+    while ((opt = getopt(argc, argv, "c:n:t:s:w:")) != -1)
+    {
+        if (opt == 'c')
+            nclients = MAX(1, MIN(atoi(optarg), MAX_CLIENTS));
+        else if (opt == 'n')
+            nrequests = MAX(1, atoi(optarg));
+        else if (opt == 's')
+            size = MIN(strtoul(optarg, NULL, 10), BENCH_MAX_LEN);
+        else if (opt == 'w')
+            timeout = atoi(optarg);
+        else if (opt == 't')
+        {
+            for (test = 0; test < NUM_TESTS && strcmp(optarg, test_names[test]); test++) ;
+            if (test >= NUM_TESTS)
+                opt = '?';
+        }
+        if (opt == '?' || opt == ':')
+        {
+            printf("Usage: wicap_load [-c clients] [-n requests] [-t bin|txt|chunked|sink|echo] [-s size] [-w secs] [url]\n");
+            return (1);
+        }
+    }
+    if (optind < argc)
+        url = argv[optind];
+    txdata = malloc(size + 4);
+    rxdata = malloc(size + 4);
+    latencies = calloc(nclients * nrequests, sizeof(double));
+    for (uint32_t i = 0; i < size; i++)
+        txdata[i] = BENCH_DATA(i);
+    mg_log_set(MG_LL_NONE);
+    mg_mgr_init(&mgr);
+    start = usec_time();
+    for (int i = 0; i < nclients; i++)
+    {
+        clients[i].index = i;
+        clients[i].conn = mg_http_connect(&mgr, url, client_fn, &clients[i]);
+        if (!clients[i].conn)
+        {
+            errors += nrequests;
+            clients[i].done = true;
+        }
+    }
+    while (ndone < nclients && usec_time() - start < timeout * 1e6)
+    {
+        mg_mgr_poll(&mgr, 10);
+        for (int i = ndone = 0; i < nclients; i++)
+            ndone += clients[i].done;
+    }
+    secs = (usec_time() - start) / 1e6;
+    for (int i = 0; i < nclients; i++)
+    {
+        if (!clients[i].done)
+            errors += nrequests - clients[i].nreq;
+    }
+    qsort(latencies, nlatencies, sizeof(double), latency_cmp);
+    printf("{\"test\":\"%s\",\"url\":\"%s\",\"clients\":%d,\"requests\":%d,"
+        "\"size\":%u,\"bytes\":%zu,\"errors\":%d,\"secs\":%.3f,\"MBps\":%.3f,"
+        "\"latency_ms\":{\"min\":%.3f,\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}}\n",
+        test_names[test], url, nclients, nrequests, test == TEST_ECHO ? 0 : size,
+        total_bytes, errors, secs, secs > 0 ? total_bytes / secs / 1e6 : 0.0,
+        percentile(0), percentile(50), percentile(99), percentile(100));
+    mg_mgr_free(&mgr);
+    return (errors ? 1 : 0);
+}
+
+// EOF
@@ -0,0 +1,703 @@
+// Simulation of CYW43439 WiFi chip on SPI bus, for testing picowi on a host
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The model sits below the picowi SPI functions, in place of the bit-bash
+// transfers, so the command encoding in picowi_wifi.c is used unchanged.
+// It emulates the gSPI bus registers (including the 16-bit swapped mode used
+// on startup), the backplane window and chip RAM, firmware start-up, IOCTL
+// responses, async events for joining a network, and data frames in both
+// directions. Time is simulated: SPI transfers take time at the current
+// clock frequency, as do the chip responses, so the results are repeatable.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../picowi/picowi_defs.h"
+#include "../picowi/picowi_pico.h"
+#include "../picowi/picowi_wifi.h"
+#include "../picowi/picowi_init.h"
+#include "../picowi/picowi_regs.h"
+#include "../picowi/picowi_ioctl.h"
+#include "../picowi/picowi_event.h"
+#include "../picowi/picowi_evtnum.h"
+#include "wifi_sim.h"
+
+#define SIM_CHIP_ID         0xa9af  // Chip ID register value
+#define SIM_NREGS           32      // Number of core registers stored
+#define SIM_BUS_REGS        0x20    // Size of SPI bus register space
+#define SIM_CFG_REGS        0x20    // Size of backplane config register space
+#define SIM_CFG_BASE        0x10000 // Address of backplane config registers
+#define SIM_PSK_MAXLEN      64      // Maximum length of password
+#define SIM_VERSION         "wl0: Oct 18 2026 sim version 7.95.61 (simulated)\n"
+
+// Frame queued for the host
+typedef struct {
+    uint64_t due;                   // Time it is available (nsec)
+    int len;
+    uint8_t data[SIM_FRAMESIZE];
+} SIM_FRAME;
+
+// Core register value
+typedef struct {
+    uint32_t addr, val;
+} SIM_REG;
+
+// Chip state
+typedef struct {
+    bool powered, swap, selected, running, up, linked;
+    bool wr;                        // Current transaction is a write
+    int func, addr, len;            // ..function, address and length
+    uint8_t wrbuf[SIM_BUFLEN];      // Bytes written, including command
+    int wrlen;
+    uint8_t rdbuf[SIM_BUFLEN];      // Bytes to be read
+    int rdlen, rdpos;
+    uint8_t bus_regs[SIM_BUS_REGS];
+    uint8_t cfg_regs[SIM_CFG_REGS];
+    uint32_t window;                // Backplane window address
+    SIM_REG regs[SIM_NREGS];
+    int nregs;
+    SIM_FRAME frames[SIM_NFRAMES];  // Frames for host, in order of due time
+    int nframes;
+    uint64_t txq[SIM_TXQ_MAX];      // Transmit completion times
+    int txq_in, txq_count;
+    uint8_t seq;                    // Sequence number for frames to host
+    uint8_t pmk[SIM_PSK_MAXLEN+1]; // Password set by host
+    bool pmk_set;
+} SIM_CHIP;
+
+SIM_CHIP sim_chip;
+uint8_t sim_ram[SIM_RAM_SIZE];
+WIFI_SIM_CONFIG sim_cfg = {.ssid="testnet", .passwd="testpass", .ioctl_usec=200,
+    .join_usec=50000, .air_rate=2500000, .txq=8, .cs_nsec=500};
+WIFI_SIM_STATS wifi_sim_stats;
+uint64_t sim_nsec;
+
+const uint8_t sim_mac[6] = {0x28, 0xcd, 0xc1, 0x00, 0x00, 0x01};
+const uint8_t sim_bssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0xaa};
+
+extern uint32_t wifi_spi_freq;
+
+void sim_reset(void);
+void sim_command(void);
+void sim_write_end(void);
+void sim_read_bus(void);
+void sim_read_bak(void);
+void sim_read_rad(void);
+uint32_t sim_status(void);
+void sim_write_bus(uint8_t *data, int n);
+void sim_write_bak(uint8_t *data, int n);
+void sim_write_rad(uint8_t *data, int n);
+void sim_ioctl(SDPCM_HDR *sdp, int len);
+void sim_event(uint32_t evt, uint32_t status, uint16_t flags, uint32_t usec);
+SIM_FRAME *sim_frame_add(int chan, uint32_t usec, int hdrlen, void *data, int dlen);
+SIM_FRAME *sim_frame_due(void);
+void sim_frame_remove(void);
+int sim_txq_count(void);
+uint32_t sim_reg_get(uint32_t addr);
+void sim_reg_set(uint32_t addr, uint32_t val);
+uint32_t get_le(uint8_t *data, int n);
+void put_le(uint8_t *data, uint32_t val, int n);
+
+// Initialise simulation, with optional chip and network model
+void wifi_sim_init(WIFI_SIM_CONFIG *cfgp)
+{
+    if (cfgp)
+        sim_cfg = *cfgp;
+    memset(&wifi_sim_stats, 0, sizeof(wifi_sim_stats));
+    sim_reset();
+}
+
+// Return simulated time in microseconds
+uint64_t wifi_sim_usec(void)
+{
+    return (sim_nsec / 1000);
+}
+
+// Queue a network data frame for the host, return 0 if no space
+bool wifi_sim_rx_frame(uint8_t *data, int len)
+{
+    static uint8_t buff[SIM_FRAMESIZE];
+    BDC_HDR *bdcp = (BDC_HDR *)buff;
+
+    if (!sim_chip.linked || len + sizeof(SDPCM_HDR) + sizeof(BDC_HDR) > SIM_FRAMESIZE)
+        return (false);
+    memset(bdcp, 0, sizeof(BDC_HDR));
+    bdcp->flags = 0x20;
+    memcpy(&buff[sizeof(BDC_HDR)], data, len);
+    return (sim_frame_add(SDPCM_CHAN_DATA, 0, sizeof(SDPCM_HDR), buff, sizeof(BDC_HDR) + len) != 0);
+}
+
+// Return number of frames that can be queued for the host
+int wifi_sim_rx_space(void)
+{
+    return (SIM_NFRAMES - sim_chip.nframes);
+}
+
+// Return state of WiFi LED
+bool wifi_sim_led(void)
+{
+    return ((sim_reg_get(BAK_GPIOOUT_REG) & (1 << SD_LED_GPIO)) != 0);
+}
+
+// Reset chip (power-on)
+void sim_reset(void)
+{
+    memset(&sim_chip, 0, sizeof(sim_chip));
+    memset(sim_ram, 0, sizeof(sim_ram));
+    sim_chip.swap = true;
+    sim_reg_set(BAK_BASE_ADDR, SIM_CHIP_ID);
+}
+
+// Set I/O pin as input or output
+void io_set(int pin, int mode, int pull)
+{
+}
+
+// Set I/O pin mode
+void io_mode(int pin, int mode)
+{
+}
+
+// Set an O/P pin: power and chip-select control the chip
+void io_out(int pin, int val)
+{
+    if (pin == SD_ON_PIN)
+    {
+        if (val && !sim_chip.powered)
+            sim_reset();
+        sim_chip.powered = val != 0;
+    }
+    else if (pin == SD_CS_PIN && sim_chip.powered)
+    {
+        if (!val && !sim_chip.selected)
+        {
+            sim_chip.wrlen = sim_chip.rdlen = sim_chip.rdpos = 0;
+            sim_nsec += sim_cfg.cs_nsec;
+            wifi_sim_stats.ntrans++;
+        }
+        else if (val && sim_chip.selected && sim_chip.wr)
+            sim_write_end();
+        sim_chip.selected = !val;
+    }
+}
+
+// Get an I/P pin value: IRQ is asserted if a frame is available
+uint8_t io_in(int pin)
+{
+    return (pin == SD_IRQ_PIN && !sim_chip.selected && sim_frame_due() != 0);
+}
+
+// Return simulated time in microseconds
+uint32_t ustime(void)
+{
+    return ((uint32_t)(sim_nsec / 1000));
+}
+
+// Delay given number of microseconds
+void usdelay(uint32_t usec)
+{
+    sim_nsec += (uint64_t)usec * 1000;
+}
+
+// Return non-zero if timeout
+int ustimeout(uint32_t *tickp, uint32_t usec)
+{
+    uint32_t t = ustime();
+    uint32_t dt = t - *tickp;
+
+    if (usec == 0 || dt >= usec)
+    {
+        *tickp = t;
+        return (1);
+    }
+    return (0);
+}
+
+// Add SPI transfer time
+static void sim_spi_time(int nbits)
+{
+    uint64_t dt = wifi_spi_freq ? (uint64_t)nbits * 1000000000ULL / wifi_spi_freq : 0;
+
+    sim_nsec += dt;
+    wifi_sim_stats.bus_nsec += dt;
+    wifi_sim_stats.nbytes += nbits / 8;
+}
+
+// Read data from SPI interface
+int wifi_bb_spi_read(uint8_t *data, int nbits)
+{
+    uint8_t *start = data;
+    int n = nbits / 8;
+
+    sim_spi_time(nbits);
+    while (n--)
+        *data++ = sim_chip.rdpos < sim_chip.rdlen ? sim_chip.rdbuf[sim_chip.rdpos++] : 0;
+    display(DISP_SPI, "Rd_SPI ");
+    disp_bytes(DISP_SPI, start, nbits / 8);
+    display(DISP_SPI, "\n");
+    return (nbits);
+}
+
+// Write data to SPI interface
+void wifi_bb_spi_write(uint8_t *data, int nbits)
+{
+    int n = nbits / 8;
+
+    sim_spi_time(nbits);
+    display(DISP_SPI, "Wr_SPI ");
+    disp_bytes(DISP_SPI, data, n);
+    display(DISP_SPI, "\n");
+    while (n-- && sim_chip.wrlen < SIM_BUFLEN)
+    {
+        sim_chip.wrbuf[sim_chip.wrlen++] = *data++;
+        if (sim_chip.wrlen == 4)
+            sim_command();
+    }
+}
+
+// Decode the command word at the start of a transaction
+void sim_command(void)
+{
+    uint32_t cmd = get_le(sim_chip.wrbuf, 4);
+    SPI_MSG_HDR hdr;
+
+    if (sim_chip.swap)
+        cmd = SWAP16_2(cmd);
+    memcpy(&hdr, &cmd, sizeof(hdr));
+    sim_chip.wr = hdr.wr;
+    sim_chip.func = hdr.func;
+    sim_chip.addr = hdr.addr;
+    sim_chip.len = hdr.len ? hdr.len : SIM_BUFLEN;
+    if (!sim_chip.wr)
+    {
+        memset(sim_chip.rdbuf, 0, sim_chip.len);
+        sim_chip.rdlen = sim_chip.len;
+        if (sim_chip.func == SD_FUNC_BUS)
+            sim_read_bus();
+        else if (sim_chip.func == SD_FUNC_BAK)
+            sim_read_bak();
+        else if (sim_chip.func == SD_FUNC_RAD)
+            sim_read_rad();
+        else
+            wifi_sim_stats.errors++;
+    }
+}
+
+// Handle the data at the end of a write transaction
+void sim_write_end(void)
+{
+    uint8_t *data = &sim_chip.wrbuf[4];
+    int n = MIN(sim_chip.wrlen - 4, sim_chip.len);
+
+    if (n <= 0)
+        return;
+    if (sim_chip.swap && n == 4)
+        put_le(data, SWAP16_2(get_le(data, 4)), 4);
+    if (sim_chip.func == SD_FUNC_BUS)
+        sim_write_bus(data, n);
+    else if (sim_chip.func == SD_FUNC_BAK)
+        sim_write_bak(data, n);
+    else if (sim_chip.func == SD_FUNC_RAD)
+        sim_write_rad(data, n);
+    else
+        wifi_sim_stats.errors++;
+}
+
+// Read SPI bus registers
+void sim_read_bus(void)
+{
+    uint8_t regs[SIM_BUS_REGS];
+    int n = MIN(sim_chip.len, SIM_BUS_REGS - sim_chip.addr);
+
+    memcpy(regs, sim_chip.bus_regs, sizeof(regs));
+    if (sim_frame_due())
+        regs[SPI_INTERRUPT_REG] |= SPI_INT_F2_PACKET_AVAILABLE;
+    put_le(&regs[SPI_STATUS_REG], sim_status(), 4);
+    put_le(&regs[0x14], SPI_TEST_VALUE, 4);
+    if (n > 0)
+        memcpy(sim_chip.rdbuf, &regs[sim_chip.addr], n);
+    if (sim_chip.swap && sim_chip.len == 4)
+        put_le(sim_chip.rdbuf, SWAP16_2(get_le(sim_chip.rdbuf, 4)), 4);
+}
+
+// Read backplane: config registers, chip RAM or core registers
+// Response has 4 bytes of padding before the data
+void sim_read_bak(void)
+{
+    uint32_t addr = sim_chip.addr, val;
+    uint8_t *dp = &sim_chip.rdbuf[4];
+    int n = sim_chip.len - 4;
+
+    if (n <= 0)
+        return;
+    if (addr >= SIM_CFG_BASE)
+    {
+        addr -= SIM_CFG_BASE;
+        if (addr + n <= SIM_CFG_REGS)
+            memcpy(dp, &sim_chip.cfg_regs[addr], n);
+        if (addr + SIM_CFG_BASE == BAK_CHIP_CLOCK_CSR_REG)
+            dp[0] = (dp[0] & 0x3f) | 0x40 | (sim_chip.running ? 0x80 : 0);
+    }
+    else
+    {
+        addr = (sim_chip.window & SB_WIN_MASK) | (addr & SB_ADDR_MASK);
+        if (addr + n <= SIM_RAM_SIZE)
+            memcpy(dp, &sim_ram[addr], n);
+        else if (n <= 4)
+        {
+            val = sim_reg_get(addr);
+            put_le(dp, val, n);
+        }
+    }
+}
+
+// Read frame from radio function
+void sim_read_rad(void)
+{
+    SIM_FRAME *fp = sim_frame_due();
+    SDPCM_HDR *sdp;
+
+    if (!fp)
+        wifi_sim_stats.errors++;
+    else
+    {
+        // Sequence number and transmit credit are set when frame is sent
+        sdp = (SDPCM_HDR *)fp->data;
+        sdp->seq = sim_chip.seq++;
+        sdp->credit = sdp->seq + (uint8_t)(sim_cfg.txq - sim_txq_count());
+        memcpy(sim_chip.rdbuf, fp->data, MIN(fp->len, sim_chip.len));
+        sim_frame_remove();
+    }
+}
+
+// Return SPI status register value
+uint32_t sim_status(void)
+{
+    SIM_FRAME *fp = sim_frame_due();
+    uint32_t val = 0;
+
+    if (sim_chip.running)
+    {
+        if (sim_txq_count() < (int)sim_cfg.txq)
+            val |= SPI_STATUS_F2_RX_READY;
+        else
+            wifi_sim_stats.tx_notready++;
+    }
+    if (fp)
+        val |= SPI_STATUS_PKT_AVAIL | SPI_STATUS_F2_INTR |
+               (fp->len & SPI_STATUS_LEN_MASK) << SPI_STATUS_LEN_SHIFT;
+    return (val);
+}
+
+// Write SPI bus registers
+void sim_write_bus(uint8_t *data, int n)
+{
+    uint32_t val = get_le(data, n);
+
+    if (sim_chip.addr == SPI_BUS_CONTROL_REG)
+        sim_chip.swap = !(val & 1);
+    if (sim_chip.addr == SPI_INTERRUPT_REG)
+        put_le(&sim_chip.bus_regs[SPI_INTERRUPT_REG],
+               get_le(&sim_chip.bus_regs[SPI_INTERRUPT_REG], 2) & ~val, 2);
+    else if (sim_chip.addr + n <= SIM_BUS_REGS)
+        memcpy(&sim_chip.bus_regs[sim_chip.addr], data, n);
+}
+
+// Write backplane: config registers, chip RAM or core registers
+void sim_write_bak(uint8_t *data, int n)
+{
+    uint32_t addr = sim_chip.addr;
+
+    if (addr >= SIM_CFG_BASE)
+    {
+        if (addr == BAK_WIN_ADDR_REG)
+            sim_chip.window = get_le(data, MIN(n, 3)) << 8;
+        else if (addr == SPI_FRAME_CONTROL && (data[0] & 1) && sim_frame_due())
+        {
+            sim_frame_remove();
+            wifi_sim_stats.rx_discards++;
+        }
+        addr -= SIM_CFG_BASE;
+        if (addr + n <= SIM_CFG_REGS)
+            memcpy(&sim_chip.cfg_regs[addr], data, n);
+    }
+    else
+    {
+        addr = (sim_chip.window & SB_WIN_MASK) | (addr & SB_ADDR_MASK);
+        if (addr + n <= SIM_RAM_SIZE)
+        {
+            memcpy(&sim_ram[addr], data, n);
+            wifi_sim_stats.fw_bytes += n;
+        }
+        else if (n <= 4)
+        {
+            sim_reg_set(addr, get_le(data, n));
+            // Firmware starts when ARM core is taken out of reset
+            if (addr == ARM_CORE_ADDR + AI_RESETCTRL_OSET && data[0] == 0)
+                sim_chip.running = wifi_sim_stats.fw_bytes > 0;
+        }
+    }
+}
+
+// Write frame to radio function: IOCTL or network data
+void sim_write_rad(uint8_t *data, int n)
+{
+    SDPCM_HDR *sdp = (SDPCM_HDR *)data;
+    BDC_HDR *bdcp;
+    uint64_t t;
+    int oset;
+
+    if (n < (int)sizeof(SDPCM_HDR) || (sdp->len ^ sdp->notlen) != 0xffff ||
+        sdp->len > n || sdp->hdrlen < sizeof(SDPCM_HDR) || !sim_chip.running)
+        wifi_sim_stats.errors++;
+    else if (sdp->chan == SDPCM_CHAN_CTRL)
+        sim_ioctl(sdp, sdp->len);
+    else if (sdp->chan == SDPCM_CHAN_DATA && sdp->hdrlen + (int)sizeof(BDC_HDR) <= sdp->len)
+    {
+        bdcp = (BDC_HDR *)&data[sdp->hdrlen];
+        oset = sdp->hdrlen + sizeof(BDC_HDR) + bdcp->offset * 4;
+        if (sim_txq_count() >= (int)sim_cfg.txq || sim_txq_count() >= SIM_TXQ_MAX)
+            wifi_sim_stats.tx_overflows++;
+        else if (oset <= sdp->len)
+        {
+            // Frame is sent when those ahead of it have gone
+            t = sim_chip.txq_count ? sim_chip.txq[(sim_chip.txq_in + SIM_TXQ_MAX - 1) % SIM_TXQ_MAX] : sim_nsec;
+            t = MAX(t, sim_nsec);
+            if (sim_cfg.air_rate)
+                t += (uint64_t)(sdp->len - oset) * 1000000000ULL / sim_cfg.air_rate;
+            sim_chip.txq[sim_chip.txq_in] = t;
+            sim_chip.txq_in = (sim_chip.txq_in + 1) % SIM_TXQ_MAX;
+            sim_chip.txq_count++;
+            wifi_sim_stats.tx_frames++;
+            if (sim_cfg.tx_handler)
+                sim_cfg.tx_handler(&data[oset], sdp->len - oset);
+        }
+    }
+    else
+        wifi_sim_stats.errors++;
+}
+
+// Handle IOCTL command, queue the response
+void sim_ioctl(SDPCM_HDR *sdp, int len)
+{
+    uint8_t *data = (uint8_t *)sdp + sdp->hdrlen;
+    IOCTL_HDR *iohp = (IOCTL_HDR *)data;
+    uint8_t *dp = data + sizeof(IOCTL_HDR);
+    int dlen = MIN(iohp->outlen, len - sdp->hdrlen - (int)sizeof(IOCTL_HDR));
+    char *name = (char *)dp;
+    uint32_t cmd = iohp->cmd;
+    bool joined;
+
+    wifi_sim_stats.nioctls++;
+    if (dlen < 0)
+    {
+        wifi_sim_stats.errors++;
+        return;
+    }
+    if (cmd == WLC_SET_VAR && !strcmp(name, "clmload"))
+        wifi_sim_stats.clm_bytes += dlen - (int)(strlen(name) + 1 + 12);
+    else if (cmd == WLC_UP)
+        sim_chip.up = true;
+    else if (cmd == WLC_DOWN || cmd == WLC_DISASSOC)
+    {
+        if (sim_chip.linked)
+            sim_event(WLC_E_LINK, 0, 0, sim_cfg.ioctl_usec);
+        sim_chip.linked = false;
+        sim_chip.up = sim_chip.up && cmd != WLC_DOWN;
+    }
+    else if (cmd == WLC_SET_WSEC_PMK && dlen >= 4)
+    {
+        memset(sim_chip.pmk, 0, sizeof(sim_chip.pmk));
+        memcpy(sim_chip.pmk, dp + 4, MIN(*(uint16_t *)dp, SIM_PSK_MAXLEN));
+        sim_chip.pmk_set = true;
+    }
+    else if (cmd == WLC_SET_SSID && dlen >= 4)
+    {
+        joined = sim_chip.up && *(uint32_t *)dp == strlen(sim_cfg.ssid) &&
+                 !memcmp(dp + 4, sim_cfg.ssid, strlen(sim_cfg.ssid));
+        if (!joined)
+            sim_event(WLC_E_SET_SSID, 3, 0, sim_cfg.join_usec);
+        else if (sim_cfg.passwd && (!sim_chip.pmk_set || strcmp((char *)sim_chip.pmk, sim_cfg.passwd)))
+            sim_event(WLC_E_SET_SSID, 1, 0, sim_cfg.join_usec);
+        else
+        {
+            sim_event(WLC_E_LINK, 0, 1, sim_cfg.join_usec);
+            sim_event(WLC_E_PSK_SUP, 6, 0, sim_cfg.join_usec);
+            sim_event(WLC_E_SET_SSID, 0, 0, sim_cfg.join_usec);
+            sim_chip.linked = true;
+        }
+    }
+    else if (cmd == WLC_GET_VAR)
+    {
+        if (!strcmp(name, "cur_etheraddr"))
+            memcpy(dp, sim_mac, MIN(dlen, (int)sizeof(sim_mac)));
+        else if (!strcmp(name, "ver"))
+            strncpy((char *)dp, SIM_VERSION, dlen);
+        else
+            memset(dp, 0, dlen);
+    }
+    else if (!(iohp->flags & 2))
+        memset(dp, 0, dlen);
+    iohp->status = 0;
+    iohp->inlen = 0;
+    sim_frame_add(SDPCM_CHAN_CTRL, sim_cfg.ioctl_usec, sizeof(SDPCM_HDR),
+                  data, sizeof(IOCTL_HDR) + dlen);
+}
+
+// Queue an async event for the host
+void sim_event(uint32_t evt, uint32_t status, uint16_t flags, uint32_t usec)
+{
+    struct {
+        BDC_HDR bdc;
+        ETHER_HDR ether;
+        BCMETH_HDR bcmeth;
+        EVENT_HDR eventh;
+    } msg;
+    uint16_t blen = sizeof(msg) - sizeof(BDC_HDR) - sizeof(ETHER_HDR);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.bdc.flags = 0x20;
+    memcpy(msg.ether.dest_addr, sim_mac, 6);
+    memcpy(msg.ether.srce_addr, sim_bssid, 6);
+    msg.ether.type = SWAP16(0x886c);
+    msg.bcmeth.subtype = SWAP16(0x8001);
+    msg.bcmeth.len = SWAP16(blen);
+    msg.bcmeth.oui[1] = 0x10;
+    msg.bcmeth.oui[2] = 0x18;
+    msg.bcmeth.usr_subtype = SWAP16(1);
+    msg.eventh.ver = SWAP16(2);
+    msg.eventh.flags = SWAP16(flags);
+    msg.eventh.event_type = SWAP32(evt);
+    msg.eventh.status = SWAP32(status);
+    memcpy(msg.eventh.addr, sim_bssid, 6);
+    strcpy(msg.eventh.ifname, "wlan0");
+    if (sim_frame_add(SDPCM_CHAN_EVT, usec, sizeof(SDPCM_HDR), &msg, sizeof(msg)))
+        wifi_sim_stats.nevents++;
+}
+
+// Add frame to host queue, keeping it in order of due time
+// Return null if queue is full
+SIM_FRAME *sim_frame_add(int chan, uint32_t usec, int hdrlen, void *data, int dlen)
+{
+    uint64_t due = sim_nsec + (uint64_t)usec * 1000;
+    SIM_FRAME *fp;
+    SDPCM_HDR *sdp;
+    int n = sim_chip.nframes;
+
+    if (n >= SIM_NFRAMES || hdrlen + dlen > SIM_FRAMESIZE)
+        return (0);
+    while (n > 0 && sim_chip.frames[n-1].due > due)
+    {
+        sim_chip.frames[n] = sim_chip.frames[n-1];
+        n--;
+    }
+    fp = &sim_chip.frames[n];
+    sim_chip.nframes++;
+    memset(fp->data, 0, hdrlen);
+    memcpy(&fp->data[hdrlen], data, dlen);
+    fp->due = due;
+    fp->len = hdrlen + dlen;
+    sdp = (SDPCM_HDR *)fp->data;
+    sdp->notlen = ~(sdp->len = fp->len);
+    sdp->chan = chan;
+    sdp->hdrlen = sizeof(SDPCM_HDR);
+    if (chan == SDPCM_CHAN_DATA)
+        wifi_sim_stats.rx_frames++;
+    return (fp);
+}
+
+// Return frame at head of host queue, if it is due
+SIM_FRAME *sim_frame_due(void)
+{
+    return (sim_chip.nframes && sim_chip.frames[0].due <= sim_nsec ? &sim_chip.frames[0] : 0);
+}
+
+// Remove frame at head of host queue
+void sim_frame_remove(void)
+{
+    if (sim_chip.nframes > 0)
+    {
+        sim_chip.nframes--;
+        memmove(&sim_chip.frames[0], &sim_chip.frames[1], sim_chip.nframes * sizeof(SIM_FRAME));
+    }
+}
+
+// Return number of frames in transmit queue, removing those that have been sent
+int sim_txq_count(void)
+{
+    int out = (sim_chip.txq_in + SIM_TXQ_MAX - sim_chip.txq_count) % SIM_TXQ_MAX;
+
+    while (sim_chip.txq_count > 0 && sim_chip.txq[out] <= sim_nsec)
+    {
+        out = (out + 1) % SIM_TXQ_MAX;
+        sim_chip.txq_count--;
+    }
+    return (sim_chip.txq_count);
+}
+
+// Get core register value
+uint32_t sim_reg_get(uint32_t addr)
+{
+    for (int i = 0; i < sim_chip.nregs; i++)
+    {
+        if (sim_chip.regs[i].addr == addr)
+            return (sim_chip.regs[i].val);
+    }
+    return (0);
+}
+
+// Set core register value
+void sim_reg_set(uint32_t addr, uint32_t val)
+{
+    int i = 0;
+
+    while (i < sim_chip.nregs && sim_chip.regs[i].addr != addr)
+        i++;
+    if (i < SIM_NREGS)
+    {
+        sim_chip.regs[i].addr = addr;
+        sim_chip.regs[i].val = val;
+        sim_chip.nregs = MAX(sim_chip.nregs, i + 1);
+    }
+}
+
+// Get little-endian value of 1 to 4 bytes
+uint32_t get_le(uint8_t *data, int n)
+{
+    uint32_t val = 0;
+
+    while (n-- > 0)
+        val = (val << 8) | data[n];
+    return (val);
+}
+
+// Put little-endian value of 1 to 4 bytes
+void put_le(uint8_t *data, uint32_t val, int n)
+{
+    while (n-- > 0)
+    {
+        *data++ = (uint8_t)val;
+        val >>= 8;
+    }
+}
+
+// EOF
@@ -0,0 +1,64 @@
+// Definitions for CYW43439 WiFi chip simulation, on SPI bus
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define SIM_RAM_SIZE        0x80000 // Chip RAM size (firmware and NVRAM)
+#define SIM_FRAMESIZE       1600    // Maximum SDPCM frame size
+#define SIM_NFRAMES         64      // Maximum frames queued for the host
+#define SIM_TXQ_MAX         64      // Maximum depth of chip transmit queue
+#define SIM_BUFLEN          2048    // Maximum SPI transaction length
+
+// Chip and network model
+typedef struct {
+    char *ssid;                     // Network that can be joined
+    char *passwd;                   // Its password, null if any is accepted
+    uint32_t ioctl_usec;            // Time to respond to an IOCTL
+    uint32_t join_usec;             // Time to join the network
+    uint32_t air_rate;              // Transmit rate over the air (bytes/sec)
+    uint32_t txq;                   // Frames in transmit queue before not-ready
+    uint32_t cs_nsec;               // Overhead of each SPI transaction (nsec)
+    void (*tx_handler)(uint8_t *data, int len);   // Called with transmit data
+} WIFI_SIM_CONFIG;
+
+// Statistics
+typedef struct {
+    uint32_t ntrans;                // SPI transactions
+    uint64_t nbytes;                // Bytes transferred over SPI
+    uint64_t bus_nsec;              // Time spent on SPI transfers
+    uint32_t fw_bytes;              // Firmware and NVRAM bytes loaded
+    uint32_t clm_bytes;             // CLM bytes loaded
+    uint32_t nioctls, nevents;      // IOCTL commands, and async events sent
+    uint32_t rx_frames, tx_frames;  // Network data frames to & from host
+    uint32_t rx_discards;           // Frames discarded by host
+    uint32_t tx_notready;           // Status reads with F2 not ready
+    uint32_t tx_overflows;          // Frames written when F2 not ready
+    uint32_t errors;                // Bad commands or frames
+} WIFI_SIM_STATS;
+
+extern WIFI_SIM_STATS wifi_sim_stats;
+
+void wifi_sim_init(WIFI_SIM_CONFIG *cfgp);
+uint64_t wifi_sim_usec(void);
+bool wifi_sim_rx_frame(uint8_t *data, int len);
+int wifi_sim_rx_space(void);
+bool wifi_sim_led(void);
+
+// EOF
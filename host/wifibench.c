@@ -0,0 +1,247 @@
+// WiCap WiFi driver benchmark, using simulated CYW43439 chip
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The Mongoose WiFi driver (mg_wifi.c) and picowi run unchanged on a model
+// of the WiFi chip and its SPI bus (wifi_sim.c). The chip is initialised, and
+// a network is joined; then network frames are received and transmitted,
+// and their contents are checked. Simulated time, SPI transactions and bytes
+// per frame are displayed, with the host CPU time per frame; simulated time
+// includes the SPI transfers, IOCTL response times, and transmit flow control.
+//
+// Usage: wifibench [options]
+//   -n <frames>     number of frames to receive and transmit (default 1000)
+//   -s <bytes>      frame size (default 1514)
+//   -f <Hz>         SPI clock frequency (default from WiFi profile)
+//   -q <frames>     chip transmit queue size (default 8)
+//   -r <bytes/sec>  transmit rate over the air (default 2500000)
+//   -i <usec>       IOCTL response time (default 200)
+//   -d <mask>       picowi diagnostic display mask (default 0)
+//   -p              display profile of receive & transmit (host nanoseconds)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../mongoose.h"
+#include "../mg_wifi.h"
+#include "../picowi/picowi_defs.h"
+#include "../picowi/picowi_pico.h"
+#include "../picowi/picowi_wifi.h"
+#include "../picowi/picowi_prof.h"
+#include "wifi_sim.h"
+
+#define TIMEOUT_USEC    30000000
+#define IDLE_USEC       100
+#define MAX_FRAMESIZE   1514
+#define MIN_FRAMESIZE   60
+
+// Measurements for one stage of the test
+typedef struct {
+    uint64_t usec, cpu_nsec, nbytes;
+    uint32_t ntrans;
+} BENCH_STAGE;
+
+extern struct mg_tcpip_driver mg_tcpip_driver_wifi;
+extern void set_display_mode(int mask);
+extern uint32_t wifi_spi_freq;
+
+bool force_down;
+int frame_size = MAX_FRAMESIZE;
+uint32_t tx_count, tx_errors;
+
+// Return CPU time in nanoseconds
+uint64_t cpu_nsec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+// Start measuring a stage
+void stage_start(BENCH_STAGE *sp)
+{
+    sp->usec = wifi_sim_usec();
+    sp->cpu_nsec = cpu_nsec();
+    sp->nbytes = wifi_sim_stats.nbytes;
+    sp->ntrans = wifi_sim_stats.ntrans;
+}
+
+// End measurement, display results per frame if frame count is non-zero
+void stage_end(BENCH_STAGE *sp, char *name, int nframes)
+{
+    int n = nframes > 0 ? nframes : 1;
+
+    sp->usec = wifi_sim_usec() - sp->usec;
+    sp->cpu_nsec = cpu_nsec() - sp->cpu_nsec;
+    sp->nbytes = wifi_sim_stats.nbytes - sp->nbytes;
+    sp->ntrans = wifi_sim_stats.ntrans - sp->ntrans;
+    if (nframes <= 0)
+        printf("%s: %.3f sec, %u SPI transactions, %lu SPI bytes, CPU %.3f msec\n",
+            name, sp->usec / 1e6, sp->ntrans, (unsigned long)sp->nbytes, sp->cpu_nsec / 1e6);
+    else
+        printf("%s: %d frames, %.1f usec/frame, %.1f transactions/frame, "
+            "%.0f SPI bytes/frame, CPU %.0f nsec/frame, %.0f bytes/sec\n",
+            name, nframes, (double)sp->usec / n, (double)sp->ntrans / n,
+            (double)sp->nbytes / n, (double)sp->cpu_nsec / n,
+            sp->usec ? nframes * frame_size * 1e6 / sp->usec : 0.0);
+}
+
+// Fill frame with test data
+void frame_fill(uint8_t *data, int len, uint32_t n)
+{
+    for (int i = 0; i < len; i++)
+        data[i] = (uint8_t)(n + i * 7);
+}
+
+// Check frame test data
+bool frame_check(uint8_t *data, int len, uint32_t n)
+{
+    for (int i = 0; i < len; i++)
+    {
+        if (data[i] != (uint8_t)(n + i * 7))
+            return (false);
+    }
+    return (true);
+}
+
+// Check a frame transmitted by the driver
+void tx_handler(uint8_t *data, int len)
+{
+    if (len != frame_size || !frame_check(data, len, tx_count))
+        tx_errors++;
+    tx_count++;
+}
+
+int main(int argc, char *argv[])
+{
+    WIFI_SIM_CONFIG cfg = {.ssid="testnet", .passwd="testpass", .ioctl_usec=200,
+        .join_usec=50000, .air_rate=2500000, .txq=8, .cs_nsec=500, .tx_handler=tx_handler};
+    struct mg_tcpip_driver *drvp = &mg_tcpip_driver_wifi;
+    struct mg_tcpip_if ifp;
+    static uint8_t buff[MAX_FRAMESIZE];
+    BENCH_STAGE stage;
+    uint32_t spi_freq = 0, nrx = 0, rx_errors = 0, nq = 0, ntx = 0;
+    int nframes = 1000, disp = 0, opt, n;
+    bool ok, prof = false;
+
+    while ((opt = getopt(argc, argv, "n:s:f:q:r:i:d:p")) != -1)
+    {
+        if (opt == 'n')
+            nframes = atoi(optarg);
+        else if (opt == 's')
+            frame_size = MAX(MIN(atoi(optarg), MAX_FRAMESIZE), MIN_FRAMESIZE);
+        else if (opt == 'f')
+            spi_freq = atoi(optarg);
+        else if (opt == 'q')
+            cfg.txq = MIN(atoi(optarg), SIM_TXQ_MAX);
+        else if (opt == 'r')
+            cfg.air_rate = atoi(optarg);
+        else if (opt == 'i')
+            cfg.ioctl_usec = atoi(optarg);
+        else if (opt == 'd')
+            disp = strtol(optarg, 0, 0);
+        else if (opt == 'p')
+            prof = true;
+        else
+        {
+            printf("Usage: wifibench [-n frames] [-s size] [-f spi_freq] [-q txq] "
+                   "[-r air_rate] [-i ioctl_usec] [-d display_mask] [-p]\n");
+            return (1);
+        }
+    }
+    wifi_sim_init(&cfg);
+    memset(&ifp, 0, sizeof(ifp));
+
+    // Initialise chip, start joining network
+    stage_start(&stage);
+    ok = drvp->init(&ifp);
+    set_display_mode(disp);
+    stage_end(&stage, "Initialise", 0);
+    printf("Firmware %u bytes, CLM %u bytes, %u IOCTLs\n",
+        wifi_sim_stats.fw_bytes, wifi_sim_stats.clm_bytes, wifi_sim_stats.nioctls);
+    if (spi_freq)
+        wifi_set_spi_freq(spi_freq);
+
+    // Poll until joined
+    stage_start(&stage);
+    while (ok && !drvp->up(&ifp) && wifi_sim_usec() < TIMEOUT_USEC)
+    {
+        drvp->rx(buff, sizeof(buff), &ifp);
+        usdelay(IDLE_USEC);
+    }
+    ok = ok && drvp->up(&ifp);
+    stage_end(&stage, "Join", 0);
+
+    // Receive frames, keeping the chip queue topped up
+    prof_init();
+    stage_start(&stage);
+    while (ok && nrx < (uint32_t)nframes && wifi_sim_usec() < TIMEOUT_USEC)
+    {
+        while (nq < (uint32_t)nframes && wifi_sim_rx_space() > 0)
+        {
+            frame_fill(buff, frame_size, nq++);
+            wifi_sim_rx_frame(buff, frame_size);
+        }
+        memset(buff, 0, frame_size);
+        if ((n = drvp->rx(buff, sizeof(buff), &ifp)) > 0)
+        {
+            if (n != frame_size || !frame_check(buff, n, nrx))
+                rx_errors++;
+            nrx++;
+        }
+        else
+            usdelay(IDLE_USEC);
+    }
+    stage_end(&stage, "Receive", nrx);
+
+    // Transmit frames
+    stage_start(&stage);
+    for (ntx = 0; ok && ntx < (uint32_t)nframes; ntx++)
+    {
+        frame_fill(buff, frame_size, ntx);
+        drvp->tx(buff, frame_size, &ifp);
+    }
+    stage_end(&stage, "Transmit", ntx);
+
+    printf("SPI %u Hz: %.1f%% of time on transfers\n", wifi_spi_freq,
+        wifi_sim_usec() ? wifi_sim_stats.bus_nsec / (10.0 * wifi_sim_usec()) : 0.0);
+    printf("Rx: %u frames, %u errors, %u discarded\n", nrx, rx_errors, wifi_sim_stats.rx_discards);
+    printf("Tx: %u frames, %u errors, %u not-ready polls, %u overflows\n",
+        tx_count, tx_errors, wifi_sim_stats.tx_notready, wifi_sim_stats.tx_overflows);
+    printf("Chip: %u events, %u errors, LED %s\n", wifi_sim_stats.nevents,
+        wifi_sim_stats.errors, wifi_sim_led() ? "on" : "off");
+    if (prof)
+    {
+        static char temps[2000];
+        prof_json(temps, sizeof(temps));
+        printf("Profile: %s", temps);
+    }
+    ok = ok && nrx == (uint32_t)nframes && !rx_errors && tx_count == (uint32_t)nframes &&
+         !tx_errors && !wifi_sim_stats.tx_overflows && !wifi_sim_stats.errors;
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return (ok ? 0 : 1);
+}
+
+// EOF
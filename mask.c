@@ -0,0 +1,189 @@
+// Mask (pass/fail) testing of captures
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Each capture is compared with a mask of lower & upper analog bounds, that
+// has been uploaded once by the client; pass & fail counts are kept, and the
+// first few failing captures are saved for later inspection. The mask is
+// aligned on the trigger point, or if the capture wasn't triggered, on the
+// first rising edge through the analog level 'plevel'. If there is no
+// alignment point, the capture fails with a zero count.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "measure.h"
+#include "mask.h"
+
+// The mask is double-buffered: the network core loads a new mask into the
+// spare buffer, then the capture core switches to it between captures
+typedef struct {
+    uint16_t bounds[MASK_MAXPTS * 2];   // Lower bounds [npts], then upper
+    int npts, pre;
+} MASK_BUFF;
+
+MASK_BUFF mask_buffs[2];
+volatile int mask_active, mask_next;    // Buffer in use, buffer to be used
+WORD mask_samps[MASK_NSAVE * MASK_MAXPTS];
+MASK_FAIL mask_recs[MASK_NSAVE];
+int mask_nsaved;
+uint32_t mask_pass, mask_fail;
+
+// Load mask from binary data (header & bounds) into the spare buffer
+// Called from network core, return false if invalid or previous load pending
+bool mask_set(void *data, int len)
+{
+    MASK_HDR hdr;
+    uint16_t *bounds = (uint16_t *)((uint8_t *)data + sizeof(hdr));
+    MASK_BUFF *mp = &mask_buffs[!mask_active];
+
+    if (len < (int)sizeof(hdr) || mask_next != mask_active)
+        return (false);
+    memcpy(&hdr, data, sizeof(hdr));
+    if (memcmp(hdr.magic, MASK_MAGIC, sizeof(hdr.magic)) || hdr.version != MASK_VERSION ||
+        hdr.npts == 0 || hdr.npts > MASK_MAXPTS || hdr.pre >= hdr.npts ||
+        len < (int)(sizeof(hdr) + hdr.npts * 4))
+        return (false);
+    memcpy(mp->bounds, bounds, hdr.npts * 4);
+    mp->npts = hdr.npts;
+    mp->pre = hdr.pre;
+    mask_next = !mask_active;
+    return (true);
+}
+
+// Switch to a newly-loaded mask, and clear the counts
+// Called from capture core, between captures
+void mask_apply(void)
+{
+    if (mask_next != mask_active)
+    {
+        mask_active = mask_next;
+        mask_reset();
+    }
+}
+
+// Get mask header & bounds, return total size in bytes
+int mask_get(MASK_HDR *hdrp, uint16_t **boundsp)
+{
+    MASK_BUFF *mp = &mask_buffs[mask_active];
+    MASK_HDR hdr = {.magic=MASK_MAGIC, .version=MASK_VERSION, .npts=mp->npts, .pre=mp->pre};
+
+    *hdrp = hdr;
+    *boundsp = mp->bounds;
+    return (sizeof(hdr) + mp->npts * 4);
+}
+
+// Return number of samples outside the mask; a branch-free loop, so the 
+// compiler can vectorise it. A negative difference sets the sign bit.
+static int mask_compare(WORD *samps, uint16_t *lo, uint16_t *hi, int n)
+{
+    int fails = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        int x = samps[i] & ANALOG_MASK;
+        fails += (uint32_t)((x - lo[i]) | (hi[i] - x)) >> 31;
+    }
+    return (fails);
+}
+
+// Compare capture with mask, given trigger sample number (-1 if not triggered)
+// Return 1 if pass, 0 if fail, -1 if not enabled
+int mask_update(WORD *samps, int nsamp, int trig)
+{
+    MASK_BUFF *mp = &mask_buffs[mask_active];
+    int fails = 0, first = 0, npts = mp->npts, pre = mp->pre;
+    uint16_t *lo = mp->bounds, *hi = &mp->bounds[npts];
+    WORD *sp = samps;
+
+    if (!get_param_int(ARG_MASK) || npts == 0)
+        return (-1);
+    if (trig < 0)
+        trig = measure_edge(samps, MAX(pre, 1), nsamp - npts + pre,
+            get_param_int(ARG_PLEVEL));
+    if (trig < pre || trig - pre + npts > nsamp)
+        trig = -1;
+    else
+    {
+        sp = &samps[trig - pre];
+        fails = mask_compare(sp, lo, hi, npts);
+    }
+    if (trig >= 0 && fails == 0)
+    {
+        set_param_int(ARG_MPASS, ++mask_pass);
+        return (1);
+    }
+    set_param_int(ARG_MFAIL, ++mask_fail);
+    if (mask_nsaved < MASK_NSAVE)
+    {
+        MASK_FAIL *rp = &mask_recs[mask_nsaved];
+        while (fails && mask_compare(&sp[first], &lo[first], &hi[first], 1) == 0)
+            first++;
+        rp->seq = mask_pass + mask_fail;
+        rp->first = first;
+        rp->count = MIN(fails, 0xffff);
+        memcpy(&mask_samps[mask_nsaved++ * npts], sp, MIN(npts, nsamp) * sizeof(WORD));
+    }
+    return (0);
+}
+
+// Clear the counts & saved captures, called from capture core
+void mask_reset(void)
+{
+    mask_pass = mask_fail = mask_nsaved = 0;
+    set_param_int(ARG_MPASS, 0);
+    set_param_int(ARG_MFAIL, 0);
+}
+
+// Get header, records & samples of saved failures, return total size in bytes
+int mask_fails(MASK_HDR *hdrp, MASK_FAIL **failsp, WORD **sampsp)
+{
+    MASK_BUFF *mp = &mask_buffs[mask_active];
+    MASK_HDR hdr = {.magic=MASK_FAIL_MAGIC, .version=MASK_VERSION, .npts=mp->npts,
+        .pre=mp->pre, .nfails=mask_nsaved};
+
+    *hdrp = hdr;
+    *failsp = mask_recs;
+    *sampsp = mask_samps;
+    return (sizeof(hdr) + mask_nsaved * (sizeof(MASK_FAIL) + mp->npts * sizeof(WORD)));
+}
+
+// Return mask status as JSON string
+int mask_json(char *buff, int maxlen)
+{
+    MASK_BUFF *mp = &mask_buffs[mask_active];
+    int n = snprintf(buff, maxlen, "{\"npts\":%d,\"pre\":%d,\"pass\":%u,\"fail\":%u,\"fails\":[",
+        mp->npts, mp->pre, (uint)mask_pass, (uint)mask_fail);
+
+    for (int i = 0; i < mask_nsaved && n < maxlen; i++)
+        n += snprintf(&buff[n], maxlen - n, "%s{\"seq\":%u,\"first\":%u,\"count\":%u}",
+            i ? "," : "", (uint)mask_recs[i].seq, mask_recs[i].first, mask_recs[i].count);
+    if (n < maxlen)
+        n += snprintf(&buff[n], maxlen - n, "]}");
+    return (MIN(n, maxlen - 1));
+}
+
+// EOF
@@ -0,0 +1,51 @@
+// Mask (pass/fail) testing of captures
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define MASK_MAXPTS     1024        // Max number of points in mask
+#define MASK_NSAVE      4           // Number of failing captures saved
+#define MASK_MAGIC      "WMSK"      // Binary file markers & version
+#define MASK_FAIL_MAGIC "WMSF"
+#define MASK_VERSION    1
+
+// Mask file header, 12 bytes, followed by 16-bit lower & upper bounds [npts]
+// or in the failure file, by the records [nfails] then the samples [nfails][npts]
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version, npts, pre;    // Number of points, points before trigger
+    uint16_t nfails;                // Number of failure records (fail file)
+} MASK_HDR;
+
+// Failing capture record, followed by 16-bit samples [npts]
+typedef struct __attribute__((packed)) {
+    uint32_t seq;                   // Capture number since mask loaded
+    uint16_t first, count;          // First failing point, number of fails
+} MASK_FAIL;
+
+bool mask_set(void *data, int len);
+void mask_apply(void);
+int mask_get(MASK_HDR *hdrp, uint16_t **boundsp);
+int mask_update(WORD *samps, int nsamp, int trig);
+void mask_reset(void);
+int mask_fails(MASK_HDR *hdrp, MASK_FAIL **failsp, WORD **sampsp);
+int mask_json(char *buff, int maxlen);
+
+// EOF
@@ -0,0 +1,226 @@
+// Waveform measurements of captured samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The measurements are made in a single pass through the samples, when a
+// capture completes. The 16 logic lines are handled a word at a time: the
+// edges are found by XORing each sample with the previous one, and only the
+// bits that have changed are examined. The number of high samples on each
+// line is counted using bit-sliced counters, so one sample is added to all
+// 16 counts using a few logical operations. The analog value (the lower bits)
+// uses integer accumulators, and zero-crossing detection with hysteresis.
+// Rise & fall times need the min & max values, so they are found after the
+// pass, by searching either side of the first few zero-crossings.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "measure.h"
+
+MEAS_RESULT meas;
+uint32_t meas_rise_idx[MEAS_EDGES], meas_fall_idx[MEAS_EDGES];
+
+uint32_t edge_samps(WORD *samps, uint32_t *idxs, int n, uint32_t lo, uint32_t hi, bool rising);
+int meas_array(char *buff, int maxlen, char *prefix, int idx);
+
+// Measure the samples
+void measure(WORD *samps, int nsamp, int rate)
+{
+    MEAS_RESULT *mp = &meas;
+    uint16_t planes[MEAS_PLANES] = {0}, prev, carry, t, x, r, f;
+    bool ahigh;
+    int i, b, p;
+
+    memset(mp, 0, sizeof(MEAS_RESULT));
+    mp->nsamp = nsamp = MIN(nsamp, 1 << MEAS_PLANES);
+    mp->rate = rate;
+    mp->min = ANALOG_MASK;
+    if (nsamp <= 0)
+        return;
+    prev = samps[0];
+    ahigh = (prev & ANALOG_MASK) >= ANALOG_ZERO;
+    for (i = 0; i < nsamp; i++)
+    {
+        WORD d = samps[i];
+        uint32_t v = d & ANALOG_MASK;
+        int32_t dv = (int32_t)v - ANALOG_ZERO;
+
+        // Logic lines: add high bits to bit-sliced counters
+        for (carry = d, p = 0; carry && p < MEAS_PLANES; p++)
+        {
+            t = planes[p] & carry;
+            planes[p] ^= carry;
+            carry = t;
+        }
+        // Logic lines: check changed bits for rising & falling edges
+        if ((x = d ^ prev) != 0)
+        {
+            for (r = x & d; r; r &= r - 1)
+            {
+                MEAS_BIT *bp = &mp->bits[__builtin_ctz(r)];
+                if (bp->rises++ == 0)
+                    bp->first = i;
+                bp->last = i;
+            }
+            for (f = x & prev; f; f &= f - 1)
+                mp->bits[__builtin_ctz(f)].falls++;
+            prev = d;
+        }
+        // Analog value
+        mp->min = MIN(mp->min, v);
+        mp->max = MAX(mp->max, v);
+        mp->sum += v;
+        mp->sumsq += (uint32_t)(dv * dv);
+        mp->high += dv >= 0;
+        if (!ahigh && dv > MEAS_HYST)
+        {
+            ahigh = true;
+            if (mp->rises < MEAS_EDGES)
+                meas_rise_idx[mp->rises] = i;
+            if (mp->rises++ == 0)
+                mp->first = i;
+            mp->last = i;
+        }
+        else if (ahigh && dv < -MEAS_HYST)
+        {
+            ahigh = false;
+            if (mp->falls < MEAS_EDGES)
+                meas_fall_idx[mp->falls] = i;
+            mp->falls++;
+        }
+    }
+    // Logic lines: get high-count totals from bit-sliced counters
+    for (b = 0; b < MEAS_NBITS; b++)
+    {
+        for (p = 0; p < MEAS_PLANES; p++)
+            mp->bits[b].high |= ((planes[p] >> b) & 1) << p;
+    }
+    // Analog rise & fall times, between 10% and 90% levels
+    uint32_t lo = mp->min + (mp->max - mp->min) / 10, hi = mp->max - (mp->max - mp->min) / 10;
+    mp->rise_samps = edge_samps(samps, meas_rise_idx, MIN(mp->rises, MEAS_EDGES), lo, hi, true);
+    mp->fall_samps = edge_samps(samps, meas_fall_idx, MIN(mp->falls, MEAS_EDGES), lo, hi, false);
+}
+
+// Return average number of samples taken by analog edges, given crossing points
+uint32_t edge_samps(WORD *samps, uint32_t *idxs, int n, uint32_t lo, uint32_t hi, bool rising)
+{
+    uint32_t total = 0, start, end;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        start = end = idxs[i];
+        if (rising)
+        {
+            while (start > 0 && (samps[start-1] & ANALOG_MASK) > lo)
+                start--;
+            while (end < meas.nsamp-1 && (samps[end] & ANALOG_MASK) < hi)
+                end++;
+        }
+        else
+        {
+            while (start > 0 && (samps[start-1] & ANALOG_MASK) < hi)
+                start--;
+            while (end < meas.nsamp-1 && (samps[end] & ANALOG_MASK) > lo)
+                end++;
+        }
+        total += end - start;
+    }
+    return (n ? (total + n/2) / n : 0);
+}
+
+// Return sample number of first rising edge through analog level, between
+// given first & last samples (first must be at least 1), -1 if none
+int measure_edge(WORD *samps, int first, int last, int level)
+{
+    for (int i = first; i <= last; i++)
+    {
+        if ((int)(samps[i - 1] & ANALOG_MASK) < level && (int)(samps[i] & ANALOG_MASK) >= level)
+            return (i);
+    }
+    return (-1);
+}
+
+// Return frequency, given number of rising edges, and first & last positions
+static double meas_freq(uint32_t rises, uint32_t first, uint32_t last)
+{
+    return (rises >= 2 && last > first ? (double)(rises - 1) * meas.rate / (last - first) : 0);
+}
+
+// Return measurements as JSON string
+int measure_json(char *buff, int maxlen)
+{
+    MEAS_RESULT *mp = &meas;
+    int n, nsamp = MAX(mp->nsamp, 1);
+    double mean = (double)mp->sum / nsamp, dm = mean - ANALOG_ZERO;
+    double rms = sqrt(MAX((double)mp->sumsq / nsamp - dm * dm, 0));
+    double freq = meas_freq(mp->rises, mp->first, mp->last), us = 1e6 / MAX(mp->rate, 1);
+
+    n = snprintf(buff, maxlen, "{\"nsamp\":%u,\"rate\":%u,\"analog\":{\"min\":%u,\"max\":%u,"
+        "\"vpp\":%u,\"mean\":%.1f,\"rms\":%.1f,\"duty\":%.1f,\"freq\":%.6g,\"period_us\":%.6g,"
+        "\"rise_us\":%.4g,\"fall_us\":%.4g},\"logic\":{", 
+        (uint)mp->nsamp, (uint)mp->rate, (uint)(mp->nsamp ? mp->min : 0), (uint)mp->max, 
+        (uint)(mp->nsamp ? mp->max - mp->min : 0), mean, rms, 100.0 * mp->high / nsamp,
+        freq, freq ? 1e6 / freq : 0, mp->rise_samps * us, mp->fall_samps * us);
+    for (int i = 0; i < 5 && n < maxlen; i++)
+        n += meas_array(&buff[n], maxlen - n, i ? "," : "", i);
+    if (n < maxlen)
+        n += snprintf(&buff[n], maxlen - n, "}}");
+    return (MIN(n, maxlen - 1));
+}
+
+// Get binary header & pointer to measurements, return total length
+int measure_get(MEAS_HDR *hdrp, MEAS_RESULT **mpp)
+{
+    MEAS_HDR hdr = {.magic=MEAS_MAGIC, .version=MEAS_VERSION, .recsize=sizeof(MEAS_RESULT)};
+
+    *hdrp = hdr;
+    *mpp = &meas;
+    return (sizeof(MEAS_HDR) + sizeof(MEAS_RESULT));
+}
+
+// Return JSON array of logic measurements, given index number
+int meas_array(char *buff, int maxlen, char *prefix, int idx)
+{
+    static const char *names[] = {"rises", "falls", "duty", "freq", "period_us"};
+    int n = snprintf(buff, maxlen, "%s\"%s\":[", prefix, names[idx]);
+
+    for (int b = 0; b < MEAS_NBITS && n < maxlen; b++)
+    {
+        MEAS_BIT *bp = &meas.bits[b];
+        double freq = meas_freq(bp->rises, bp->first, bp->last);
+        double val = idx == 0 ? bp->rises : idx == 1 ? bp->falls : 
+                     idx == 2 ? 100.0 * bp->high / MAX(meas.nsamp, 1) :
+                     idx == 3 ? freq : freq ? 1e6 / freq : 0;
+        n += snprintf(&buff[n], maxlen - n, "%s%.*g", b ? "," : "", idx == 2 ? 3 : 6, val);
+    }
+    if (n < maxlen)
+        n += snprintf(&buff[n], maxlen - n, "]");
+    return (n);
+}
+
+// EOF
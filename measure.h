@@ -0,0 +1,58 @@
+// Waveform measurements of captured samples
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define MEAS_NBITS      16          // Number of logic lines
+#define MEAS_PLANES     17          // Bit-planes for high-count (max 2^17 samples)
+#define MEAS_HYST       8           // Analog hysteresis (ADC units)
+#define MEAS_EDGES      8           // Number of analog edges for rise/fall time
+#define MEAS_MAGIC      "WMEA"      // Binary record marker & version
+#define MEAS_VERSION    1
+
+// Results for a logic line (1 bit of the sample)
+typedef struct {
+    uint32_t rises, falls, high;    // Number of edges & high samples
+    uint32_t first, last;           // Sample number of first & last rising edges
+} MEAS_BIT;
+
+// Results of analog & logic measurements
+// 64-bit values first, so the binary record has no internal padding
+typedef struct {
+    uint64_t sum, sumsq;            // Analog sum, and sum of squares from zero
+    uint32_t nsamp, rate;           // Number of samples & sample rate
+    uint32_t min, max, high;        // Analog min, max, samples above zero
+    uint32_t rises, falls, first, last;
+    uint32_t rise_samps, fall_samps;// Analog 10-90% rise & fall times (samples)
+    MEAS_BIT bits[MEAS_NBITS];
+} MEAS_RESULT;
+
+// Binary record header, 8 bytes, followed by MEAS_RESULT
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version, recsize;
+} MEAS_HDR;
+
+void measure(WORD *samps, int nsamp, int rate);
+int measure_json(char *buff, int maxlen);
+int measure_get(MEAS_HDR *hdrp, MEAS_RESULT **mpp);
+int measure_edge(WORD *samps, int first, int last, int level);
+
+// EOF
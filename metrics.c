@@ -0,0 +1,88 @@
+// Prometheus-format metrics for WiCap web server
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The text is created once, with a fixed-width field for each value. When
+// the metrics are requested, the values are right-justified in their fields,
+// so the response only needs simple integer-to-decimal conversions.
+// Prometheus allows any number of spaces between name and value
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+
+#define METRICS_TEXTLEN     3000
+
+const METRIC_DEF metric_defs[NUM_METRICS] = { METRIC_DEFS };
+int64_t metric_vals[NUM_METRICS];
+char metrics_text[METRICS_TEXTLEN];
+int metrics_len, metric_osets[NUM_METRICS];
+
+// Create text template, with blank value fields
+void metrics_init(void)
+{
+    const METRIC_DEF *mdp = metric_defs;
+    int n = 0;
+
+    for (int i = 0; i < NUM_METRICS; i++, mdp++)
+    {
+        n += snprintf(&metrics_text[n], sizeof(metrics_text) - n,
+            "# HELP %s %s\n# TYPE %s %s\n%s ", 
+            mdp->name, mdp->help, mdp->name, mdp->type, mdp->name);
+        metric_osets[i] = n;
+        n += snprintf(&metrics_text[n], sizeof(metrics_text) - n, "%*s\n", METRICS_FIELDLEN, "");
+    }
+    metrics_len = n;
+}
+
+// Write right-justified decimal value into field
+static void metric_field(char *s, int64_t val)
+{
+    bool neg = val < 0;
+    uint64_t v = neg ? -val : val;
+    int n = METRICS_FIELDLEN;
+
+    do
+    {
+        s[--n] = '0' + v % 10;
+        v /= 10;
+    } while (v && n > 1);
+    if (neg)
+        s[--n] = '-';
+    while (n > 0)
+        s[--n] = ' ';
+}
+
+// Update values in text, return pointer & length
+char *metrics_render(int *lenp)
+{
+    if (!metrics_len)
+        metrics_init();
+    for (int i = 0; i < NUM_METRICS; i++)
+        metric_field(&metrics_text[metric_osets[i]], metric_vals[i]);
+    *lenp = metrics_len;
+    return (metrics_text);
+}
+
+// EOF
@@ -0,0 +1,66 @@
+// Prometheus-format metrics for WiCap web server
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define METRICS_FIELDLEN    20      // Width of value field (max 64-bit digits)
+
+// Metric definitions: name, type and description
+#define METRIC_DEFS \
+    { "wicap_uptime_seconds",       "gauge",   "Time since startup" },                  \
+    { "wicap_net_rx_frames_total",  "counter", "Network frames received" },             \
+    { "wicap_net_tx_frames_total",  "counter", "Network frames transmitted" },          \
+    { "wicap_net_drop_frames_total","counter", "Network frames received and dropped" }, \
+    { "wicap_net_errors_total",     "counter", "Network driver errors" },               \
+    { "wicap_wifi_link_up",         "gauge",   "WiFi link state, 1 if joined, -1 if failed" }, \
+    { "wicap_wifi_join_retries_total", "counter", "WiFi network join retries" },        \
+    { "wicap_bytes_bin_total",      "counter", "Bytes served as binary data" },         \
+    { "wicap_bytes_base64_total",   "counter", "Bytes served as base64 data" },         \
+    { "wicap_bytes_cmp_total",      "counter", "Bytes served as compressed data" },     \
+    { "wicap_bytes_gzip_total",     "counter", "Bytes served with gzip encoding" },     \
+    { "wicap_bytes_speed_total",    "counter", "Bytes served by speed test file" },     \
+    { "wicap_bytes_bench_total",    "counter", "Bytes served by benchmark endpoints" }, \
+    { "wicap_transfers_active",     "gauge",   "File transfers in progress" },          \
+    { "wicap_captures_total",       "counter", "Captures started" },                    \
+    { "wicap_capture_restarts_total", "counter", "Captures restarted before completion" }
+
+// Index numbers of metrics, must match the definitions
+typedef enum {
+    METRIC_UPTIME, METRIC_RX_FRAMES, METRIC_TX_FRAMES, METRIC_DROP_FRAMES,
+    METRIC_NET_ERRORS, METRIC_LINK_UP, METRIC_JOIN_RETRIES, METRIC_BYTES_BIN,
+    METRIC_BYTES_BASE64, METRIC_BYTES_CMP, METRIC_BYTES_GZIP,
+    METRIC_BYTES_SPEED, METRIC_BYTES_BENCH,
+    METRIC_TRANSFERS, METRIC_CAPTURES, METRIC_RESTARTS, NUM_METRICS
+} METRIC_ID;
+
+// Metric definition
+typedef struct {
+    const char *name, *type, *help;
+} METRIC_DEF;
+
+extern int64_t metric_vals[NUM_METRICS];
+
+#define METRIC_ADD(id, n)   (metric_vals[id] += (n))
+#define METRIC_SET(id, n)   (metric_vals[id] = (n))
+
+void metrics_init(void);
+char *metrics_render(int *lenp);
+
+// EOF
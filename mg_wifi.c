@@ -31,6 +31,8 @@
 #include "picowi/picowi_ioctl.h"
 #include "picowi/picowi_event.h"
 #include "picowi/picowi_auth.h"
+#include "picowi/picowi_prof.h"
+#include "picowi/picowi_trace.h"
 
 //#define DEFAULT_AUTH_TYPE   WHD_SECURITY_WPA2_AES_PSK
 #define DEFAULT_AUTH_TYPE   WHD_SECURITY_WPA2_WPA_MIXED_PSK
@@ -61,6 +63,8 @@ AUTH_TYPES auth_types[] = {
 };
 
 uint32_t poll_ticks;
+uint8_t *rx_buf;
+size_t rx_dlen;
 extern EVENT_INFO event_info;
 extern uint8_t my_mac[6];
 extern bool force_down;
@@ -72,29 +76,40 @@ int wifi_security = DEFAULT_AUTH_TYPE;
 // Poll WiFi interface, optionally return incoming data
 int wifi_poll(void *buf, size_t buflen)
 {
-    EVENT_INFO *eip = &event_info;
     int dlen = 0;
+    PROF_SCOPE(PROF_WIFI_POLL);
     
     if (wifi_get_irq() || ustimeout(&poll_ticks, EVENT_POLL_USEC))
     {
-        event_poll();
+        rx_buf = buf;
+        rx_dlen = 0;
+        event_poll_buf(buf, buflen);
         join_state_poll(wifi_security, wifi_ssid, wifi_passwd);
         ustimeout(&poll_ticks, 0);
-        if (buf && eip->chan == SDPCM_CHAN_DATA && eip->dlen>0 && eip->dlen <= (int)buflen)
-        {
-            memcpy(buf, eip->data, eip->dlen);
-            dlen = eip->dlen;
-            eip->dlen = 0;
-        }
+        dlen = rx_dlen;
+        rx_buf = 0;
     }
     return (dlen);
 }
 
+// Handler for network data, called directly from event dispatcher
+// Data has already been read into the receive buffer, if it would fit
+static int wifi_data_handler(EVENT_INFO *eip)
+{
+    if (rx_buf && eip->data == rx_buf && eip->dlen>0)
+    {
+        rx_dlen = eip->dlen;
+        eip->dlen = 0;
+    }
+    return (1);
+}
+
 // Initialise WiFi interface
 static bool mg_wifi_init(struct mg_tcpip_if *ifp) 
 {
     set_display_mode(DISPLAY_OPTIONS);
-    add_event_handler(join_event_handler);
+    add_join_handler();
+    add_chan_handler(SDPCM_CHAN_DATA, wifi_data_handler);
     if (!wifi_setup())
         printf("Error: SPI communication\n");
     else if (!wifi_init())
@@ -119,7 +134,10 @@ static bool mg_wifi_up(struct mg_tcpip_if *ifp)
 // Transmit WiFi data
 static size_t mg_wifi_tx(const void *buf, size_t buflen, struct mg_tcpip_if *ifp) 
 {
-    size_t n = event_net_tx((void *)buf, buflen);
+    size_t n;
+
+    TRACE_FRAME(true, buf, buflen);
+    n = event_net_tx((void *)buf, buflen);
     return  n ? buflen : 0;
 }
 
@@ -127,11 +145,25 @@ static size_t mg_wifi_tx(const void *buf, size_t buflen, struct mg_tcpip_if *ifp
 static size_t mg_wifi_rx(void *buf, size_t buflen, struct mg_tcpip_if *ifp) 
 {
     int n = wifi_poll(buf, buflen);
+    if (n > 0)
+        TRACE_FRAME(false, buf, n);
     return n;
 }
 
 struct mg_tcpip_driver mg_tcpip_driver_wifi = { mg_wifi_init, mg_wifi_tx, mg_wifi_rx, mg_wifi_up };
 
+// Select WiFi power/performance profile
+bool wifi_set_profile(int n)
+{
+    return (join_set_profile(n));
+}
+
+// Return current WiFi profile number
+int wifi_get_profile(void)
+{
+    return (join_get_profile());
+}
+
 // Return string for an authentication type
 char *auth_type_str(int typ)
 {
@@ -9,6 +9,8 @@
 #define xprint_ip(ip) mg_print_ip4(&mg_pfn_stdout, 0, ip)
 
 int wifi_poll(void *buf, size_t buflen);
+bool wifi_set_profile(int n);
+int wifi_get_profile(void);
 void join_timer_fn(void *arg);
 extern struct mg_tcpip_driver mg_tcpip_driver_wifi;
 char *auth_type_str(int typ);
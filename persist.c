@@ -0,0 +1,99 @@
+// Persistence histogram of repeated captures
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// A 2-D histogram of the analog signal (time bin x amplitude bin) is built
+// up over a number of captures, for eye diagrams & jitter analysis. Each
+// capture is aligned on its trigger point; if it wasn't triggered, this is
+// the first rising edge that crosses the analog level 'plevel'. Each time bin
+// covers 'pdiv' samples, limited so all the time bins fit in the largest
+// capture, and the counts are 16 bits, so stop at the maximum.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "persist.h"
+#include "measure.h"
+
+#define PERSIST_ASHIFT  (ANALOG_BITS - PERSIST_ABITS) // ADC value to bin number
+
+uint16_t persist_counts[PERSIST_TBINS][PERSIST_ABINS];
+int persist_count, persist_div;
+
+// Add capture to histogram, given trigger sample number (-1 if not triggered)
+// Return false if not added: not enabled, all captures done, or no trigger
+bool persist_update(WORD *samps, int nsamp, int trig)
+{
+    int n = get_param_int(ARG_PERS), div = get_param_int(ARG_PDIV), pre, post;
+    WORD *sp;
+
+    if (n <= 0 || persist_count >= MIN(n, 0xffff))
+        return (false);
+    div = MIN(MAX(div, 1), PERSIST_MAXDIV);
+    if (div != persist_div)
+        persist_reset();
+    persist_div = div;
+    // Samples before & after trigger, no more than XSAMP_MAX, so can't overflow
+    pre = PERSIST_PRE * div;
+    post = (PERSIST_TBINS - PERSIST_PRE) * div;
+    if (trig < 0)
+        trig = measure_edge(samps, MAX(pre, 1), nsamp - post, get_param_int(ARG_PLEVEL));
+    if (trig < pre || trig > nsamp - post)
+        return (false);
+    sp = &samps[trig - pre];
+    for (int t = 0; t < PERSIST_TBINS; t++)
+    {
+        for (int i = 0; i < div; i++)
+        {
+            uint16_t *cp = &persist_counts[t][(*sp++ & ANALOG_MASK) >> PERSIST_ASHIFT];
+            if (*cp < 0xffff)
+                (*cp)++;
+        }
+    }
+    persist_count++;
+    set_param_int(ARG_PCOUNT, persist_count);
+    return (true);
+}
+
+// Clear the histogram
+void persist_reset(void)
+{
+    memset(persist_counts, 0, sizeof(persist_counts));
+    persist_count = 0;
+    set_param_int(ARG_PCOUNT, 0);
+}
+
+// Get histogram header & counts, return total size in bytes
+int persist_get(PERSIST_HDR *hdrp, uint16_t **countsp)
+{
+    PERSIST_HDR hdr = {.magic=PERSIST_MAGIC, .version=PERSIST_VERSION, .tbins=PERSIST_TBINS,
+        .abins=PERSIST_ABINS, .pre=PERSIST_PRE, .count=persist_count, .div=persist_div};
+
+    *hdrp = hdr;
+    *countsp = &persist_counts[0][0];
+    return (sizeof(hdr) + sizeof(persist_counts));
+}
+
+// EOF
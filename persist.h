@@ -0,0 +1,42 @@
+// Persistence histogram of repeated captures
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define PERSIST_TBINS   128         // Number of time bins
+#define PERSIST_ABITS   6           // Number of bits in amplitude bin number
+#define PERSIST_ABINS   (1 << PERSIST_ABITS)
+#define PERSIST_PRE     (PERSIST_TBINS / 4) // Time bins before trigger point
+#define PERSIST_MAXDIV  (XSAMP_MAX / PERSIST_TBINS) // Max samples per time bin
+#define PERSIST_MAGIC   "WPER"      // Binary file marker & version
+#define PERSIST_VERSION 1
+
+// Binary file header, 16 bytes, followed by 16-bit counts [TBINS][ABINS]
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version, tbins, abins, pre;
+    uint16_t count, div;            // Number of captures, samples per time bin
+} PERSIST_HDR;
+
+bool persist_update(WORD *samps, int nsamp, int trig);
+void persist_reset(void);
+int persist_get(PERSIST_HDR *hdrp, uint16_t **countsp);
+
+// EOF
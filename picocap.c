@@ -22,20 +22,32 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 
+#if WICAP_HOST
+#include "host/host_cap.h"
+#include "picowi/picowi_defs.h"
+#include "picowi/picowi_trace.h"
+#include "picocap.h"
+#else
 #include <hardware/pwm.h>
 #include <hardware/dma.h>
 #include <hardware/pio.h>
 #include "hardware/clocks.h"
 #include "hardware/flash.h"
 #include "hardware/sync.h"
+#include "hardware/irq.h"
 #include "picowi/picowi_defs.h"
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "picowi/picowi_trace.h"
 #include "picocap.h"
 #include "picocap.pio.h"
+#include "sched.h"
 
 static PIO cap_pio = pio1;
 static uint cap_sm;
+#endif
 
 const char *state_strs[NUM_STATES] = { STATE_STRS };
 
@@ -43,11 +55,28 @@ SERVER_PARAM server_params[] = { SERVER_PARAM_VALS };
 
 WORD samples[XSAMP_MAX+XSAMP_PRE];
 
-uint pout_slice, cap_dma_chan;
-
 // Storage of configuration in Flash memory
 #define CONFIG_FLASH_SIZE   FLASH_SECTOR_SIZE
 uint config_flash_oset;
+const SERVER_ARG_NUM config_args[] = { CONFIG_ARGS };
+#define NUM_CONFIG_ARGS     (sizeof(config_args) / sizeof(config_args[0]))
+
+// Configuration data in flash: marker, count, then parameter values
+typedef struct {
+    uint magic, count;
+    uint vals[NUM_CONFIG_ARGS];
+} CONFIG_DATA;
+
+// Capture hardware (simulated in host build, see host/host_cap.c)
+#if !WICAP_HOST
+uint pout_slice, cap_dma_chan, cap_ctrl_chan, cap_pout_rate;
+int cap_total;
+volatile uint64_t cap_start_usec, cap_end_usec;
+dma_channel_config cap_dma_cfg;
+bool cap_ring;                      // Continuous capture into ring buffer
+void *cap_ring_addr;                // Ring buffer address, for control DMA
+volatile uint cap_laps;             // Number of passes through ring buffer
+uint64_t cap_ring_total;            // Total samples at end of ring capture
 
 // Initialise capture pins
 void cap_init(void)
@@ -100,6 +129,50 @@ void cap_pout_init(int pin, int freq)
     channel_config_set_write_increment(&cfg, true);
     channel_config_set_dreq(&cfg, pwm_get_dreq(pout_slice));
     dma_channel_configure(cap_dma_chan, &cfg, NULL, &cap_pio->rxf[cap_sm], 0, false);
+    cap_dma_cfg = cfg;
+    dma_channel_set_irq1_enabled(cap_dma_chan, true);
+
+    // Control channel, to restart capture DMA at start of ring buffer
+    cap_ctrl_chan = dma_claim_unused_channel(true);
+    cfg = dma_channel_get_default_config(cap_ctrl_chan);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, false);
+    dma_channel_configure(cap_ctrl_chan, &cfg, &dma_channel_hw_addr(cap_dma_chan)->al2_write_addr_trig,
+                          &cap_ring_addr, 1, false);
+    irq_add_shared_handler(DMA_IRQ_1, cap_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
+
+// Capture DMA interrupt handler, record end time & post event when complete
+// If capturing into a ring buffer, count the number of passes
+void cap_dma_handler(void)
+{
+    if (dma_channel_get_irq1_status(cap_dma_chan))
+    {
+        if (cap_ring)
+        {
+            cap_laps++;
+            dma_channel_acknowledge_irq1(cap_dma_chan);
+        }
+        else
+        {
+            cap_end_usec = time_us_64();
+            dma_channel_acknowledge_irq1(cap_dma_chan);
+            sched_post(EV_CAP_DONE);
+        }
+    }
+}
+
+// Abort capture DMA
+// Interrupt is disabled, as an abort can give a spurious completion (RP2040-E13)
+void cap_dma_abort(void)
+{
+    dma_channel_set_irq1_enabled(cap_dma_chan, false);
+    dma_channel_abort(cap_ctrl_chan);
+    dma_channel_abort(cap_dma_chan);
+    dma_channel_acknowledge_irq1(cap_dma_chan);
+    dma_channel_set_irq1_enabled(cap_dma_chan, true);
 }
 
 // Set capture frequency
@@ -112,43 +185,109 @@ void cap_pout_freq(int pin, int freq)
     pwm_set_wrap(pout_slice, wrap - 1);
     pwm_set_chan_level(pout_slice, pwm_gpio_to_channel(pin), wrap / 2);
     pwm_set_phase_correct(pout_slice, 0);
+    cap_pout_rate = PWM_CLOCK / wrap;
 }
 
 // Start a capture
 void cap_start(void *destp, int nsamp)
 {
+    cap_dma_start(destp, nsamp, false);
+}
+
+// Start a continuous capture into a ring buffer. When the buffer is full,
+// the capture DMA is chained to a control DMA, that restarts it
+void cap_ring_start(void *destp, int nsamp)
+{
+    cap_dma_start(destp, nsamp, true);
+}
+
+// Start capture DMA, single or continuous
+void cap_dma_start(void *destp, int nsamp, bool ring)
+{
+    dma_channel_config cfg = cap_dma_cfg;
+
     cap_pout_freq(PIN_SCK, get_param_int(ARG_XRATE));
     pwm_set_counter(pout_slice, 0);
     pwm_set_enabled(pout_slice, true);
-    dma_channel_abort(cap_dma_chan);
+    cap_dma_abort();
+    cap_total = nsamp;
+    cap_end_usec = 0;
+    cap_ring = ring;
+    cap_ring_addr = destp;
+    cap_laps = 0;
+    cap_ring_total = 0;
+    channel_config_set_chain_to(&cfg, ring ? cap_ctrl_chan : cap_dma_chan);
+    dma_channel_set_config(cap_dma_chan, &cfg, false);
     dma_channel_set_write_addr(cap_dma_chan, destp, false);
     dma_channel_set_trans_count(cap_dma_chan, nsamp, true);
+    cap_start_usec = time_us_64();
+    TRACE(TRACE_DMA_START, 0, 0, nsamp, 0);
 }
 
-// Check progress of capture
+// Check progress of capture, the sample count excludes the pre-samples
+// A ring capture continues until stopped, the count is of samples in the ring
 bool cap_capturing(void)
 {
     int rem = dma_channel_hw_addr(cap_dma_chan)->transfer_count;
-    int xsamp = get_param_int(ARG_XSAMP);
-    int nsamp = xsamp - rem;
+    int nsamp = cap_total - rem - XSAMP_PRE;
 
+    if (cap_ring)
+    {
+        nsamp = (int)MIN(cap_ring_count(), (uint64_t)cap_total) - XSAMP_PRE;
+        rem = 1;
+    }
     set_param_int(ARG_NSAMP, nsamp<0 ? 0 : nsamp);
     return (rem > 0);
 }
 
+// Return total number of samples in a ring capture, including a completed
+// pass through the ring that hasn't yet been counted by the interrupt handler.
+// The values are re-read if they changed while being read.
+uint64_t cap_ring_count(void)
+{
+    uint laps, rem;
+    bool pending;
+
+    if (!cap_ring)
+        return (cap_ring_total);
+    do
+    {
+        laps = cap_laps;
+        pending = dma_channel_get_irq1_status(cap_dma_chan);
+        rem = dma_channel_hw_addr(cap_dma_chan)->transfer_count;
+    } while (laps != cap_laps || pending != dma_channel_get_irq1_status(cap_dma_chan));
+    return ((uint64_t)(laps + pending) * cap_total + (rem ? cap_total - rem : 0));
+}
+#endif
+
 // Set the current state
 void cap_set_state(STATE_VALS val) 
 {
     set_param_int(ARG_STATE, val);
+    TRACE(TRACE_STATE, val, 0, 0, 0);
     if (val < NUM_STATES)
         printf("State: %s\r\n", state_strs[val]);
 }
 
-// End a capture
+#if !WICAP_HOST
+// End a capture, set timing values if it was completed
+// A ring capture is paused by stopping the sample clock, so the number
+// of samples can be read before the DMA is aborted
 void cap_end(void)
 {
-    dma_channel_abort(cap_dma_chan);
+    if (cap_ring)
+    {
+        pwm_set_enabled(pout_slice, false);
+        cap_end_usec = time_us_64();
+        cap_ring_total = cap_ring_count();
+        cap_ring = false;
+    }
+    cap_dma_abort();
     pwm_set_enabled(pout_slice, false);
+    if (cap_end_usec)
+        cap_set_timing(cap_start_usec, cap_end_usec, 
+                       cap_ring_total ? cap_ring_total : (uint64_t)cap_total, cap_pout_rate);
+    TRACE(TRACE_DMA_END, 0, 0, get_param_int(ARG_NSAMP), 0);
 }
 
 // Set or clear the capture LED
@@ -156,6 +295,23 @@ void cap_set_led(bool on)
 {
     gpio_put(PIN_LED, !on);
 }
+#endif
+
+// Set timing values of a completed capture, given start & end times (usec),
+// number of samples, and the sample rate that was set. The times are reported
+// as the low 32 bits, so wrap every 71.6 minutes. The rate that was achieved
+// should be the same, if not it is an overrun (samples missed)
+void cap_set_timing(uint64_t start, uint64_t end, uint64_t nsamp, int rate)
+{
+    uint64_t usec = end - start;
+    uint arate = usec ? (uint)(nsamp * 1000000 / usec) : 0;
+
+    set_param_int(ARG_TSTART, (uint)start);
+    set_param_int(ARG_TEND, (uint)end);
+    set_param_int(ARG_ARATE, arate);
+    if ((uint64_t)arate * 100 < (uint64_t)rate * 99)
+        set_param_int(ARG_OVERRUNS, get_param_int(ARG_OVERRUNS) + 1);
+}
 
 // Get integer parameter value, given index number
 int get_param_int(SERVER_ARG_NUM n)
@@ -169,6 +325,7 @@ void set_param_int(SERVER_ARG_NUM n, int val)
         server_params[n].val = val;
 }
 
+#if !WICAP_HOST
 // Return size of flash memory
 uint flash_size(void) 
 {
@@ -181,13 +338,57 @@ uint flash_size(void)
 }
 
 // Erase & write a single flash sector, length must be mutiple of 256
+// If dual-core, the other core is paused, as it can't execute from flash
 void flash_sector_write(uint oset, void *data, int dlen)
 {
-    uint stat = save_and_disable_interrupts();
+    uint stat;
 
+#if DUAL_CORE
+    multicore_lockout_start_blocking();
+#endif
+    stat = save_and_disable_interrupts();
     flash_range_erase(oset, FLASH_SECTOR_SIZE);
     flash_range_program(oset, data, dlen);
     restore_interrupts(stat);
+#if DUAL_CORE
+    multicore_lockout_end_blocking();
+#endif
+}
+
+// Return pointer to flash sector, given offset
+void *flash_sector_ptr(uint oset)
+{
+    return ((void *)(XIP_BASE + oset));
+}
+#endif
+
+// Load configuration parameters from flash, return 0 if none
+bool config_load(void)
+{
+    CONFIG_DATA *cdp = (CONFIG_DATA *)flash_sector_ptr(config_flash_oset);
+    bool ok = cdp->magic == CONFIG_MAGIC && cdp->count == NUM_CONFIG_ARGS;
+
+    for (uint n = 0; ok && n < NUM_CONFIG_ARGS; n++)
+        set_param_int(config_args[n], cdp->vals[n]);
+    return (ok);
+}
+
+// Save configuration parameters in flash, if they have changed
+bool config_save(void)
+{
+    CONFIG_DATA *cdp = (CONFIG_DATA *)flash_sector_ptr(config_flash_oset);
+    static uint8_t buff[FLASH_PAGE_SIZE];
+    CONFIG_DATA *bp = (CONFIG_DATA *)buff;
+
+    memset(buff, 0xff, sizeof(buff));
+    bp->magic = CONFIG_MAGIC;
+    bp->count = NUM_CONFIG_ARGS;
+    for (uint n = 0; n < NUM_CONFIG_ARGS; n++)
+        bp->vals[n] = get_param_int(config_args[n]);
+    if (memcmp(cdp, bp, sizeof(CONFIG_DATA)) == 0)
+        return (false);
+    flash_sector_write(config_flash_oset, buff, sizeof(buff));
+    return (true);
 }
 
 // EOF
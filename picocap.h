@@ -45,6 +45,16 @@
 #define XSAMP_PRE       20          // Number of pre-samples to be discarded
 #define XSAMP_DEFAULT   1000        // Default number of samples
 #define XRATE_DEFAULT   10000       // Default sample rate
+#define FFTN_DEFAULT    1024        // Default number of spectrum points
+#define DBAUD_DEFAULT   9600        // Default decoder UART baud rate
+#define TRIG_XSAMP_MAX  (XSAMP_MAX / 2) // Max samples in triggered capture,
+                                    // rest of buffer allows for trigger delay
+#define TPOST_DEFAULT   (XSAMP_DEFAULT / 2) // Default samples after trigger
+#define FDEC_DEFAULT    4           // Default filter decimation & FIR taps
+#define FTAPS_DEFAULT   32
+#define ANALOG_BITS     10          // Analog input: bits, mask, and zero value
+#define ANALOG_MASK     ((1 << ANALOG_BITS) - 1)
+#define ANALOG_ZERO     (1 << (ANALOG_BITS - 1))
 //#define IP_BASE_DEFAULT IP_VAL(192, 168, 9, 10) // Default IP base addr
 //#define GATEWAY_DEFAULT IP_VAL(192, 168, 9, 1)  // Default gateway addr
 #define IP_BASE_DEFAULT 0           // Default IP base addr
@@ -52,6 +62,15 @@
 
 #define TEMPS_SIZE      2000        // Size of temporary string buffer
 
+#if WICAP_HOST
+#define DUAL_CORE       0           // Host build is single-threaded
+#else
+#define DUAL_CORE       1           // Set non-zero to run network on core 1
+#endif
+
+#define CONFIG_MAGIC    0x43464731  // Marker for configuration in flash
+#define CONFIG_ARGS     ARG_PROFILE // Parameters saved in flash
+
 #define NUM_STATES  3
 typedef enum { STATE_IDLE, STATE_READY, STATE_CAPTURING, STATE_ERROR} STATE_VALS;
 #define STATE_STRS "Idle", "Ready", "Capturing"
@@ -70,8 +89,13 @@ typedef struct {
 
 typedef enum {ARG_STATUS_T = 1, ARG_CMD_T, ARG_VAL_T, ARG_STR_T, ARG_IP_T} PARAM_TYPES;
 typedef enum {
-    ARG_STATE, ARG_NSAMP, ARG_CMD, 
-    ARG_XSAMP, ARG_XRATE,
+    ARG_STATE, ARG_NSAMP, ARG_SPEED, 
+    ARG_TSTART, ARG_TEND, ARG_ARATE, ARG_ORATE, ARG_OVERRUNS, ARG_TLOST, ARG_PCOUNT,
+    ARG_MPASS, ARG_MFAIL, ARG_CMD, 
+    ARG_XSAMP, ARG_XRATE, ARG_PROFILE, ARG_FFTN, ARG_FAVG,
+    ARG_DPROTO, ARG_DBAUD, ARG_DPIN0, ARG_DPIN1, ARG_DPIN2, ARG_DMODE,
+    ARG_TTYPE, ARG_TDATA, ARG_TLEN, ARG_TPOST, ARG_FILTER, ARG_FDEC, ARG_FTAPS,
+    ARG_PERS, ARG_PDIV, ARG_PLEVEL, ARG_MASK,
     ARG_SECURITY, ARG_SSID, ARG_PASSWD,
     ARG_UNIT, ARG_IP_BASE, ARG_GATEWAY, ARG_END 
 } SERVER_ARG_NUM;
@@ -80,11 +104,50 @@ typedef enum {
 /* Current state */                                 \
     { "state",    ARG_STATUS_T, .val=STATE_IDLE},   \
     { "nsamp",    ARG_STATUS_T, .val=0},            \
+    { "speed",    ARG_STATUS_T, .val=0},            \
+/* Last capture: start & end usec (32 bits, wraps), rate, rate after filter */\
+    { "tstart",   ARG_STATUS_T, .val=0},            \
+    { "tend",     ARG_STATUS_T, .val=0},            \
+    { "arate",    ARG_STATUS_T, .val=0},            \
+    { "orate",    ARG_STATUS_T, .val=0},            \
+/* Captures with rate shortfall, triggered captures lost to ring overwrite */\
+    { "overruns", ARG_STATUS_T, .val=0},            \
+    { "tlost",    ARG_STATUS_T, .val=0},            \
+/* Number of captures in persistence histogram */   \
+    { "pcount",   ARG_STATUS_T, .val=0},            \
+/* Number of captures passing & failing mask test */\
+    { "mpass",    ARG_STATUS_T, .val=0},            \
+    { "mfail",    ARG_STATUS_T, .val=0},            \
 /* Commands */                                      \
     { "cmd",      ARG_CMD_T,    .val=0},            \
 /* Current configuration */                         \
     { "xsamp",    ARG_VAL_T,    .val=XSAMP_DEFAULT},\
     { "xrate",    ARG_VAL_T,    .val=XRATE_DEFAULT},\
+    { "profile",  ARG_VAL_T,    .val=0},            \
+    { "fftn",     ARG_VAL_T,    .val=FFTN_DEFAULT},\
+    { "favg",     ARG_VAL_T,    .val=1},            \
+/* Protocol decoder: protocol, baud rate, pins, SPI mode */\
+    { "dproto",   ARG_VAL_T,    .val=0},            \
+    { "dbaud",    ARG_VAL_T,    .val=DBAUD_DEFAULT},\
+    { "dpin0",    ARG_VAL_T,    .val=0},            \
+    { "dpin1",    ARG_VAL_T,    .val=1},            \
+    { "dpin2",    ARG_VAL_T,    .val=0xff},         \
+    { "dmode",    ARG_VAL_T,    .val=0},            \
+/* Trigger on decoded data: type, data, length, samples after trigger */\
+    { "ttype",    ARG_VAL_T,    .val=0},            \
+    { "tdata",    ARG_VAL_T,    .val=0},            \
+    { "tlen",     ARG_VAL_T,    .val=1},            \
+    { "tpost",    ARG_VAL_T,    .val=TPOST_DEFAULT},\
+/* Analog filter: type, decimation factor, FIR taps */\
+    { "filter",   ARG_VAL_T,    .val=0},            \
+    { "fdec",     ARG_VAL_T,    .val=FDEC_DEFAULT}, \
+    { "ftaps",    ARG_VAL_T,    .val=FTAPS_DEFAULT},\
+/* Persistence: number of captures, samples per time bin, analog level */\
+    { "pers",     ARG_VAL_T,    .val=0},            \
+    { "pdiv",     ARG_VAL_T,    .val=1},            \
+    { "plevel",   ARG_VAL_T,    .val=ANALOG_ZERO},  \
+/* Mask test enable */                              \
+    { "mask",     ARG_VAL_T,    .val=0},            \
 /* Network */                                       \
     { "security", ARG_STR_T,    .val=0},            \
     { "ssid",     ARG_STR_T,    .val=0},            \
@@ -101,17 +164,27 @@ typedef enum { CMD_STOP, CMD_SINGLE, CMD_MULTI } CMD_VALS;
 void cap_init(void);
 void cap_pio_init(void);
 void cap_pout_init(int pin, int freq);
+void cap_dma_handler(void);
 void cap_pout_freq(int pin, int freq);
 void cap_start(void *destp, int nsamp);
+void cap_ring_start(void *destp, int nsamp);
+void cap_dma_start(void *destp, int nsamp, bool ring);
 bool cap_capturing(void);
+uint64_t cap_ring_count(void);
 void cap_set_state(STATE_VALS val);
 void cap_end(void);
+void cap_set_timing(uint64_t start, uint64_t end, uint64_t nsamp, int rate);
 void cap_set_led(bool on); 
 bool mstimeout(uint *tickp, uint msec);
+int bin_base64len(int dlen);
+int base64_enc(void *inp, int inlen, void *outp);
 int get_param_int(SERVER_ARG_NUM n);
 void set_param_int(SERVER_ARG_NUM n, int val);
 uint flash_size(void);
 uint flash_sector_size(void);
 void flash_sector_write(uint oset, void *data, int dlen);
+void *flash_sector_ptr(uint oset);
+bool config_load(void);
+bool config_save(void);
 
 // EOF
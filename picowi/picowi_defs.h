@@ -90,5 +90,6 @@ void set_display_mode(int mask);
 void display(int mask, const char* fmt, ...);
 void wifi_set_led(bool on);
 int link_check(void);
+int join_retries(void);
 
 // EOF
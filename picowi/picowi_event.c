@@ -30,15 +30,25 @@
 #include "picowi_ioctl.h"
 #include "picowi_evtnum.h"
 #include "picowi_event.h"
+#include "picowi_prof.h"
+#include "picowi_trace.h"
 
 #define MAX_HANDLERS    20
-int num_handlers;
+#define MAX_EVT_HANDLERS 8
+int num_handlers, num_evt_handlers;
 event_handler_t event_handlers[MAX_HANDLERS];
 WORD event_ports[MAX_HANDLERS];
 EVT_STR *current_evts;
 
+// Direct dispatch: handler for each SDPCM channel, and for each event number
+// (event slot value is handler index + 1, zero if no handler)
+event_handler_t chan_handlers[SDPCM_NUM_CHANS];
+event_handler_t evt_handlers[MAX_EVT_HANDLERS];
+uint8_t evt_slots[EVENT_MAX];
+// Index of event in current event list + 1, zero if not in list
+uint8_t evt_str_idx[EVENT_MAX];
+
 uint8_t event_mask[EVENT_MAX / 8];
-uint8_t rxdata[RXDATA_LEN];
 EVENT_INFO event_info;
 TX_MSG tx_msg = {.sdpcm = {.chan=SDPCM_CHAN_DATA, .hdrlen=sizeof(SDPCM_HDR)+2},
                  .bdc =   {.flags=0x20}};
@@ -51,13 +61,19 @@ extern void rx_frame(void *buff, uint16_t len);
 // Enable events
 int events_enable(const EVT_STR *evtp)
 {
+    int n = 0;
+
     current_evts = (EVT_STR *)evtp;
     memset(event_mask, 0, sizeof(event_mask));
+    memset(evt_str_idx, 0, sizeof(evt_str_idx));
     while (evtp->num >= 0)
     {
         if (evtp->num / 8 < (int)sizeof(event_mask))
             SET_EVENT(event_mask, evtp->num);
+        if (evtp->num < EVENT_MAX && n < 255)
+            evt_str_idx[evtp->num] = n + 1;
         evtp++;
+        n++;
     }
     return(ioctl_set_data("bsscfg:event_msgs", 20, event_mask, sizeof(event_mask)));
 }
@@ -80,11 +96,44 @@ bool add_server_event_handler(event_handler_t fn, WORD port)
     return (ok);
 }
 
-// Run event handlers, until one returns non-zero
+// Add a handler for an SDPCM channel (e.g. network data)
+bool add_chan_handler(int chan, event_handler_t fn)
+{
+    bool ok = chan >= 0 && chan < SDPCM_NUM_CHANS;
+    if (ok)
+        chan_handlers[chan] = fn;
+    return (ok);
+}
+
+// Add a handler for a list of async event numbers
+bool add_evts_handler(const EVT_STR *evtp, event_handler_t fn)
+{
+    bool ok = num_evt_handlers < MAX_EVT_HANDLERS;
+    if (ok)
+    {
+        evt_handlers[num_evt_handlers++] = fn;
+        while (evtp->num >= 0)
+        {
+            if (evtp->num < EVENT_MAX)
+                evt_slots[evtp->num] = num_evt_handlers;
+            evtp++;
+        }
+    }
+    return (ok);
+}
+
+// Run event handlers
+// Use handler for event number or channel if set, otherwise (or if the
+// handler returns zero) run chained handlers until one returns non-zero
 int event_handle(EVENT_INFO *eip)
 {
     int i, ret=0;
     
+    if (eip->chan == SDPCM_CHAN_EVT && eip->event_type < EVENT_MAX &&
+        (i = evt_slots[eip->event_type]) > 0)
+        ret = evt_handlers[i-1](eip);
+    else if (eip->chan < SDPCM_NUM_CHANS && chan_handlers[eip->chan])
+        ret = chan_handlers[eip->chan](eip);
     for (i=0; i<num_handlers && !ret; i++)
     {
         eip->server_port = event_ports[i];
@@ -93,24 +142,32 @@ int event_handle(EVENT_INFO *eip)
     return(ret);
 }
 
-// Poll for async event, put results in info structure, data in rxdata
+// Poll for async event, put results in info structure
 int event_poll(void)
+{
+    return(event_poll_buf(0, 0));
+}
+
+// Poll for async event or network data, put results in info structure
+// Network data is read directly into the buffer if given, and there is room,
+// otherwise info structure points to data in the ioctl response buffer
+int event_poll_buf(void *buf, int buflen)
 {
     EVENT_INFO *eip = &event_info;
     IOCTL_MSG *iomp = &ioctl_rxmsg;
-    ESCAN_RESULT *erp=(ESCAN_RESULT *)rxdata;
-    EVENT_HDR *ehp = &erp->eventh;
+    ESCAN_RESULT *erp;
+    EVENT_HDR *ehp;
+    uint8_t *dp = 0;
     int ret = 0, n;
+    PROF_SCOPE(PROF_EVENT_POLL);
         
-    n = event_read(iomp, rxdata, sizeof(rxdata));
+    n = event_read_direct(iomp, buf, buflen, &dp);
     if (n > 0)
     {
+        erp = (ESCAN_RESULT *)dp;
+        ehp = &erp->eventh;
         eip->chan = iomp->rsp.sdpcm.chan;
-        eip->flags = SWAP16(ehp->flags);
-        eip->event_type = SWAP32(ehp->event_type);
-        eip->status = SWAP32(ehp->status);
-        eip->reason = SWAP32(ehp->reason);
-        eip->data = rxdata;
+        eip->data = dp;
         eip->dlen = n;
         eip->sock = -1;
         display(DISP_EVENT, "Rx_%s ", sdpcm_chan_str(eip->chan));
@@ -119,6 +176,10 @@ int event_poll(void)
         else if (eip->chan==SDPCM_CHAN_EVT &&
             n >= (int)(sizeof(ETHER_HDR)+sizeof(BCMETH_HDR)+sizeof(EVENT_HDR)))
         {
+            eip->flags = SWAP16(ehp->flags);
+            eip->event_type = SWAP32(ehp->event_type);
+            eip->status = SWAP32(ehp->status);
+            eip->reason = SWAP32(ehp->reason);
             display(DISP_EVENT, "%2lu %s, flags %u, status %lu, reason %lu\n",
                 eip->event_type, event_str(eip->event_type),
                 eip->flags, eip->status, eip->reason);
@@ -127,7 +188,7 @@ int event_poll(void)
         else if (eip->chan == SDPCM_CHAN_DATA) 
         {
             display(DISP_EVENT, "len %d\n", n);
-            disp_bytes(DISP_DATA, rxdata, n);
+            disp_bytes(DISP_DATA, dp, n);
             display(DISP_DATA, "\n");
             ret = event_handle(eip);
         }
@@ -135,6 +196,59 @@ int event_poll(void)
     return(ret);
 }
 
+// Get async event or network data, without copying it
+// SDPCM & BDC headers are read into the response buffer, network data
+// directly into the given buffer if it fits, otherwise into the response buffer
+// Return data length, and set pointer to the data
+int event_read_direct(IOCTL_MSG *rsp, void *buf, int buflen, uint8_t **dpp)
+{
+    SDPCM_HDR *sdp=&rsp->rsp.sdpcm;
+    BDC_HDR *bdcp;
+    int rxlen, len, n=0, hdrlen, dlen=0;
+    
+    if ((rxlen = event_resp_len(sizeof(IOCTL_MSG))) <= 0)
+        return(0);
+    len = wifi_data_read_start(SD_FUNC_RAD, 0, rxlen);
+    if (rxlen >= (int)(sizeof(SDPCM_HDR)+sizeof(BDC_HDR)))
+    {
+        n = sizeof(SDPCM_HDR);
+        wifi_spi_read(rsp->data, n * 8);
+        if ((sdp->len ^ sdp->notlen) == 0xffff && sdp->chan <= SDPCM_CHAN_DATA &&
+            sdp->hdrlen >= n && sdp->hdrlen+(int)sizeof(BDC_HDR) <= rxlen)
+        {
+            TRACE(TRACE_SDPCM_RX, sdp->seq, sdp->len, sdp->credit, sdp->chan);
+            if (sdp->chan==SDPCM_CHAN_CTRL || sdp->chan==SDPCM_CHAN_DATA)
+                display(DISP_SDPCM, "Rx_SDPCM len %u chan %u seq %u flow %u credit %u hdrlen %u\n",
+                sdp->len, sdp->chan, sdp->seq, sdp->flow, sdp->credit, sdp->hdrlen);
+            else
+                display(DISP_SDPCM, "Rx_SDPCM len %u chan %u\n", sdp->len, sdp->chan);
+            hdrlen = sdp->hdrlen + sizeof(BDC_HDR);
+            wifi_spi_read(&rsp->data[n], (hdrlen - n) * 8);
+            n = hdrlen;
+            bdcp = (BDC_HDR *)&rsp->data[sdp->hdrlen];
+            hdrlen += bdcp->offset*4;
+            if (hdrlen <= rxlen)
+            {
+                wifi_spi_read(&rsp->data[n], (hdrlen - n) * 8);
+                n = hdrlen;
+                dlen = rxlen - hdrlen;
+                *dpp = &rsp->data[hdrlen];
+                if (buf && sdp->chan==SDPCM_CHAN_DATA && dlen>0 && dlen<=buflen)
+                {
+                    wifi_spi_read(buf, dlen * 8);
+                    n += dlen;
+                    *dpp = buf;
+                }
+            }
+        }
+    }
+    // Remainder of frame, and padding
+    if (len > n)
+        wifi_spi_read(&rsp->data[n], (len - n) * 8);
+    wifi_data_read_end();
+    return(dlen>0 ? dlen : 0);
+}
+
 // Get ioctl response, async event, or network data
 // Optionally copy data after SDPCM & BDC headers into a buffer, return its length
 int event_read(IOCTL_MSG *rsp, void *data, int dlen)
@@ -165,6 +279,24 @@ int event_read(IOCTL_MSG *rsp, void *data, int dlen)
 
 // Get ioctl response, async event, or network data.
 int event_get_resp(void *data, int maxlen)
+{
+    int rxlen = event_resp_len(maxlen);
+
+    // Read event data if present
+    if (data && rxlen>0)
+        wifi_data_read(SD_FUNC_RAD, 0, data, rxlen);
+    // ..or discard data
+    else if (rxlen > 0)
+    {
+        event_rx_discard();
+        rxlen = 0;
+    }
+    return(rxlen);
+}
+
+// Get length of ioctl response, async event, or network data.
+// If zero length, clear interrupt and return 0
+int event_resp_len(int maxlen)
 {
     uint32_t val=0;
     int rxlen=0;
@@ -173,21 +305,26 @@ int event_get_resp(void *data, int maxlen)
     {
         rxlen = (val >> SPI_STATUS_LEN_SHIFT) & SPI_STATUS_LEN_MASK;
         rxlen = MIN(rxlen, maxlen);
-        // Read event data if present
-        if (data && rxlen>0)
-            wifi_data_read(SD_FUNC_RAD, 0, data, rxlen);
-        // ..or clear interrupt, and discard data
-        else
+        // Clear interrupt if no data
+        if (rxlen <= 0)
         {
-            wifi_reg_write(SD_FUNC_BAK, SPI_FRAME_CONTROL, 0x01, 1);
-            val = wifi_reg_read(SD_FUNC_BUS, SPI_INTERRUPT_REG, 2);
-            wifi_reg_write(SD_FUNC_BUS, SPI_INTERRUPT_REG, val, 2);
+            event_rx_discard();
             rxlen = 0;
         }
     }
     return(rxlen);
 }
 
+// Clear receive interrupt, and discard data
+void event_rx_discard(void)
+{
+    uint32_t val;
+
+    wifi_reg_write(SD_FUNC_BAK, SPI_FRAME_CONTROL, 0x01, 1);
+    val = wifi_reg_read(SD_FUNC_BUS, SPI_INTERRUPT_REG, 2);
+    wifi_reg_write(SD_FUNC_BUS, SPI_INTERRUPT_REG, val, 2);
+}
+
 // Return string corresponding to SDPCM channel number
 char *sdpcm_chan_str(int chan)
 {
@@ -198,11 +335,11 @@ char *sdpcm_chan_str(int chan)
 // Return string corresponding to event number, without "WLC_E_" prefix
 char *event_str(int event)
 {
-    EVT_STR *evtp=current_evts;
+    EVT_STR *evtp;
+    int n = event>=0 && event<EVENT_MAX ? evt_str_idx[event] : 0;
 
-    while (evtp && evtp->num>=0 && evtp->num!=event)
-        evtp++;
-    return(evtp && evtp->num>=0 && strlen(evtp->str)>6 ? &evtp->str[6] : "?");
+    evtp = n && current_evts ? &current_evts[n-1] : 0;
+    return(evtp && strlen(evtp->str)>6 ? &evtp->str[6] : "?");
 }
 
 // Transmit network data
@@ -211,6 +348,7 @@ int event_net_tx(void *data, int len)
     TX_MSG *txp = &tx_msg;
     uint8_t *dp = (uint8_t *)txp;
     int txlen = sizeof(SDPCM_HDR)+2+sizeof(BDC_HDR)+len;
+    PROF_SCOPE(PROF_NET_TX);
     
     display(DISP_DATA, "Tx_DATA len %d\n", len);
     disp_bytes(DISP_DATA, data, len);
@@ -218,6 +356,7 @@ int event_net_tx(void *data, int len)
     txp->sdpcm.len = txlen;
     txp->sdpcm.notlen = ~txp->sdpcm.len;
     txp->sdpcm.seq = sd_tx_seq++;
+    TRACE(TRACE_SDPCM_TX, txp->sdpcm.seq, txlen, 0, SDPCM_CHAN_DATA);
     memcpy(txp->data, data, len);
     if (!wifi_reg_val_wait(10, SD_FUNC_BUS, SPI_STATUS_REG, 
             SPI_STATUS_F2_RX_READY, SPI_STATUS_F2_RX_READY, 4))
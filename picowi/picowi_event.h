@@ -127,10 +127,16 @@ typedef int (*event_handler_t)(EVENT_INFO *eip);
 int events_enable(const EVT_STR *evtp);
 bool add_event_handler(event_handler_t);
 bool add_server_event_handler(event_handler_t fn, WORD port);
+bool add_chan_handler(int chan, event_handler_t fn);
+bool add_evts_handler(const EVT_STR *evtp, event_handler_t fn);
 int event_handle(EVENT_INFO *eip);
 int event_poll(void);
+int event_poll_buf(void *buf, int buflen);
 int event_read(IOCTL_MSG *rsp, void *data, int dlen);
+int event_read_direct(IOCTL_MSG *rsp, void *buf, int buflen, uint8_t **dpp);
 int event_get_resp(void *data, int maxlen);
+int event_resp_len(int maxlen);
+void event_rx_discard(void);
 char *sdpcm_chan_str(int chan);
 char *event_str(int event);
 int event_net_tx(void *data, int len);
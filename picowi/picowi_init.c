@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 
@@ -31,6 +32,7 @@
 #include "picowi_ioctl.h"
 #include "picowi_event.h"
 #include "picowi_regs.h"
+#include "picowi_lz.h"
 
 // Build-time options; set non-zero to enable the option
 #define USE_WIFI_REGS       1       // Use WiFi register accesses to set LED
@@ -46,7 +48,7 @@
 // Addresses to load firmware and NVRAM image
 #define FW_BASE_ADDR        0
 #define NVRAM_BASE_ADDR     0x7FCFC
-#define MAX_LOAD_LEN        512
+#define MAX_LOAD_LEN        1024
 
 typedef struct {
     uint16_t flag;
@@ -62,7 +64,12 @@ typedef struct {
 
 uint8_t my_mac[6];
 extern const unsigned int fw_nvram_len, fw_firmware_len, fw_clm_len;
+#if FW_COMPRESSED
+extern const unsigned int fw_firmware_lzlen, fw_clm_lzlen;
+extern const unsigned char fw_nvram_data[], fw_firmware_lzdata[], fw_clm_lzdata[];
+#else
 extern const unsigned char fw_nvram_data[], fw_firmware_data[], fw_clm_data[];
+#endif
 int display_mode;
 void set_my_mac(uint8_t *mac);
 
@@ -76,10 +83,11 @@ uint32_t wifi_chip_id(void)
 // Initialise WiFi chip
 bool wifi_init(void)
 {
-    uint32_t n;
+    uint32_t n, t0, t1, t2, t3, t4;
     char temps[30];
     bool ret;
 
+    t0 = ustime();
     // Check Active Low Power (ALP) clock
     wifi_reg_write(SD_FUNC_BAK, BAK_CHIP_CLOCK_CSR_REG, SD_ALP_REQ, 1);
     if (!wifi_reg_val_wait(10, SD_FUNC_BAK, BAK_CHIP_CLOCK_CSR_REG,
@@ -90,7 +98,13 @@ bool wifi_init(void)
     wifi_bak_reg_write(SRAM_BANKX_IDX_REG, 0x03, 4);
     wifi_bak_reg_write(SRAM_BANKX_PDA_REG, 0x00, 4);
     // Load firmware
+    t1 = ustime();
+#if FW_COMPRESSED
+    n = wifi_data_load_lz(SD_FUNC_BAK, FW_BASE_ADDR, fw_firmware_lzdata, fw_firmware_lzlen);
+#else
     n = wifi_data_load(SD_FUNC_BAK, FW_BASE_ADDR, fw_firmware_data, fw_firmware_len);
+#endif
+    t2 = ustime();
     display(DISP_INFO, "Loaded firmware addr 0x%04x, len %lu bytes\n", FW_BASE_ADDR, n);
     usdelay(5000);
     // Load NVRAM
@@ -107,7 +121,15 @@ bool wifi_init(void)
     if (!wifi_rx_event_wait(100, SPI_STATUS_F2_RX_READY))
         return(false);
     // Load CLM
+    t3 = ustime();
+#if FW_COMPRESSED
+    ret = wifi_clm_load_lz(fw_clm_lzdata, fw_clm_lzlen, fw_clm_len);
+#else
     ret = wifi_clm_load(fw_clm_data, fw_clm_len);
+#endif
+    t4 = ustime();
+    display(DISP_INFO, "Boot timing (usec): reset %lu, firmware %lu, NVRAM & clock %lu, CLM %lu\n",
+            t1 - t0, t2 - t1, t3 - t2, t4 - t3);
 #if DISPLAY_CLMVER
     uint8_t data[300];
     ioctl_get_data("clmver", 30, data, sizeof(data)-1);
@@ -151,24 +173,22 @@ void init_powersave(void)
 }
 
 // Load data block into WiFi chip (CPU firmware or NVRAM file)
+// The backplane window is only changed when a 32K boundary is reached,
+// and blocks are split so they don't cross a boundary
 int wifi_data_load(int func, uint32_t dest, const unsigned char *data, int len)
 {
     int nbytes=0, n;
-    uint32_t oset=0;
+    uint32_t addr;
 
-    wifi_bak_window(dest);
-    dest &= SB_ADDR_MASK;
     while (nbytes < len)
     {
-        if (oset >= SB_32BIT_WIN)
-        {
-            wifi_bak_window(dest+nbytes);
-            oset -= SB_32BIT_WIN;
-        }
+        addr = dest + nbytes;
+        wifi_bak_window(addr);
+        addr &= SB_ADDR_MASK;
         n = MIN(MAX_BLOCKLEN, len-nbytes);
-        wifi_data_write(func, dest+oset, (uint8_t *)&data[nbytes], n);
+        n = MIN(n, SB_32BIT_WIN - (int)addr);
+        wifi_data_write_block(func, addr, &data[nbytes], n);
         nbytes += n;
-        oset += n;
     }
     return(nbytes);
 }
@@ -191,6 +211,54 @@ int wifi_clm_load(const unsigned char *data, int len)
     return(nbytes);
 }
 
+// Load compressed data block into WiFi chip, decompressing as it is sent
+// Window buffer is only allocated during the load
+int wifi_data_load_lz(int func, uint32_t dest, const unsigned char *lzdata, int lzlen)
+{
+    LZ_STATE *lzp = malloc(sizeof(LZ_STATE));
+    uint8_t buff[MAX_BLOCKLEN];
+    int nbytes=0, n;
+    uint32_t addr;
+
+    if (!lzp)
+        return(0);
+    lz_init(lzp, lzdata, lzlen);
+    do
+    {
+        addr = dest + nbytes;
+        wifi_bak_window(addr);
+        addr &= SB_ADDR_MASK;
+        n = lz_read(lzp, buff, MIN(MAX_BLOCKLEN, SB_32BIT_WIN - (int)addr));
+        if (n > 0)
+            wifi_data_write_block(func, addr, buff, n);
+        nbytes += n;
+    } while (n > 0);
+    free(lzp);
+    return(nbytes);
+}
+
+// Load compressed CLM, given compressed & uncompressed lengths
+int wifi_clm_load_lz(const unsigned char *lzdata, int lzlen, int len)
+{
+    LZ_STATE *lzp = malloc(sizeof(LZ_STATE) + MAX_LOAD_LEN);
+    uint8_t *buff = (uint8_t *)(lzp + 1);
+    int nbytes=0, n;
+    CLM_LOAD_REQ clr = {.req="clmload", .hdr={.type=2, .crc=0}};
+
+    if (!lzp)
+        return(0);
+    lz_init(lzp, lzdata, lzlen);
+    while (nbytes < len && (n = lz_read(lzp, buff, MIN(MAX_LOAD_LEN, len-nbytes))) > 0)
+    {
+        clr.hdr.flag = 1<<12 | (nbytes?0:2) | (nbytes+n>=len?4:0);
+        clr.hdr.len = n;
+        ioctl_set_data2((void *)&clr, sizeof(clr), 1000, buff, n);
+        nbytes += n;
+    }
+    free(lzp);
+    return(nbytes);
+}
+
 // Check register value every msec, until correct or timeout
 bool wifi_reg_val_wait(int ms, int func, int addr, uint32_t mask, uint32_t val, int nbytes)
 {
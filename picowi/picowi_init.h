@@ -47,6 +47,8 @@ bool wifi_core_reset(bool ram);
 void init_powersave(void);
 int wifi_data_load(int func, uint32_t dest, const unsigned char *data, int len);
 int wifi_clm_load(const unsigned char *data, int len);
+int wifi_data_load_lz(int func, uint32_t dest, const unsigned char *lzdata, int lzlen);
+int wifi_clm_load_lz(const unsigned char *lzdata, int lzlen, int len);
 bool wifi_reg_val_wait(int ms, int func, int addr, uint32_t mask, uint32_t val, int nbytes);
 bool wifi_reg_read_check(int func, int addr, uint32_t mask, uint32_t val, int nbytes);
 void wifi_bak_window(uint32_t addr);
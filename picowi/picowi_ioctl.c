@@ -30,6 +30,7 @@
 #include "picowi_regs.h"
 #include "picowi_ioctl.h"
 #include "picowi_event.h"
+#include "picowi_trace.h"
 
 IOCTL_MSG ioctl_txmsg, ioctl_rxmsg;
 uint8_t sd_tx_seq = 1; //event_mask[EVENT_MAX / 8];
@@ -116,8 +117,10 @@ int ioctl_cmd(int cmd, char *name, int namelen, int wait_msec, int wr, void *dat
         memcpy(&cmdp->data[namelen], data, dlen);
     display(DISP_SDPCM, "Tx_SDPCM len %u chan %u seq %u\n",
             cmdp->sdpcm.len, cmdp->sdpcm.chan, cmdp->sdpcm.seq);
+    TRACE(TRACE_SDPCM_TX, cmdp->sdpcm.seq, txlen, 0, SDPCM_CHAN_CTRL);
     wifi_data_write(SD_FUNC_RAD, 0, (void *)cmdp, txlen);
-    while (wait_msec>=0 && !(ret=ioctl_resp_match(cmd, data, dlen)))
+    // Response data is only copied for a read, write data may be const
+    while (wait_msec>=0 && !(ret=ioctl_resp_match(cmd, wr ? 0 : data, dlen)))
     {
         wait_msec -= IOCTL_POLL_MSEC;        
         usdelay(IOCTL_POLL_MSEC * 1000);
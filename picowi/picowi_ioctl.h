@@ -21,12 +21,13 @@
 // SOFTWARE.
 
 #define IOCTL_WAIT          30      // Time to wait for ioctl response (msec)
-#define IOCTL_POLL_MSEC     10      // Polling interval for ioctl responses
+#define IOCTL_POLL_MSEC     1       // Polling interval for ioctl responses
 #define IOCTL_MAX_BLKLEN    1600    // Max IOCTL length (really 1536)
 
 #define SDPCM_CHAN_CTRL     0       // SDPCM control channel
 #define SDPCM_CHAN_EVT      1       // SDPCM async event channel
 #define SDPCM_CHAN_DATA     2       // SDPCM data channel
+#define SDPCM_NUM_CHANS     3       // Number of SDPCM channels
 
 // WiFi bands
 #define WIFI_BAND_ANY       0
@@ -42,6 +42,11 @@ const EVT_STR join_evts[]={EVT(WLC_E_JOIN), EVT(WLC_E_ASSOC), EVT(WLC_E_REASSOC)
     EVT(WLC_E_DISASSOC_IND), EVT(WLC_E_CSA_COMPLETE_IND),
     EVT(-1)};
 
+const WIFI_PROFILE wifi_profiles[NUM_WIFI_PROFILES] = { WIFI_PROFILE_VALS };
+const WIFI_PROFILE *wifi_profile = &wifi_profiles[WIFI_PROFILE_DEFAULT];
+bool join_started;
+int join_retry_count;
+
 extern EVENT_INFO event_info;
 
 #define EAPOL_TIMEOUT       2500
@@ -90,15 +95,15 @@ bool join_start(uint32_t auth, char *ssid, char *passwd)
     ret = ioctl_set_uint32("bus:txglom", IOCTL_WAIT, 0x00) > 0;
     if (ioctl_set_uint32("apsta", IOCTL_WAIT, 0x01) < 0)
         display(DISP_IOCTL, "IOCTL: APSTA not supported\n");
-    ret = ret && ioctl_set_uint32("ampdu_ba_wsize", IOCTL_WAIT, 0x08) > 0;
-    ret = ret && ioctl_set_uint32("ampdu_mpdu", IOCTL_WAIT, 0x04) > 0;
-    ioctl_set_uint32("ampdu_rx_factor", IOCTL_WAIT, 0x00);
+    ret = ret && join_set_ampdu(wifi_profile);
     // Set country
     ret = ret && ioctl_set_data2("country", 8, IOCTL_WAIT, (void *)country_data, sizeof(country_data)) > 0;
     ret = ret && ioctl_wr_int32(WLC_SET_GMODE, IOCTL_WAIT, 0x01) > 0;
     ioctl_err_display(ret);
     //usdelay(100000);
     events_enable(join_evts);
+    wifi_set_spi_freq(wifi_profile->spi_freq);
+    join_started = true;
     return(ret);
 }
 
@@ -122,14 +127,7 @@ bool join_restart(uint32_t auth, char *ssid, char *passwd)
     ioctl_wr_data(WLC_UP, 500, 0, 0);
     if (ioctl_get_data("ver", 10, data, sizeof(data)))
         display(DISP_INFO, "WiFi %s", data);
-    ret = ioctl_set_uint32("pm2_sleep_ret", IOCTL_WAIT, 0xc8) > 0 &&
-          ioctl_set_uint32("bcn_li_bcn", IOCTL_WAIT, 0x01) > 0 &&
-          ioctl_set_uint32("bcn_li_dtim", IOCTL_WAIT, 0x01) > 0 &&
-          ioctl_set_uint32("assoc_listen", IOCTL_WAIT, 0x0a) > 0;
-#if POWERSAVE    
-    // Enable power saving
-    init_powersave();
-#endif    
+    ret = join_set_pm(wifi_profile);
     ret = join_security(auth, passwd, strlen(passwd));
     n = strlen(ssid);
     *(uint32_t *)data = n;
@@ -199,6 +197,79 @@ bool join_security(uint32_t auth, char *key, int keylen)
     return (ret);
 }
 
+// Set A-MPDU (data aggregation) parameters, must be done when interface is down
+bool join_set_ampdu(const WIFI_PROFILE *wpp)
+{
+    bool ret;
+
+    ret = ioctl_set_uint32("ampdu_ba_wsize", IOCTL_WAIT, wpp->ampdu_ba_wsize) > 0 &&
+          ioctl_set_uint32("ampdu_mpdu", IOCTL_WAIT, wpp->ampdu_mpdu) > 0;
+    ioctl_set_uint32("ampdu_rx_factor", IOCTL_WAIT, wpp->ampdu_rx_factor);
+    return(ret);
+}
+
+// Set power management and beacon listen parameters
+bool join_set_pm(const WIFI_PROFILE *wpp)
+{
+    bool ret;
+
+    ret = ioctl_set_uint32("pm2_sleep_ret", IOCTL_WAIT, 0xc8) > 0 &&
+          ioctl_set_uint32("bcn_li_bcn", IOCTL_WAIT, 0x01) > 0 &&
+          ioctl_set_uint32("bcn_li_dtim", IOCTL_WAIT, wpp->bcn_li_dtim) > 0 &&
+          ioctl_set_uint32("assoc_listen", IOCTL_WAIT, wpp->assoc_listen) > 0 &&
+          ioctl_wr_int32(WLC_SET_PM, IOCTL_WAIT, wpp->pm) > 0;
+    return(ret);
+}
+
+// Select WiFi power/performance profile
+// If the A-MPDU settings have changed, leave the network so it is re-joined
+// using the new settings, otherwise apply them immediately
+bool join_set_profile(int n)
+{
+    const WIFI_PROFILE *wpp = join_profile_info(n), *oldp = wifi_profile;
+    EVENT_INFO *eip = &event_info;
+    bool ret = wpp != 0;
+
+    if (ret && wpp != oldp)
+    {
+        wifi_profile = wpp;
+        display(DISP_JOIN, "WiFi profile %s\n", wpp->name);
+        if (join_started)
+        {
+            wifi_set_spi_freq(wpp->spi_freq);
+            if (wpp->ampdu_ba_wsize != oldp->ampdu_ba_wsize ||
+                wpp->ampdu_mpdu != oldp->ampdu_mpdu ||
+                wpp->ampdu_rx_factor != oldp->ampdu_rx_factor)
+            {
+                join_stop();
+                ret = join_set_ampdu(wpp);
+                eip->join = JOIN_IDLE;
+            }
+            else
+                ret = join_set_pm(wpp);
+        }
+    }
+    return(ret);
+}
+
+// Return current WiFi profile number
+int join_get_profile(void)
+{
+    return(wifi_profile - wifi_profiles);
+}
+
+// Return WiFi profile settings, null if invalid profile number
+const WIFI_PROFILE *join_profile_info(int n)
+{
+    return(n>=0 && n<NUM_WIFI_PROFILES ? &wifi_profiles[n] : 0);
+}
+
+// Add handler for join events
+bool add_join_handler(void)
+{
+    return(add_evts_handler(join_evts, join_event_handler));
+}
+
 // Handler for join events (link & auth changes)
 int join_event_handler(EVENT_INFO *eip)
 {
@@ -279,10 +350,19 @@ void join_state_poll(uint32_t auth, char *ssid, char *passwd)
     else  // JOIN_FAIL
     {
         if (ustimeout(&join_ticks, JOIN_RETRY_USEC))
+        {
+            join_retry_count++;
             eip->join = JOIN_IDLE;
+        }
     }
 }
 
+// Return number of join retries
+int join_retries(void)
+{
+    return (join_retry_count);
+}
+
 // Return 1 if joined to network, -1 if error joining
 int link_check(void)
 {
@@ -17,8 +17,36 @@
  */
 
 // Enable power-saving (increases network response time)
+// Selects the default WiFi profile, can be changed at run-time
 #define POWERSAVE           0
 
+// WiFi power / performance profiles
+#define WIFI_PROFILE_DEFAULT    0
+#define WIFI_PROFILE_FAST       1
+#define WIFI_PROFILE_LOWPOWER   2
+#define NUM_WIFI_PROFILES       3
+
+// Power management mode (PM0 - PM2), A-MPDU settings,
+// beacon listen interval (DTIM periods), association listen interval
+// (beacon periods), and SPI clock frequency
+typedef struct {
+    char *name;
+    int pm;
+    int ampdu_ba_wsize, ampdu_mpdu, ampdu_rx_factor;
+    int bcn_li_dtim, assoc_listen;
+    uint32_t spi_freq;
+} WIFI_PROFILE;
+
+// Default PM mode: PM2 (fast power-saving) if enabled, otherwise PM0 (off)
+// Every profile sets the mode, so switching profiles can always undo it
+#define DEFAULT_PM              (POWERSAVE ? 2 : 0)
+
+#define WIFI_PROFILE_VALS                                                       \
+/*    Name        PM          wsize mpdu rx_fact dtim listen spi_freq */         \
+    { "default",  DEFAULT_PM, 8,    4,   0,      1,   10,    PIO_SPI_FREQ },    \
+    { "fast",     0,          16,   8,   3,      1,   10,    PIO_SPI_FREQ },    \
+    { "lowpower", 2,          8,    4,   0,      3,   10,    PIO_SPI_FREQ/2 }
+
 // Flags for EVENT_INFO link state
 #define LINK_UP_OK          0x01
 #define LINK_AUTH_OK        0x02
@@ -37,9 +65,16 @@ bool join_start(uint32_t auth, char *ssid, char *passwd);
 bool join_stop(void);
 bool join_restart(uint32_t auth, char *ssid, char *passwd);
 bool join_security(uint32_t auth, char *key, int keylen);
+bool add_join_handler(void);
+bool join_set_ampdu(const WIFI_PROFILE *wpp);
+bool join_set_pm(const WIFI_PROFILE *wpp);
+bool join_set_profile(int n);
+int join_get_profile(void);
+const WIFI_PROFILE *join_profile_info(int n);
 int join_event_handler(EVENT_INFO *eip);
 void join_state_poll(uint32_t auth, char *ssid, char *passwd);
 int link_check(void);
+int join_retries(void);
 int ip_event_handler(EVENT_INFO *eip);
 
 // EOF
\ No newline at end of file
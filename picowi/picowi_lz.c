@@ -0,0 +1,84 @@
+// PicoWi LZSS decompression, for compressed WiFi firmware
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdint.h>
+
+#include "picowi_lz.h"
+
+// Initialise decompression of a data block
+void lz_init(LZ_STATE *lzp, const uint8_t *data, int len)
+{
+    lzp->inp = data;
+    lzp->end = data + len;
+    lzp->flags = lzp->nflags = 0;
+    lzp->mlen = lzp->mdist = 0;
+    lzp->wpos = 0;
+}
+
+// Decompress up to maxlen bytes into buffer, return byte count (0 if end)
+int lz_read(LZ_STATE *lzp, uint8_t *buff, int maxlen)
+{
+    int n = 0;
+    uint8_t b;
+
+    while (n < maxlen)
+    {
+        if (lzp->mlen > 0)
+        {
+            b = lzp->window[(lzp->wpos - lzp->mdist) & LZ_WINDOW_MASK];
+            lzp->mlen--;
+        }
+        else
+        {
+            if (lzp->nflags == 0)
+            {
+                if (lzp->inp >= lzp->end)
+                    break;
+                lzp->flags = *lzp->inp++;
+                lzp->nflags = 8;
+            }
+            if (lzp->inp >= lzp->end)
+                break;
+            lzp->nflags--;
+            if (lzp->flags & 1)
+            {
+                lzp->flags >>= 1;
+                b = *lzp->inp++;
+            }
+            else
+            {
+                lzp->flags >>= 1;
+                if (lzp->inp + 1 >= lzp->end)
+                    break;
+                lzp->mdist = (lzp->inp[0] | (lzp->inp[1] & 0xf0) << 4) + 1;
+                lzp->mlen = (lzp->inp[1] & 0x0f) + LZ_MINMATCH;
+                lzp->inp += 2;
+                continue;
+            }
+        }
+        lzp->window[lzp->wpos++ & LZ_WINDOW_MASK] = b;
+        buff[n++] = b;
+    }
+    return (n);
+}
+
+// EOF
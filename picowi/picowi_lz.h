@@ -0,0 +1,45 @@
+// PicoWi LZSS decompression definitions, for compressed WiFi firmware
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compressed data is a sequence of flag bytes, each followed by 8 items.
+// Flag bit (LS bit first) is 1 for a literal byte, 0 for a 2-byte match:
+//   byte 0: distance-1 (LS 8 bits)
+//   byte 1: distance-1 (MS 4 bits) << 4 | length-LZ_MINMATCH
+#define LZ_WINDOW_BITS  12
+#define LZ_WINDOW       (1 << LZ_WINDOW_BITS)
+#define LZ_WINDOW_MASK  (LZ_WINDOW - 1)
+#define LZ_MINMATCH     3
+#define LZ_MAXMATCH     (LZ_MINMATCH + 15)
+
+// Decompression state
+typedef struct {
+    const uint8_t *inp, *end;   // Compressed input
+    int flags, nflags;          // Current flag byte, and number of bits left
+    int mlen, mdist;            // Current match length & distance
+    int wpos;                   // Window position
+    uint8_t window[LZ_WINDOW];  // Window of most recent output
+} LZ_STATE;
+
+void lz_init(LZ_STATE *lzp, const uint8_t *data, int len);
+int lz_read(LZ_STATE *lzp, uint8_t *buff, int maxlen);
+
+// EOF
@@ -20,11 +20,18 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#if WIFI_SIM
+// Host simulation of WiFi chip (see host/wifi_sim.c) replaces the SPI hardware
+#define USE_GPIO_REGS   0
+#define USE_PIO         0
+#define USE_PIO_DMA     0
+#else
 #define USE_GPIO_REGS   1           // Set non-zero for direct register access
                                     // (boosts SPI from 2 to 5.4 MHz read, 7.8 MHz write)
-#define SD_CLK_DELAY    0           // Clock on/off delay time in usec
 #define USE_PIO         1           // Set non-zero to use Pico PIO for SPI
 #define USE_PIO_DMA     1           // Set non-zero to use PIO DMA
+#endif
+#define SD_CLK_DELAY    0           // Clock on/off delay time in usec
 #define PIO_SPI_FREQ    40000000    // SPI frequency if using PIO
 #define SD_IRQ_ASSERT   1           // State of IRQ pin when asserted
 
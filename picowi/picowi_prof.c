@@ -0,0 +1,164 @@
+// PicoWi hot-path profiler, cycle counts of selected functions
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// On the Pico, the SysTick timer is used as a 24-bit cycle counter, so a
+// single call can't be longer than 2^24 cycles (134 msec at 125 MHz); longer
+// calls use the 32-bit microsecond timer, and are reported in microseconds.
+// Each core has its own SysTick, which must be enabled by code running on
+// that core, and its own table, so the cores don't update the same entries.
+// On a Linux host, the counts are in nanoseconds, from clock_gettime
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#if WICAP_HOST
+#include <time.h>
+#define PROF_CLOCK      1000000000
+#define PROF_MASK       0xffffffff
+#define PROF_UNIT       "ns"
+#define PROF_CORE       0
+#else
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#define PROF_CLOCK      clock_get_hz(clk_sys)
+#define PROF_MASK       0xffffff
+#define PROF_UNIT       "cycles"
+#define PROF_CORE       get_core_num()
+#endif
+#define PROF_UNIT_US    "usec"
+#define PROF_NCORES     2
+
+#include "picowi_defs.h"
+#include "picowi_prof.h"
+
+const char *prof_names[PROF_NUM] = { PROF_TABLE(PROF_NAME_ENTRY) };
+PROF_ENTRY prof_entries[PROF_NCORES][PROF_NUM];
+
+// Initialise profiler timer for the current core, and clear the tables
+void prof_init(void)
+{
+    prof_systick_init();
+    prof_reset();
+}
+
+// Initialise profiler timer for the current core, without clearing tables
+// Must be called on each core that has probes
+void prof_systick_init(void)
+{
+#if !WICAP_HOST
+    systick_hw->rvr = PROF_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 5;    // Enable, using processor clock
+#endif
+}
+
+// Return current cycle count (or nanoseconds on host)
+uint32_t prof_cycles(void)
+{
+#if WICAP_HOST
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec));
+#else
+    return (PROF_MASK - systick_hw->cvr);
+#endif
+}
+
+// Return current time in microseconds
+uint32_t prof_usec(void)
+{
+#if WICAP_HOST
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000));
+#else
+    return (time_us_32());
+#endif
+}
+
+// Add time to table entry
+static void prof_add(PROF_ENTRY *pep, uint32_t dt)
+{
+    pep->count++;
+    pep->total += dt;
+    if (dt > pep->max)
+        pep->max = dt;
+}
+
+// End of probe scope, update the table
+void prof_end(PROF_PROBE *pp)
+{
+    prof_add(&prof_entries[PROF_CORE][pp->id], (prof_cycles() - pp->start) & PROF_MASK);
+}
+
+// End of microsecond probe scope, update the table
+void prof_end_us(PROF_PROBE *pp)
+{
+    PROF_ENTRY *pep = &prof_entries[PROF_CORE][pp->id];
+
+    pep->usec = true;
+    prof_add(pep, prof_usec() - pp->start);
+}
+
+// Clear the table
+void prof_reset(void)
+{
+    memset(prof_entries, 0, sizeof(prof_entries));
+}
+
+// Return profile tables in JSON format, one array of probes for each core,
+// with the unit of each probe. Probes that haven't been called are omitted
+int prof_json(char *buff, int maxlen)
+{
+    int n = snprintf(buff, maxlen, "{\"clock\":%u,\"unit\":\"%s\",\"cores\":[", 
+        (unsigned)PROF_CLOCK, PROF_UNIT);
+
+    for (int core = 0; core < PROF_NCORES && n < maxlen; core++)
+    {
+        bool first = true;
+        n += snprintf(&buff[n], maxlen - n, "%s{\"core\":%d,\"probes\":[", core ? "," : "", core);
+        for (int i = 0; i < PROF_NUM && n < maxlen; i++)
+        {
+            PROF_ENTRY *pep = &prof_entries[core][i];
+            if (pep->count)
+            {
+                n += snprintf(&buff[n], maxlen - n, 
+                    "%s{\"name\":\"%s\",\"unit\":\"%s\",\"count\":%u,\"total\":%llu,\"max\":%u}", 
+                    first ? "" : ",", prof_names[i], pep->usec ? PROF_UNIT_US : PROF_UNIT,
+                    (unsigned)pep->count, (unsigned long long)pep->total, (unsigned)pep->max);
+                first = false;
+            }
+        }
+        if (n < maxlen)
+            n += snprintf(&buff[n], maxlen - n, "]}");
+    }
+    if (n < maxlen)
+        n += snprintf(&buff[n], maxlen - n, "]}\n");
+    return (MIN(n, maxlen));
+}
+
+// EOF
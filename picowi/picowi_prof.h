@@ -0,0 +1,90 @@
+// PicoWi hot-path profiler, cycle counts of selected functions
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Set PROF_ENABLE non-zero (compiler definition) to enable the probes,
+// otherwise they compile to nothing. PROF_SCOPE is for short functions, timed
+// in CPU cycles; PROF_SCOPE_US is for longer ones, e.g. processing a whole
+// capture, timed in microseconds
+
+// Profiled functions, ID and name; the table creates the ID enum and the
+// name strings, so they can't get out of step
+#define PROF_TABLE(X)                       \
+    X(PROF_MG_POLL,     "mg_mgr_poll")      \
+    X(PROF_WIFI_POLL,   "wifi_poll")        \
+    X(PROF_EVENT_POLL,  "event_poll")       \
+    X(PROF_NET_TX,      "event_net_tx")     \
+    X(PROF_FS_BIN,      "fs_read_bin")      \
+    X(PROF_FS_BASE64,   "fs_read_base64")   \
+    X(PROF_BASE64_ENC,  "base64_enc")       \
+    X(PROF_SPI_READ,    "wifi_spi_read")    \
+    X(PROF_SPI_WRITE,   "wifi_spi_write")   \
+    X(PROF_FFT,         "spectrum_update")  \
+    X(PROF_MEASURE,     "measure")          \
+    X(PROF_DECODE,      "decode")           \
+    X(PROF_FILTER,      "filter")           \
+    X(PROF_PERSIST,     "persist")          \
+    X(PROF_MASK_TEST,   "mask_update")      \
+    X(PROF_FS_CMP,      "fs_read_cmp")      \
+    X(PROF_GZ_SEND,     "gz_stream_send")
+
+#define PROF_ID_ENTRY(id, name)     id,
+#define PROF_NAME_ENTRY(id, name)   name,
+
+typedef enum {
+    PROF_TABLE(PROF_ID_ENTRY)
+    PROF_NUM
+} PROF_ID;
+
+// Accumulated values for one function
+typedef struct {
+    uint32_t count, max;
+    uint64_t total;
+    bool usec;                      // Times in microseconds, not cycles
+} PROF_ENTRY;
+
+// Probe, records the start time
+typedef struct {
+    int id;
+    uint32_t start;
+} PROF_PROBE;
+
+#if PROF_ENABLE
+// Start probe, count is updated when the enclosing scope exits
+#define PROF_SCOPE(id)  PROF_PROBE prof_probe __attribute__((cleanup(prof_end))) = \
+                            {id, prof_cycles()}
+#define PROF_SCOPE_US(id) PROF_PROBE prof_probe __attribute__((cleanup(prof_end_us))) = \
+                            {id, prof_usec()}
+#else
+#define PROF_SCOPE(id)
+#define PROF_SCOPE_US(id)
+#endif
+
+void prof_init(void);
+void prof_systick_init(void);
+uint32_t prof_cycles(void);
+uint32_t prof_usec(void);
+void prof_end(PROF_PROBE *pp);
+void prof_end_us(PROF_PROBE *pp);
+void prof_reset(void);
+int prof_json(char *buff, int maxlen);
+
+// EOF
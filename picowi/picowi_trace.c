@@ -0,0 +1,130 @@
+// PicoWi binary event trace, for network and capture timing
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Records are added to a ring buffer in RAM, overwriting the oldest, so
+// tracing has little effect on timing. Both cores add records (capture DMA
+// on core 0, network frames & state changes on core 1), so a hardware
+// spinlock protects the reservation & writing of a record. The ring is read
+// without the lock, so if it overflows while being read, the oldest records
+// in the result may be replaced by new ones.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "picowi_defs.h"
+#include "picowi_pico.h"
+#include "picowi_trace.h"
+
+#if !WICAP_HOST
+#include "hardware/sync.h"
+#define TRACE_LOCK(save)    save = spin_lock_blocking(trace_lock)
+#define TRACE_UNLOCK(save)  spin_unlock(trace_lock, save)
+spin_lock_t *trace_lock;
+#else
+#define TRACE_LOCK(save)    (void)save
+#define TRACE_UNLOCK(save)
+#endif
+
+#define ETH_HDR_LEN         14
+#define ETH_TYPE_IP         0x0800
+#define IP_PROTO_TCP        6
+
+TRACE_REC trace_recs[TRACE_NRECS];
+volatile uint32_t trace_total;
+
+// Initialise trace ring, must be called before the second core is started
+void trace_init(void)
+{
+#if !WICAP_HOST
+    trace_lock = spin_lock_instance(spin_lock_claim_unused(true));
+#endif
+    trace_reset();
+}
+
+// Add a record to the trace ring
+void trace_add(TRACE_TYPE type, uint8_t a, uint16_t b, uint32_t c, uint32_t d)
+{
+    TRACE_REC *trp;
+    uint32_t save = 0;
+
+    TRACE_LOCK(save);
+    trp = &trace_recs[trace_total++ & (TRACE_NRECS - 1)];
+    trp->usec = ustime();
+    trp->type = type;
+    trp->a = a;
+    trp->b = b;
+    trp->c = c;
+    trp->d = d;
+    TRACE_UNLOCK(save);
+}
+
+// Add records for an Ethernet frame, and TCP segment (if any)
+void trace_frame(bool tx, const uint8_t *data, int len)
+{
+    const uint8_t *ip = &data[ETH_HDR_LEN], *tcp;
+    int etype = len >= ETH_HDR_LEN ? (data[12] << 8) | data[13] : 0;
+    int iphdr, tcphdr, dlen;
+
+    trace_add(tx ? TRACE_TX_FRAME : TRACE_RX_FRAME, 0, len, etype, 0);
+    if (etype != ETH_TYPE_IP || len < ETH_HDR_LEN + 40 || ip[9] != IP_PROTO_TCP)
+        return;
+    iphdr = (ip[0] & 0xf) * 4;
+    tcp = &ip[iphdr];
+    tcphdr = (tcp[12] >> 4) * 4;
+    dlen = ((ip[2] << 8) | ip[3]) - iphdr - tcphdr;
+    trace_add(tx ? TRACE_TCP_TX : TRACE_TCP_RX, tcp[13], dlen > 0 ? dlen : 0,
+        (uint32_t)tcp[4]<<24 | tcp[5]<<16 | tcp[6]<<8 | tcp[7],
+        (uint32_t)tcp[8]<<24 | tcp[9]<<16 | tcp[10]<<8 | tcp[11]);
+}
+
+// Clear the trace ring
+void trace_reset(void)
+{
+    uint32_t save = 0;
+
+    TRACE_LOCK(save);
+    trace_total = 0;
+    TRACE_UNLOCK(save);
+}
+
+// Get trace file header, and the 2 blocks of records in the ring (oldest first)
+// Return total byte count of header and records
+int trace_get(TRACE_HDR *hdr, TRACE_REC **recs1, int *n1, TRACE_REC **recs2, int *n2)
+{
+    uint32_t total = trace_total;
+    int nrecs = MIN(total, TRACE_NRECS);
+    int start = (total - nrecs) & (TRACE_NRECS - 1);
+
+    memcpy(hdr->magic, TRACE_MAGIC, sizeof(hdr->magic));
+    hdr->version = TRACE_VERSION;
+    hdr->recsize = sizeof(TRACE_REC);
+    hdr->nrecs = nrecs;
+    hdr->total = total;
+    *recs1 = &trace_recs[start];
+    *n1 = MIN(nrecs, TRACE_NRECS - start);
+    *recs2 = trace_recs;
+    *n2 = nrecs - *n1;
+    return (sizeof(TRACE_HDR) + nrecs * sizeof(TRACE_REC));
+}
+
+// EOF
@@ -0,0 +1,78 @@
+// PicoWi binary event trace, for network and capture timing
+//
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Set TRACE_ENABLE non-zero (compiler definition) to enable tracing,
+// otherwise the trace calls compile to nothing
+
+#define TRACE_NRECS     512         // Number of records in ring (power of 2)
+#define TRACE_MAGIC     "WTRC"      // File header marker
+#define TRACE_VERSION   1
+
+// Trace record types, and values of the record fields
+typedef enum {
+    TRACE_NONE,
+    TRACE_RX_FRAME,     // Ethernet frame received: b=length, c=ethertype
+    TRACE_TX_FRAME,     // Ethernet frame transmitted: b=length, c=ethertype
+    TRACE_SDPCM_RX,     // SDPCM header received: a=seq, b=length, c=credit, d=channel
+    TRACE_SDPCM_TX,     // SDPCM header transmitted: a=seq, b=length, d=channel
+    TRACE_TCP_RX,       // TCP segment received: a=flags, b=data length, c=seq, d=ack
+    TRACE_TCP_TX,       // TCP segment transmitted: a=flags, b=data length, c=seq, d=ack
+    TRACE_DMA_START,    // Capture DMA started: c=number of samples
+    TRACE_DMA_END,      // Capture DMA ended: c=number of samples
+    TRACE_STATE,        // Capture state change: a=new state
+    TRACE_NUM_TYPES
+} TRACE_TYPE;
+
+#pragma pack(1)
+// Trace record, little-endian
+typedef struct {
+    uint32_t usec;      // Timestamp
+    uint8_t type, a;    // Record type, and values
+    uint16_t b;
+    uint32_t c, d;
+} TRACE_REC;
+
+// Header of trace file, followed by records, oldest first
+typedef struct {
+    char magic[4];      // TRACE_MAGIC
+    uint16_t version;   // TRACE_VERSION
+    uint16_t recsize;   // Size of one record
+    uint32_t nrecs;     // Number of records in file
+    uint32_t total;     // Total records since reset (more if ring overflowed)
+} TRACE_HDR;
+#pragma pack()
+
+#if TRACE_ENABLE
+#define TRACE(type, a, b, c, d)     trace_add(type, a, b, c, d)
+#define TRACE_FRAME(tx, data, len)  trace_frame(tx, data, len)
+#else
+#define TRACE(type, a, b, c, d)     ((void)0)
+#define TRACE_FRAME(tx, data, len)  ((void)0)
+#endif
+
+void trace_init(void);
+void trace_add(TRACE_TYPE type, uint8_t a, uint16_t b, uint32_t c, uint32_t d);
+void trace_frame(bool tx, const uint8_t *data, int len);
+void trace_reset(void);
+int trace_get(TRACE_HDR *hdr, TRACE_REC **recs1, int *n1, TRACE_REC **recs2, int *n2);
+
+// EOF
@@ -23,15 +23,18 @@
 #include <stdio.h>
 #include <string.h>
 
-#include <hardware/pio.h>
-#include <hardware/clocks.h>
-#include <hardware/structs/pio.h>
-#include <hardware/dma.h>
 #include "picowi_defs.h"
 #include "picowi_pico.h"
 #include "picowi_init.h"
 #include "picowi_regs.h"
 #include "picowi_wifi.h"
+#include "picowi_prof.h"
+
+#if USE_PIO
+#include <hardware/pio.h>
+#include <hardware/clocks.h>
+#include <hardware/structs/pio.h>
+#include <hardware/dma.h>
 #include "picowi_pio.pio.h"
 
 PIO wifi_pio = pio0;
@@ -39,6 +42,9 @@ uint wifi_sm;
 io_rw_8 *wifi_rxfifo, *wifi_txfifo;
 uint wifi_rx_dma_chan, wifi_tx_dma_chan;
 uint wifi_tx_dma_dreq, wifi_rx_dma_dreq;
+#endif
+uint32_t wifi_spi_freq = PIO_SPI_FREQ;
+bool wifi_pio_ok;
 
 extern int display_mode;
 
@@ -106,6 +112,7 @@ int wifi_start(void)
     return (ok);
 }
 
+#if USE_PIO
 // Initialse PIO
 void wifi_pio_init(void) 
 {
@@ -125,20 +132,32 @@ void wifi_pio_init(void)
     // Get 8 bits from FIFOs, disable auto-pull & auto-push
     sm_config_set_out_shift(&c, false, false, 8);
     sm_config_set_in_shift(&c, false, false, 8);
-    // Set data rate
-#if PIO_SPI_FREQ >= 40000000
-    sm_config_set_clkdiv_int_frac(&c, 1, 0);
-#else   
-    float div = (float)clock_get_hz(clk_sys) / (PIO_SPI_FREQ * 3.1);
-    sm_config_set_clkdiv(&c, div);
-#endif    
     pio_sm_init(wifi_pio, wifi_sm, offset, &c);
     pio_sm_clear_fifos(wifi_pio, wifi_sm);
+    wifi_pio_ok = true;
+    // Set data rate
+    wifi_set_spi_freq(wifi_spi_freq);
     pio_sm_set_enabled(wifi_pio, wifi_sm, true);
 #if USE_PIO_DMA
     wifi_pio_dma_init();
 #endif
 }
+#endif
+
+// Set PIO SPI clock frequency, must not be called during a transfer
+// If PIO not yet initialised, frequency is used when it is
+void wifi_set_spi_freq(uint32_t freq)
+{
+    wifi_spi_freq = freq;
+#if USE_PIO
+    if (!wifi_pio_ok)
+        return;
+    if (freq >= 40000000)
+        pio_sm_set_clkdiv_int_frac(wifi_pio, wifi_sm, 1, 0);
+    else
+        pio_sm_set_clkdiv(wifi_pio, wifi_sm, (float)clock_get_hz(clk_sys) / (freq * 3.1));
+#endif
+}
 
 // Read a register
 uint32_t wifi_reg_read(int func, uint32_t addr, int nbytes)
@@ -175,6 +194,16 @@ int wifi_reg_write(int func, uint32_t addr, uint32_t val, int nbytes)
 
 // Read data block using SPI
 int wifi_data_read(int func, int addr, uint8_t *dp, int nbytes)
+{
+    nbytes = wifi_data_read_start(func, addr, nbytes);
+    wifi_spi_read(dp, nbytes * 8);
+    wifi_data_read_end();
+    return (nbytes);
+}
+
+// Start reading a data block using SPI, return byte count to be read
+// Data is fetched by one or more calls to wifi_spi_read, then wifi_data_read_end
+int wifi_data_read_start(int func, int addr, int nbytes)
 {
     SPI_MSG msg = {
         .hdr = { 
@@ -203,12 +232,15 @@ int wifi_data_read(int func, int addr, uint8_t *dp, int nbytes)
 #endif    
     if (func == SD_FUNC_BAK)
         wifi_spi_read(dat.bytes, 32);
-    dat.uint32 = 0;
-    wifi_spi_read(dp, nbytes * 8);
-    io_out(SD_CS_PIN, 1);
     return (nbytes);
 }
 
+// End reading a data block
+void wifi_data_read_end(void)
+{
+    io_out(SD_CS_PIN, 1);
+}
+
 // Write a data block using SPI
 int wifi_data_write(int func, int addr, uint8_t *dp, int nbytes)
 {
@@ -245,14 +277,56 @@ int wifi_data_write(int func, int addr, uint8_t *dp, int nbytes)
     return (nbytes);
 }
 
+// Write a data block using SPI, for bulk loading
+// Header is queued in the PIO FIFO, then data is sent by DMA direct from source,
+// so there is only one PIO restart per block, and no copy from XIP flash
+int wifi_data_write_block(int func, int addr, const uint8_t *dp, int nbytes)
+{
+#if USE_PIO && USE_PIO_DMA
+    SPI_MSG msg = {
+        .hdr = {
+        .wr = SD_WR,
+        .incr = 1,
+        .func = func&SD_FUNC_MASK,
+        .addr = addr,
+        .len = nbytes
+    }
+    };
+    int n = 0;
+
+    if (func & SD_FUNC_SWAP || nbytes <= 4)
+        return (wifi_data_write(func, addr, (uint8_t *)dp, nbytes));
+    io_out(SD_CS_PIN, 0);
+    pio_sm_clear_fifos(wifi_pio, wifi_sm);
+    pio_sm_exec(wifi_pio, wifi_sm, pio_encode_jmp(picowi_pio_offset_writer));
+    pio_sm_set_consecutive_pindirs(wifi_pio, wifi_sm, SD_CMD_PIN, 1, true);
+    while (n < 4)
+    {
+        if (!pio_sm_is_tx_fifo_full(wifi_pio, wifi_sm))
+            *wifi_txfifo = msg.bytes[n++];
+    }
+    dma_channel_transfer_from_buffer_now(wifi_tx_dma_chan, dp, nbytes);
+    dma_channel_wait_for_finish_blocking(wifi_tx_dma_chan);
+    while (!pio_sm_is_tx_fifo_empty(wifi_pio, wifi_sm)) ;
+    while (wifi_pio->sm[wifi_sm].addr != picowi_pio_offset_writer) ;
+    pio_sm_set_consecutive_pindirs(wifi_pio, wifi_sm, SD_CMD_PIN, 1, false);
+    pio_sm_exec(wifi_pio, wifi_sm, pio_encode_jmp(picowi_pio_offset_stall));
+    io_out(SD_CS_PIN, 1);
+    return (nbytes);
+#else
+    return (wifi_data_write(func, addr, (uint8_t *)dp, nbytes));
+#endif
+}
+
 // Read data block from SPI interface
 void wifi_spi_read(uint8_t *dp, int nbits)
 {
+    PROF_SCOPE(PROF_SPI_READ);
 #if !USE_PIO
     wifi_bb_spi_read(dp, nbits);
 #else
     int rxlen = nbits / 8;
-    int reader = PIO_SPI_FREQ >= 30000000 ? picowi_pio_offset_reader : picowi_pio_offset_slow_reader;
+    int reader = wifi_spi_freq >= 30000000 ? picowi_pio_offset_reader : picowi_pio_offset_slow_reader;
     pio_sm_exec(wifi_pio, wifi_sm, pio_encode_jmp(reader));
 #if USE_PIO_DMA
     dma_channel_transfer_to_buffer_now(wifi_rx_dma_chan, dp, nbits / 8);
@@ -275,6 +349,7 @@ void wifi_spi_read(uint8_t *dp, int nbits)
 // Write data block to SPI interface
 void wifi_spi_write(uint8_t *dp, int nbits)
 {
+    PROF_SCOPE(PROF_SPI_WRITE);
 #if !USE_PIO
     wifi_bb_spi_write(dp, nbits);
 #else
@@ -312,6 +387,7 @@ bool wifi_rx_event_wait(int msec, uint8_t evt)
     return (ok);
 }
 
+#if USE_PIO
 // Initialise PIO DMA channels
 void wifi_pio_dma_init(void)
 {
@@ -335,7 +411,10 @@ void wifi_pio_dma_init(void)
     channel_config_set_dreq(&cfg, wifi_rx_dma_dreq);
     dma_channel_configure(wifi_rx_dma_chan, &cfg, NULL, &wifi_pio->rxf[wifi_sm], 8, false);
 }
+#endif
 
+// Bit-bash SPI is replaced by the chip model in a host simulation
+#if !WIFI_SIM
 // Read data from SPI interface, using bit-bash
 int wifi_bb_spi_read(uint8_t *data, int nbits)
 {
@@ -381,6 +460,7 @@ void wifi_bb_spi_write(uint8_t *data, int nbits)
     disp_bytes(DISP_SPI, start, nbits / 8);
     display(DISP_SPI, "\n");
 }
+#endif
 
 // Get state of IRQ pin
 bool wifi_get_irq(void)
@@ -20,7 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#define MAX_BLOCKLEN    64
+#define MAX_BLOCKLEN    64      // Max backplane (F1) write length
 
 #pragma pack(1)
 // Union to handle 8/16/32 bit conversions
@@ -54,8 +54,12 @@ typedef union
 int wifi_setup(void);
 int wifi_start(void);
 void wifi_pio_init(void);
+void wifi_set_spi_freq(uint32_t freq);
 int wifi_data_read(int func, int addr, uint8_t *dp, int nbytes);
+int wifi_data_read_start(int func, int addr, int nbytes);
+void wifi_data_read_end(void);
 int wifi_data_write(int func, int addr, uint8_t *dp, int nbytes);
+int wifi_data_write_block(int func, int addr, const uint8_t *dp, int nbytes);
 uint32_t wifi_reg_read(int func, uint32_t addr, int nbytes);
 int wifi_reg_write(int func, uint32_t addr, uint32_t val, int nbytes);
 void wifi_spi_read(uint8_t *dp, int nbits);
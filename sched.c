@@ -0,0 +1,105 @@
+// Event scheduler, to dispatch work posted by interrupts & the other core
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Each event has a byte-wide flag, that is set by sched_post (which may be
+// called from an interrupt, or the other core), and cleared by the core that
+// handles the event. Byte writes are atomic, so no locking is needed; the
+// flag is cleared before the handler is called, so a new post isn't lost.
+// The Send Event (SEV) instruction wakes a core that is waiting in WFE;
+// if the SEV comes just before the WFE, the latter returns immediately
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if !WICAP_HOST
+#include "hardware/sync.h"
+#endif
+#include "sched.h"
+
+volatile uint8_t sched_flags[SCHED_NUM];
+SCHED_HANDLER sched_handlers[SCHED_NUM];
+
+// Initialise scheduler
+void sched_init(void)
+{
+    for (int i = 0; i < SCHED_NUM; i++)
+    {
+        sched_flags[i] = 0;
+        sched_handlers[i] = 0;
+    }
+}
+
+// Set handler for an event
+void sched_add(SCHED_EV ev, SCHED_HANDLER fn)
+{
+    sched_handlers[ev] = fn;
+}
+
+// Post an event, waking the cores if asleep (can be called from interrupt)
+void sched_post(SCHED_EV ev)
+{
+    sched_flags[ev] = 1;
+#if !WICAP_HOST
+    __sev();
+#endif
+}
+
+// Check if any events are pending in the given range
+bool sched_pending(SCHED_EV first, SCHED_EV last)
+{
+    for (int i = (int)first; i <= (int)last; i++)
+    {
+        if (sched_flags[i])
+            return (true);
+    }
+    return (false);
+}
+
+// Dispatch pending events in given range, return number handled
+int sched_run(SCHED_EV first, SCHED_EV last)
+{
+    int n = 0;
+
+    for (int i = (int)first; i <= (int)last; i++)
+    {
+        if (sched_flags[i])
+        {
+            sched_flags[i] = 0;
+            if (sched_handlers[i])
+                sched_handlers[i]();
+            n++;
+        }
+    }
+    return (n);
+}
+
+// Sleep until an event is posted, if none pending
+// Host build doesn't sleep; the Mongoose socket poll does the waiting
+void sched_sleep(SCHED_EV first, SCHED_EV last)
+{
+#if !WICAP_HOST
+    if (!sched_pending(first, last))
+        __wfe();
+#endif
+}
+
+// EOF
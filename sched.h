@@ -0,0 +1,49 @@
+// Event scheduler, to dispatch work posted by interrupts & the other core
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Events, in order of priority. Capture core events are first, then
+// network core events; in single-core mode, one loop handles both
+typedef enum {
+    EV_CAP_MSG,         // Message from network core
+    EV_CAP_DONE,        // Capture DMA complete
+    EV_CAP_TRIG,        // Triggered capture in progress, decode new samples
+    EV_NET_MSG,         // Message from capture core
+    EV_NET_IRQ,         // WiFi chip interrupt
+    EV_NET_POLL,        // Network poll needed (data pending)
+    EV_NET_TICK,        // Network timer tick, for Mongoose & TCP timers
+    SCHED_NUM
+} SCHED_EV;
+#define EV_CAP_FIRST    EV_CAP_MSG
+#define EV_CAP_LAST     EV_CAP_TRIG
+#define EV_NET_FIRST    EV_NET_MSG
+#define EV_NET_LAST     EV_NET_TICK
+
+typedef void (*SCHED_HANDLER)(void);
+
+void sched_init(void);
+void sched_add(SCHED_EV ev, SCHED_HANDLER fn);
+void sched_post(SCHED_EV ev);
+bool sched_pending(SCHED_EV first, SCHED_EV last);
+int sched_run(SCHED_EV first, SCHED_EV last);
+void sched_sleep(SCHED_EV first, SCHED_EV last);
+
+// EOF
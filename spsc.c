@@ -0,0 +1,72 @@
+// Lock-free single-producer single-consumer queue, for inter-core messages
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The in & out values are free-running counts, so the queue can hold
+// SPSC_SIZE entries. The release store of a count makes the entry data
+// visible to the other core before the count changes; on the RP2040 this
+// compiles to a data memory barrier (DMB) around the store
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spsc.h"
+
+// Initialise queue
+void spsc_init(SPSC_QUEUE *qp)
+{
+    atomic_store(&qp->in, 0);
+    atomic_store(&qp->out, 0);
+}
+
+// Add value to queue, return 0 if full (producer only)
+bool spsc_put(SPSC_QUEUE *qp, uint32_t val)
+{
+    uint32_t in = atomic_load_explicit(&qp->in, memory_order_relaxed);
+    uint32_t out = atomic_load_explicit(&qp->out, memory_order_acquire);
+
+    if (in - out >= SPSC_SIZE)
+        return (false);
+    qp->vals[in & (SPSC_SIZE - 1)] = val;
+    atomic_store_explicit(&qp->in, in + 1, memory_order_release);
+    return (true);
+}
+
+// Get value from queue, return 0 if empty (consumer only)
+bool spsc_get(SPSC_QUEUE *qp, uint32_t *valp)
+{
+    uint32_t out = atomic_load_explicit(&qp->out, memory_order_relaxed);
+    uint32_t in = atomic_load_explicit(&qp->in, memory_order_acquire);
+
+    if (in == out)
+        return (false);
+    *valp = qp->vals[out & (SPSC_SIZE - 1)];
+    atomic_store_explicit(&qp->out, out + 1, memory_order_release);
+    return (true);
+}
+
+// Return number of values in queue (approximate if called by a 3rd party)
+int spsc_count(SPSC_QUEUE *qp)
+{
+    return ((int)(atomic_load(&qp->in) - atomic_load(&qp->out)));
+}
+
+// EOF
@@ -0,0 +1,39 @@
+// Lock-free single-producer single-consumer queue, for inter-core messages
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdatomic.h>
+
+#define SPSC_SIZE       16          // Number of entries (power of 2)
+
+// Queue of 32-bit values; the 'in' count is only written by the producer,
+// and 'out' by the consumer, so no locking is needed
+typedef struct {
+    _Atomic uint32_t in, out;
+    uint32_t vals[SPSC_SIZE];
+} SPSC_QUEUE;
+
+void spsc_init(SPSC_QUEUE *qp);
+bool spsc_put(SPSC_QUEUE *qp, uint32_t val);
+bool spsc_get(SPSC_QUEUE *qp, uint32_t *valp);
+int spsc_count(SPSC_QUEUE *qp);
+
+// EOF
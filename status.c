@@ -0,0 +1,148 @@
+// Binary status records, and table-driven JSON rendering
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The numeric parameters are copied into a fixed-layout binary record, which
+// can be served as-is to clients that poll at a high rate, or pushed over a
+// websocket when it changes. JSON is only rendered on request, using a table
+// that is built once: each entry points to a pre-formatted '"name":' string,
+// so the only work per field is a copy and an integer conversion.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "picocap.h"
+#include "status.h"
+
+// Field table entry: position of JSON name string, and value type
+typedef struct {
+    uint16_t offset;
+    uint8_t len;
+    bool is_signed;
+} STATUS_FIELD;
+
+extern SERVER_PARAM server_params[];
+
+STATUS_REC status_rec = {.magic=STATUS_MAGIC, .version=STATUS_VERSION, .nvals=STATUS_NVALS};
+STATUS_FIELD status_fields[STATUS_NVALS];
+char status_names[STATUS_NAMES_SIZE];
+int status_nfields;
+
+void status_table_init(void);
+int status_utoa(char *buff, uint32_t val);
+
+// Build table of JSON field names, from the parameter names
+void status_table_init(void)
+{
+    int i, n = 0;
+
+    for (i = 0; i < STATUS_NVALS; i++)
+    {
+        char *name = server_params[i].name;
+        int len = strlen(name) + 3;
+
+        if (n + len > STATUS_NAMES_SIZE)
+            break;
+        status_names[n] = status_names[n + len - 2] = '"';
+        memcpy(&status_names[n + 1], name, len - 3);
+        status_names[n + len - 1] = ':';
+        status_fields[i].offset = n;
+        status_fields[i].len = len;
+        status_fields[i].is_signed = server_params[i].type != ARG_STATUS_T;
+        n += len;
+    }
+    status_nfields = i;
+}
+
+// Copy parameter values into status record, return true if any have changed
+bool status_update(void)
+{
+    bool changed = false;
+
+    if (!status_nfields)
+        status_table_init();
+    for (int i = 0; i < STATUS_NVALS; i++)
+    {
+        uint32_t val = get_param_int(i);
+        changed |= val != status_rec.vals[i];
+        status_rec.vals[i] = val;
+    }
+    if (changed)
+        status_rec.seq++;
+    return (changed);
+}
+
+// Return pointer to updated status record
+STATUS_REC *status_get(void)
+{
+    status_update();
+    return (&status_rec);
+}
+
+// Convert unsigned value to decimal string (not null-terminated), return length
+int status_utoa(char *buff, uint32_t val)
+{
+    char s[10];
+    int n = 0, len;
+
+    do
+    {
+        s[n++] = '0' + val % 10;
+        val /= 10;
+    } while (val);
+    len = n;
+    while (n)
+        *buff++ = s[--n];
+    return (len);
+}
+
+// Return status as null-terminated JSON string, and its length
+int status_json(char *buff, int maxlen)
+{
+    STATUS_REC *sp = status_get();
+    int n = 0;
+
+    buff[n++] = '{';
+    for (int i = 0; i < status_nfields && n + status_fields[i].len + 14 < maxlen; i++)
+    {
+        STATUS_FIELD *fp = &status_fields[i];
+        uint32_t val = sp->vals[i];
+
+        if (i)
+            buff[n++] = ',';
+        memcpy(&buff[n], &status_names[fp->offset], fp->len);
+        n += fp->len;
+        if (fp->is_signed && (int32_t)val < 0)
+        {
+            buff[n++] = '-';
+            val = -val;
+        }
+        n += status_utoa(&buff[n], val);
+    }
+    buff[n++] = '}';
+    buff[n] = 0;
+    return (n);
+}
+
+// EOF
@@ -0,0 +1,41 @@
+// Binary status records, and table-driven JSON rendering
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define STATUS_MAGIC    "WSTA"      // Binary record marker & version
+#define STATUS_VERSION  3
+#define STATUS_NVALS    ARG_SECURITY // Number of values (all numeric parameters)
+#define STATUS_NAMES_SIZE 400       // Size of JSON name strings in field table
+
+// Binary status record, 12-byte header followed by parameter values,
+// in the same order as the parameter table
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version, nvals;
+    uint32_t seq;                   // Incremented when any value changes
+    uint32_t vals[STATUS_NVALS];
+} STATUS_REC;
+
+bool status_update(void);
+STATUS_REC *status_get(void);
+int status_json(char *buff, int maxlen);
+
+// EOF
@@ -0,0 +1,147 @@
+// Capture trigger on decoded protocol content
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Samples are captured continuously into a ring buffer, and fed into a
+// protocol decoder as they arrive. When a decoded frame matches the trigger
+// condition, the capture continues for the post-trigger number of samples,
+// then the ring is rotated so the samples are in time order, with the
+// trigger at a fixed position. The trigger is only armed when there are
+// enough samples for the pre-trigger part of the capture.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "picowi/picowi_defs.h"
+#include "decode.h"
+#include "trigger.h"
+
+// Reverse a block of samples
+static void reverse(WORD *samps, int n)
+{
+    for (int i = 0, j = n - 1; i < j; i++, j--)
+    {
+        WORD w = samps[i];
+        samps[i] = samps[j];
+        samps[j] = w;
+    }
+}
+
+// Rotate samples left by the given number
+static void rotate(WORD *samps, int n, int k)
+{
+    if (k > 0 && k < n)
+    {
+        reverse(samps, k);
+        reverse(&samps[k], n - k);
+        reverse(samps, n);
+    }
+}
+
+// Handler for decoded frames, check for trigger condition
+static void trig_frame(DECODER *dp, DECODE_FRAME *fp)
+{
+    TRIGGER *tp = (TRIGGER *)((uint8_t *)dp - offsetof(TRIGGER, dec));
+    uint64_t sample = tp->done + (int32_t)(fp->sample - dp->count);
+    uint32_t mask = tp->cfg.len >= 4 ? 0xffffffff : (1u << (tp->cfg.len * 8)) - 1;
+    bool match = false;
+
+    if (tp->cfg.type == TRIG_DATA)
+    {
+        for (int i = 0; i < fp->nbytes && !match; i++)
+        {
+            tp->match = (tp->match << 8) | fp->data[i];
+            match = (tp->match & mask) == (tp->cfg.data & mask);
+        }
+    }
+    else if (tp->cfg.type == TRIG_ADDR)
+    {
+        int addr = dp->cfg.proto == PROTO_I2C ? fp->data[0] >> 1 : fp->data[0];
+        match = fp->nbytes && !(fp->errs & DECODE_FLAG_CONT) && addr == (int)tp->cfg.data;
+    }
+    else if (tp->cfg.type == TRIG_ERROR)
+        match = (fp->errs & DECODE_ERRS) != 0;
+    if (match && !tp->triggered && sample >= tp->armed)
+    {
+        tp->trig = sample;
+        tp->triggered = true;
+    }
+}
+
+// Start triggered capture, given decoder & trigger configuration, ring
+// buffer, number of pre-samples to be discarded, number of samples to be
+// captured, and number after the trigger
+void trig_start(TRIGGER *tp, DECODE_CFG *dcp, TRIG_CFG *tcp, WORD *ring, int ringsize,
+                int pre, int nsamp, int npost)
+{
+    memset(tp, 0, sizeof(TRIGGER));
+    tp->cfg = *tcp;
+    tp->cfg.len = MAX(1, MIN(tcp->len, TRIG_MAXLEN));
+    tp->ring = ring;
+    tp->ringsize = ringsize;
+    tp->pre = pre;
+    tp->nsamp = nsamp;
+    tp->npost = MIN(npost, nsamp);
+    tp->armed = pre + nsamp - tp->npost;
+    tp->done = pre;
+    decode_init(&tp->dec, dcp, trig_frame);
+}
+
+// Decode new samples, given total number captured, return status
+// If the decoder has fallen behind, samples are skipped, and the partly-
+// decoded frame is discarded, so it can't be taken as a bus error
+TRIG_STATUS trig_poll(TRIGGER *tp, uint64_t count)
+{
+    if (count > tp->done + tp->ringsize)
+    {
+        decode_resync(&tp->dec);
+        tp->dec.count += (uint32_t)(count - tp->ringsize - tp->done);
+        tp->done = count - tp->ringsize;
+        tp->dec.prev = tp->ring[tp->done % tp->ringsize];
+    }
+    while (!tp->triggered && tp->done < count)
+    {
+        int i = (int)(tp->done % tp->ringsize);
+        int n = (int)MIN(count - tp->done, (uint64_t)(tp->ringsize - i));
+        if (tp->done == (uint64_t)tp->pre)
+            tp->dec.prev = tp->ring[i];
+        decode_samples(&tp->dec, &tp->ring[i], n);
+        tp->done += n;
+    }
+    return (tp->triggered && count >= tp->trig + tp->npost ? TRIG_STOP : TRIG_WAITING);
+}
+
+// End of triggered capture, given total number of samples captured.
+// Rotate the ring so the samples are in order, after the pre-samples.
+// Return false if samples have been overwritten
+bool trig_end(TRIGGER *tp, uint64_t count)
+{
+    uint64_t end = tp->trig + tp->npost, start = end - tp->nsamp;
+
+    if (!tp->triggered || count < end || count - start > (uint64_t)tp->ringsize)
+        return (false);
+    rotate(tp->ring, tp->ringsize, (int)((start + tp->ringsize - tp->pre) % tp->ringsize));
+    return (true);
+}
+
+// EOF
@@ -0,0 +1,58 @@
+// Capture trigger on decoded protocol content
+
+// Copyright (c) 2024, Jeremy P Bentham
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define TRIG_MAXLEN     4           // Max length of byte sequence to match
+
+// Trigger types
+typedef enum { TRIG_NONE, TRIG_DATA, TRIG_ADDR, TRIG_ERROR, NUM_TRIGS } TRIG_TYPE;
+
+// Trigger status, returned by polling
+typedef enum { TRIG_WAITING, TRIG_STOP } TRIG_STATUS;
+
+// Trigger configuration
+// TRIG_DATA: 'len' bytes of 'data' (first byte most significant) in the data
+// TRIG_ADDR: first byte of a frame (I2C: 7-bit address) equal to 'data'
+// TRIG_ERROR: any decoding error (framing, NACK, incomplete byte)
+typedef struct {
+    int type, len;
+    uint32_t data;
+} TRIG_CFG;
+
+// Trigger state, for a capture into a ring buffer
+typedef struct {
+    TRIG_CFG cfg;
+    DECODER dec;
+    WORD *ring;
+    int ringsize, nsamp, npost, pre;
+    uint64_t done;                  // Number of samples decoded
+    uint64_t armed;                 // Sample number when trigger is armed
+    uint64_t trig;                  // Sample number of trigger
+    uint32_t match;                 // Recent bytes, for sequence match
+    bool triggered;
+} TRIGGER;
+
+void trig_start(TRIGGER *tp, DECODE_CFG *dcp, TRIG_CFG *tcp, WORD *ring, int ringsize,
+                int pre, int nsamp, int npost);
+TRIG_STATUS trig_poll(TRIGGER *tp, uint64_t count);
+bool trig_end(TRIGGER *tp, uint64_t count);
+
+// EOF
@@ -50,8 +50,27 @@
 //                   Corrected state machine error handling
 // v0.24 JPB 16/7/24 Added stop command, to stop a slow capture
 // v0.25 JPB 11/8/24 Added analog sensitivity settings to display mode
+// v0.26 JPB 18/10/26 Added WiFi profile parameter, saved in flash
+//                   Added speed test file
+// v0.27 JPB 18/10/26 Added benchmark endpoints
+//                   Added hot-path profiler
+//                   Added binary event trace
+//                   Added Prometheus metrics
+// v0.28 JPB 18/10/26 Network on core 1, capture control on core 0
+//                   Event-driven main loops, using interrupts & WFE
+//                   Added capture timing & overruns to status
+//                   Added FFT spectrum
+//                   Added waveform measurements
+//                   Added protocol decoders
+//                   Added trigger on decoded data
+//                   Added analog filter & decimation
+//                   Added persistence histogram
+//                   Added mask testing
+//                   Added compressed data transfer
+//                   Added gzip encoding of text
+//                   Added binary status records & websocket
 
-#define SW_VERSION  "0.25"
+#define SW_VERSION  "0.28"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -60,16 +79,61 @@
 
 #include "picowi/picowi_defs.h"
 #include "picowi/picowi_auth.h"
-#include "mg_wifi.h"
+#if !WICAP_HOST
+#include "picowi/picowi_pico.h"
+#include "picowi/picowi_wifi.h"
+#endif
 #include "mongoose.h"
+#include "mg_wifi.h"
 #include "picocap.h"
+#include "bench.h"
+#include "metrics.h"
+#include "spsc.h"
+#include "sched.h"
+#include "fft.h"
+#include "measure.h"
+#include "decode.h"
+#include "trigger.h"
+#include "filter.h"
+#include "persist.h"
+#include "mask.h"
+#include "cmp.h"
+#include "gz.h"
+#include "status.h"
+#if DUAL_CORE
+#include "pico/multicore.h"
+#endif
+#include "picowi/picowi_prof.h"
+#include "picowi/picowi_trace.h"
 
 // Web server
+#if WICAP_HOST
+#define LISTEN_URL          "http://0.0.0.0:8080"
+#else
 #define LISTEN_URL          "http://0.0.0.0:80"
+#endif
 #define ROOT_FILENAME       "/"
 #define LA_FNAME_BASE64     "/data.txt"
 #define LA_FNAME_BIN        "/data.bin"
+#define LA_FNAME_CMP        "/data.cmp"
 #define STATUS_FILENAME     "/status.txt"
+#define STATUS_BIN_NAME     "/status.bin"
+#define SPEED_FILENAME      "/speed.bin"
+#define PROFILE_FILENAME    "/profile"
+#define TRACE_FILENAME      "/trace.bin"
+#define METRICS_FILENAME    "/metrics"
+#define SPECTRUM_FILENAME   "/spectrum.bin"
+#define MEASURE_FILENAME    "/measure.json"
+#define MEASURE_BIN_NAME    "/measure.bin"
+#define DECODE_JSON_NAME    "/decode.json"
+#define DECODE_BIN_NAME     "/decode.bin"
+#define PERSIST_FILENAME    "/persist.bin"
+#define MASK_FILENAME       "/mask.bin"
+#define MASK_JSON_NAME      "/mask.json"
+#define MASK_FAIL_NAME      "/maskfail.bin"
+#define WS_FILENAME         "/ws"
+#define SPEED_DEFAULT_LEN   1000000
+#define SPEED_MAX_LEN       4000000
 #define BASE64_SEG_SIZE     720
 #define MAX_DATALEN         ((BASE64_SEG_SIZE*4)/3)
 #define BASE64_TEXTBLOCKLEN 24
@@ -78,11 +142,30 @@
 // Timeout values in msec
 #define LINK_UP_BLINK       500
 #define LINK_DOWN_BLINK     100
+#define STATUS_TIMER_MS     50      // Mongoose timer for LED & profile check
+#define NET_TICK_MS         10      // Network poll when idle
+#define MG_POLL_MS          2       // Socket wait time (host only)
 #define JOIN_DOWN_MS        3000   
 
 // Maximum number of simultaneous TCP connections
 #define MAXCONNS            8
 
+// Websocket client is skipped if it has this much unsent data
+#define WS_SEND_MAX         4096
+
+// Number of gzip encoders (about 3K bytes each), if none free, send uncompressed
+#define GZ_NENC             1
+
+// Stack for network core
+#define CORE1_STACK_SIZE    8192
+
+// Messages between cores: type in top 8 bits, value (capture number) below
+#define MSG(type, val)      ((uint32_t)(type) << 24 | ((val) & 0xffffff))
+#define MSG_TYPE(msg)       ((msg) >> 24)
+#define MSG_VAL(msg)        ((msg) & 0xffffff)
+typedef enum { MSG_CAP_START=1, MSG_CAP_STOP, MSG_CAP_DONE, MSG_CAP_POLL,
+    MSG_MASK_LOAD, MSG_MASK_RESET, MSG_PERSIST_RESET } MSG_TYPES;
+
 // HTML header to disable client caching
 #define NO_CACHE "Cache-Control: no-cache, no-store, must-revalidate\r\nPragma: no-cache\r\nExpires: 0\r\n"
 #define ALLOW_CORS "Access-Control-Allow-Origin: *\r\n"
@@ -91,44 +174,144 @@
 // Structure to hold parameters for an open file
 typedef struct {
     uint outpos, outlen, inpos, inlen, index, millis;
-    bool inuse, base64;
+    bool inuse, base64, speed, cmp;
+    CMP_ENC enc;                    // Compressed data encoder
+    GZ_ENC *gzp;                    // Gzip encoder, null if not gzip
+    struct mg_connection *conn;     // Connection, if gzip stream
 } FILESTRUCT;
 
 FILESTRUCT filestructs[MAXCONNS];
+GZ_ENC gz_encs[GZ_NENC];
 bool force_down;
 extern struct mg_fs mg_test_fs;
 int startval;
+uint speed_len;     // Speed test length, only valid while a request is opened
 char base64_textblock[BASE64_TEXTBLOCKLEN+1];
 char version[] = "WiCap v" SW_VERSION;
 
 uint ready_ticks, led_ticks;
+uint64_t start_msec;
+struct mg_mgr mgr;
+#if !WICAP_HOST
+struct mg_tcpip_if mif = {.driver = &mg_tcpip_driver_wifi, .mgr = &mgr};
+#endif
+SPSC_QUEUE cap_queue, net_queue;    // Network to capture core, and vice-versa
+volatile uint32_t net_msg_last;     // Last message that didn't fit in net_queue
+uint32_t cap_seq;                   // Number of last capture requested
+uint32_t cap_run_seq;               // Number of capture in progress
+bool cap_active;    // Capture in progress, only used by capture core
+TRIGGER trigger;                    // Trigger on decoded data
+bool trig_active;
+int trig_pos = -1;                  // Trigger sample number, -1 if none
+bool cap_filtered;                  // Capture replaced by 16-bit filter output
+#if !WICAP_HOST
+repeating_timer_t net_tick_timer;
+#endif
+#if DUAL_CORE
+uint32_t core1_stack[CORE1_STACK_SIZE / 4];
+#endif
 char temps[TEMPS_SIZE];
 const char base64_chars[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
 extern SERVER_PARAM server_params[];
-extern WORD samples[XSAMP_MAX];
+extern WORD samples[XSAMP_MAX+XSAMP_PRE];
 
 void serial_init(void);
 void listener(struct mg_connection *c, int ev, void *ev_data);
 void web_get_params(struct mg_http_message *hm, SERVER_PARAM *args, int *cmdp);
-int json_status(char *buff, int maxlen, int typ);
 void fs_check(void);
+void metrics_update(struct mg_connection *c);
+void server_main(void);
+void event_loop(SCHED_EV first, SCHED_EV last);
+void server_init(void);
+void server_poll(void);
+bool server_busy(void);
+void status_timer(void *arg);
+void ws_push(void *hdr, int hlen, void *data, int dlen);
+void ws_push_results(void);
+#if !WICAP_HOST
+void wifi_irq_handler(uint gpio, uint32_t events);
+bool net_tick_handler(repeating_timer_t *rt);
+#endif
+void net_msg_handler(void);
+void cap_msg_put(uint32_t msg);
+void net_msg_put(uint32_t msg);
+void cap_msg_handler(void);
+void cap_done_handler(void);
+void cap_trig_handler(void);
+bool cap_trig_start(void);
+void cap_process(void);
+int cap_rate(void);
+bool decode_get_cfg(DECODE_CFG *cfgp, int rate);
+void decode_update(int rate);
 
+// Main program, not used if WiCap is built as a library (e.g. for benchmark)
+// With DUAL_CORE set, networking runs on core 1, and capture control on core 0
+#if !WICAP_LIB
 int main(void) 
 {
-    bool ledon = 0;
-    struct mg_mgr mgr;
-    struct mg_tcpip_if mif = {.driver = &mg_tcpip_driver_wifi, .mgr = &mgr};
-    
+#if !WICAP_HOST
     set_sys_clock_khz(PWM_CLOCK/1000, true);
     stdio_init_all();
+#endif
     serial_init();
+    prof_init();
+    trace_init();
+    sched_init();
+    fft_init();
     cap_init();
     cap_pout_init(PIN_SCK, get_param_int(ARG_XRATE));
+    config_load();
+    wifi_set_profile(get_param_int(ARG_PROFILE));
     //cap_start(0, 0);
     xprintf("\n%s\n", version);
     //xprintf("Flash size %u\n", flash_size());
+    spsc_init(&cap_queue);
+    spsc_init(&net_queue);
+    sched_add(EV_CAP_MSG, cap_msg_handler);
+    sched_add(EV_CAP_DONE, cap_done_handler);
+    sched_add(EV_CAP_TRIG, cap_trig_handler);
+#if DUAL_CORE
+    multicore_lockout_victim_init();
+    multicore_launch_core1_with_stack(server_main, core1_stack, sizeof(core1_stack));
+    event_loop(EV_CAP_FIRST, EV_CAP_LAST);
+#else
+    server_init();
+    event_loop(0, SCHED_NUM-1);
+#endif
+    return 0;
+}
+
+// Main program for network core
+void server_main(void)
+{
+    prof_systick_init();
+    server_init();
+    event_loop(EV_NET_FIRST, EV_NET_LAST);
+}
+
+// Dispatch events in the given range, sleep if there are none
+void event_loop(SCHED_EV first, SCHED_EV last)
+{
+    for (;;) 
+    {
+#if WICAP_HOST
+        // No interrupts, so check capture & network every time
+        sched_post(EV_CAP_DONE);
+        sched_post(EV_NET_TICK);
+#endif
+        if (!sched_run(first, last))
+            sched_sleep(first, last);
+    }
+}
+#endif
 
+// Initialise network interface & web server
+void server_init(void)
+{
+#if WICAP_HOST
+    xprintf("Host build, listening on %s\n", LISTEN_URL);
+#else
     if (get_param_int(ARG_IP_BASE))
     {
         mif.ip = mg_htonl(get_param_int(ARG_IP_BASE) + get_param_int(ARG_UNIT));
@@ -139,37 +322,373 @@ int main(void)
     }
     else
         xprintf("Using dynamic IP (DHCP)\n");
+#endif
     mg_mgr_init(&mgr);
     mg_log_set(MG_LL_NONE);
+    start_msec = mg_millis();
+#if !WICAP_HOST
     mg_tcpip_init(&mgr, &mif);
+#endif
     mg_http_listen(&mgr, LISTEN_URL, listener, &mgr);
-    //la_set_led(0);
-    for (;;) 
+    mg_timer_add(&mgr, STATUS_TIMER_MS, MG_TIMER_REPEAT, status_timer, 0);
+    sched_add(EV_NET_MSG, net_msg_handler);
+    sched_add(EV_NET_IRQ, server_poll);
+    sched_add(EV_NET_POLL, server_poll);
+    sched_add(EV_NET_TICK, server_poll);
+#if !WICAP_HOST
+    // WiFi interrupt is on this core, timer interrupt is on core 0
+    gpio_set_irq_enabled_with_callback(SD_IRQ_PIN, 
+        SD_IRQ_ASSERT ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL, true, wifi_irq_handler);
+    add_repeating_timer_ms(NET_TICK_MS, net_tick_handler, 0, &net_tick_timer);
+#endif
+    sched_post(EV_NET_POLL);
+}
+
+// Poll network interface, post another poll if there is more work to do
+void server_poll(void)
+{
+    {
+        PROF_SCOPE(PROF_MG_POLL);
+        mg_mgr_poll(&mgr, MG_POLL_MS);
+    }
+#if !WICAP_HOST
+    if (!mif.driver->up(0))
+        wifi_poll(0, 0);
+#endif
+    if (server_busy())
+        sched_post(EV_NET_POLL);
+}
+
+// Return non-zero if network has data to transfer
+bool server_busy(void)
+{
+    struct mg_connection *c;
+
+#if !WICAP_HOST
+    if (wifi_get_irq())
+        return (true);
+#endif
+    for (c = mgr.conns; c != NULL; c = c->next)
+    {
+        if (c->send.len || c->is_resp)
+            return (true);
+    }
+    return (false);
+}
+
+// Mongoose timer callback, to blink LED, check WiFi profile, and update status
+void status_timer(void *arg)
+{
+    static bool ledon;
+    static uint32_t last_pushed_seq;
+    STATUS_REC *sp;
+
+    if (mstimeout(&led_ticks, link_check() > 0 ? LINK_UP_BLINK : LINK_DOWN_BLINK))
+    {
+        wifi_set_led(ledon = !ledon);
+    }
+    if (get_param_int(ARG_PROFILE) != wifi_get_profile())
+    {
+        if (wifi_set_profile(get_param_int(ARG_PROFILE)))
+            config_save();
+        set_param_int(ARG_PROFILE, wifi_get_profile());
+    }
+    // The capture core owns the capture hardware & sample count, so ask it
+    // to update the count; the network core only reads the value
+    if (get_param_int(ARG_STATE) == STATE_CAPTURING)
+        cap_msg_put(MSG(MSG_CAP_POLL, cap_seq));
+    // HTTP requests also update the record, so check the sequence number,
+    // not just for a change since the last update
+    sp = status_get();
+    if (sp->seq != last_pushed_seq)
+    {
+        ws_push(sp, sizeof(STATUS_REC), NULL, 0);
+        last_pushed_seq = sp->seq;
+    }
+}
+
+// Send binary record to all websocket clients, as a single message
+void ws_push(void *hdr, int hlen, void *data, int dlen)
+{
+    for (struct mg_connection *c = mgr.conns; c != NULL; c = c->next)
+    {
+        if (c->is_websocket && c->send.len < WS_SEND_MAX)
+        {
+            mg_send(c, hdr, hlen);
+            if (dlen)
+                mg_send(c, data, dlen);
+            mg_ws_wrap(c, hlen + dlen, WEBSOCKET_OP_BINARY);
+        }
+    }
+}
+
+// Send measurement & decoder results to websocket clients
+void ws_push_results(void)
+{
+    MEAS_HDR mhdr;
+    MEAS_RESULT *mp;
+    DECODE_FRAME *frames;
+    DECODE_HDR dhdr = {.magic=DECODE_MAGIC, .version=DECODE_VERSION, 
+        .recsize=sizeof(DECODE_FRAME), .rate=cap_rate()};
+
+    measure_get(&mhdr, &mp);
+    ws_push(&mhdr, sizeof(mhdr), mp, sizeof(MEAS_RESULT));
+    dhdr.nframes = decode_get(&frames);
+    ws_push(&dhdr, sizeof(dhdr), frames, dhdr.nframes * sizeof(DECODE_FRAME));
+}
+
+#if !WICAP_HOST
+// Interrupt handler for WiFi chip
+void wifi_irq_handler(uint gpio, uint32_t events)
+{
+    sched_post(EV_NET_IRQ);
+}
+
+// Timer interrupt handler, for network timers
+bool net_tick_handler(repeating_timer_t *rt)
+{
+    sched_post(EV_NET_TICK);
+    return (true);
+}
+#endif
+
+// Handle a message from capture core
+static void net_msg_do(uint32_t msg)
+{
+    // Ignore completion of a capture that has been superseded
+    if (MSG_TYPE(msg) == MSG_CAP_DONE && MSG_VAL(msg) == MSG_VAL(cap_seq) &&
+        get_param_int(ARG_STATE) > STATE_READY)
+    {
+        cap_set_state(STATE_READY);
+        ws_push_results();
+    }
+}
+
+// Handle messages from capture core, including one that didn't fit in the
+// queue; it is only written by the capture core, so isn't cleared here
+void net_msg_handler(void)
+{
+    static uint32_t last_done;
+    uint32_t msg;
+
+    while (spsc_get(&net_queue, &msg))
+        net_msg_do(msg);
+    if ((msg = net_msg_last) != last_done)
+    {
+        last_done = msg;
+        net_msg_do(msg);
+    }
+}
+
+// Send message from network core to capture core
+void cap_msg_put(uint32_t msg)
+{
+    if (!spsc_put(&cap_queue, msg))
+        xprintf("Capture queue full\n");
+#if DUAL_CORE
+    // Doorbell, to wake capture core (value not used)
+    if (multicore_fifo_wready())
+        multicore_fifo_push_blocking(msg);
+#endif
+    sched_post(EV_CAP_MSG);
+}
+
+// Send message from capture core to network core
+// If the queue is full, keep the message for the network core to pick up,
+// so a capture completion isn't lost
+void net_msg_put(uint32_t msg)
+{
+    if (!spsc_put(&net_queue, msg))
+        net_msg_last = msg;
+    sched_post(EV_NET_MSG);
+}
+
+// Handle messages from network core
+void cap_msg_handler(void)
+{
+    uint32_t msg;
+
+#if DUAL_CORE
+    while (multicore_fifo_rvalid())
+        multicore_fifo_pop_blocking();
+#endif
+    while (spsc_get(&cap_queue, &msg))
     {
-        mg_mgr_poll(&mgr, 2);
-        if (mstimeout(&led_ticks, link_check() > 0 ? LINK_UP_BLINK : LINK_DOWN_BLINK))
+        if (MSG_TYPE(msg) == MSG_CAP_START)
         {
-            wifi_set_led(ledon = !ledon);
+            int n = MIN(get_param_int(ARG_XSAMP), XSAMP_MAX) + XSAMP_PRE;
+            if (trig_active)
+                cap_end();
+            if (!get_param_int(ARG_TTYPE) || !cap_trig_start())
+            {
+                trig_active = false;
+                cap_start(samples, n);
+            }
+            trig_pos = -1;
+            cap_run_seq = MSG_VAL(msg);
+            cap_active = true;
         }
-        if (get_param_int(ARG_STATE)>STATE_READY && !cap_capturing())
+        else if (MSG_TYPE(msg) == MSG_CAP_STOP)
         {
             cap_end();
-            cap_set_state(STATE_READY);
+            cap_active = trig_active = false;
+            net_msg_put(MSG(MSG_CAP_DONE, MSG_VAL(msg)));
         }
-        if (!mif.driver->up(0))
-            wifi_poll(0, 0);
+        else if (MSG_TYPE(msg) == MSG_CAP_POLL && cap_active)
+            cap_capturing();    // Update sample count
+        // Mask & persistence data are only changed by this core, between captures
+        else if (MSG_TYPE(msg) == MSG_MASK_LOAD)
+            mask_apply();
+        else if (MSG_TYPE(msg) == MSG_MASK_RESET)
+            mask_reset();
+        else if (MSG_TYPE(msg) == MSG_PERSIST_RESET)
+            persist_reset();
+    }
+}
+
+// Handle end of capture (posted by DMA interrupt)
+// Also called every loop in host build, to simulate the capture
+void cap_done_handler(void)
+{
+    if (cap_active && !trig_active && !cap_capturing())
+    {
+        cap_end();
+        cap_active = false;
+        cap_process();
+        net_msg_put(MSG(MSG_CAP_DONE, cap_run_seq));
+    }
+}
+
+// Start a triggered capture, continuously into the sample buffer
+// Return false if the decoder isn't configured, so there can't be a trigger
+bool cap_trig_start(void)
+{
+    DECODE_CFG dcfg;
+    TRIG_CFG tcfg = {.type=get_param_int(ARG_TTYPE), .len=get_param_int(ARG_TLEN),
+        .data=get_param_int(ARG_TDATA)};
+    int nsamp = MIN(get_param_int(ARG_XSAMP), TRIG_XSAMP_MAX);
+
+    if (!decode_get_cfg(&dcfg, get_param_int(ARG_XRATE)))
+        return (false);
+    trig_start(&trigger, &dcfg, &tcfg, samples, XSAMP_MAX + XSAMP_PRE, XSAMP_PRE,
+               nsamp, get_param_int(ARG_TPOST));
+    cap_ring_start(samples, XSAMP_MAX + XSAMP_PRE);
+    trig_active = true;
+    sched_post(EV_CAP_TRIG);
+    return (true);
+}
+
+// Handle triggered capture: decode new samples, end the capture when the
+// post-trigger samples have been captured. This event is re-posted while
+// the trigger is active, so the capture core doesn't sleep
+void cap_trig_handler(void)
+{
+    if (trig_active)
+    {
+        if (trig_poll(&trigger, cap_ring_count()) == TRIG_STOP)
+        {
+            cap_end();
+            cap_active = trig_active = false;
+            if (trig_end(&trigger, cap_ring_count()))
+            {
+                set_param_int(ARG_NSAMP, trigger.nsamp);
+                trig_pos = trigger.nsamp - trigger.npost;
+            }
+            else
+            {
+                set_param_int(ARG_NSAMP, 0);
+                set_param_int(ARG_TLOST, get_param_int(ARG_TLOST) + 1);
+            }
+            cap_process();
+            net_msg_put(MSG(MSG_CAP_DONE, cap_run_seq));
+        }
+        else
+            sched_post(EV_CAP_TRIG);
     }
-    return 0;
+}
+
+// Process a completed capture: update spectrum, measurements, decoded frames
+// persistence and mask test. If enabled, the analog samples are then filtered, 
+// replacing the capture, and reducing the output sample rate
+void cap_process(void)
+{
+    int rate = cap_rate();
+    {
+        PROF_SCOPE_US(PROF_FFT);
+        spectrum_update(&samples[XSAMP_PRE], get_param_int(ARG_NSAMP));
+    }
+    {
+        PROF_SCOPE_US(PROF_MEASURE);
+        measure(&samples[XSAMP_PRE], get_param_int(ARG_NSAMP), rate);
+    }
+    {
+        PROF_SCOPE_US(PROF_DECODE);
+        decode_update(rate);
+    }
+    {
+        PROF_SCOPE_US(PROF_PERSIST);
+        persist_update(&samples[XSAMP_PRE], get_param_int(ARG_NSAMP), trig_pos);
+    }
+    {
+        PROF_SCOPE_US(PROF_MASK_TEST);
+        mask_update(&samples[XSAMP_PRE], get_param_int(ARG_NSAMP), trig_pos);
+    }
+    set_param_int(ARG_ORATE, rate);
+    cap_filtered = get_param_int(ARG_FILTER) > FILT_NONE && get_param_int(ARG_FILTER) < NUM_FILTS;
+    if (cap_filtered)
+    {
+        PROF_SCOPE_US(PROF_FILTER);
+        set_param_int(ARG_NSAMP, filter_capture(&samples[XSAMP_PRE], get_param_int(ARG_NSAMP),
+            get_param_int(ARG_FILTER), get_param_int(ARG_FDEC), get_param_int(ARG_FTAPS)));
+        set_param_int(ARG_ORATE, rate / filter_dec(get_param_int(ARG_FDEC)));
+    }
+}
+
+// Return sample rate of last capture, as achieved or requested
+int cap_rate(void)
+{
+    return (get_param_int(ARG_ARATE) ? get_param_int(ARG_ARATE) : get_param_int(ARG_XRATE));
+}
+
+// Get decoder configuration from the protocol parameters, given sample rate
+// Return false if there is no protocol, or the pin numbers aren't valid
+bool decode_get_cfg(DECODE_CFG *cfgp, int rate)
+{
+    DECODE_CFG cfg = {.proto=get_param_int(ARG_DPROTO), .rate=rate,
+        .baud=get_param_int(ARG_DBAUD), .pin0=get_param_int(ARG_DPIN0),
+        .pin1=get_param_int(ARG_DPIN1), .pin2=get_param_int(ARG_DPIN2),
+        .mode=get_param_int(ARG_DMODE)};
+
+    *cfgp = cfg;
+    if (cfg.proto && !decode_cfg_valid(&cfg))
+    {
+        xprintf("Invalid decoder pins %d %d %d\n", cfg.pin0, cfg.pin1, cfg.pin2);
+        return (false);
+    }
+    return (cfg.proto != PROTO_NONE);
+}
+
+// Decode the capture, using the protocol parameters
+void decode_update(int rate)
+{
+    DECODE_CFG cfg;
+
+    decode_get_cfg(&cfg, rate);
+    decode_capture(&cfg, &samples[XSAMP_PRE], get_param_int(ARG_NSAMP));
 }
 
 // Initialise serial console interface
 // Console UART is set using compiler definition -DPICO_DEFAULT_UART=0 or 1
 void serial_init(void)
 {
+#if WICAP_HOST
+    setvbuf(stdout, NULL, _IONBF, 0);
+#else
     uart_init(UART_HW, UART_BAUD);
     gpio_set_pulls(PIN_SER_RX, 1, 0);
     gpio_set_function(PIN_SER_TX, GPIO_FUNC_UART);
     gpio_set_function(PIN_SER_RX, GPIO_FUNC_UART);
+#endif
 }
 
 // Return non-zero if timeout
@@ -199,6 +718,7 @@ int base64_enc(void *inp, int inlen, void *outp)
     int olen=0, val, n=inlen/3, extra=inlen%3;
     BYTE *ip = (BYTE *)inp;
     char *op = (char *)outp;
+    PROF_SCOPE(PROF_BASE64_ENC);
     
     while (n--)
     {
@@ -225,6 +745,7 @@ int base64_enc(void *inp, int inlen, void *outp)
     return (olen);
 }
 
+#if !WICAP_HOST
 // Return descriptive string if state has changed
 char *state_change(int state)
 {
@@ -238,6 +759,7 @@ char *state_change(int state)
     }
     return 0;
 }
+#endif
 
 // Functions providing a file-like interface for analyser data
 
@@ -271,6 +793,31 @@ static bool fs_mkdir(const char *path)
     return false;
 }
 
+// Allocate gzip encoder, return null if none free
+static GZ_ENC *gz_alloc(void)
+{
+    for (int i = 0; i < GZ_NENC; i++)
+    {
+        if (!gz_encs[i].inuse)
+        {
+            gz_encs[i].inuse = true;
+            return (&gz_encs[i]);
+        }
+    }
+    return (NULL);
+}
+
+// Compress next chunk of base64 capture data, return byte count
+static int gz_base64_next(FILESTRUCT *fptr, uint8_t *out)
+{
+    uint8_t *dp = (uint8_t *) &samples[XSAMP_PRE];
+    int inlen = MIN(GZ_CHUNK / 4 * 3, (int)(fptr->inlen - fptr->inpos));
+    int textlen = base64_enc(&dp[fptr->inpos], inlen, temps);
+
+    fptr->inpos += inlen;
+    return (gz_compress(fptr->gzp, temps, textlen, fptr->inpos >= fptr->inlen, out));
+}
+
 // Return status of logic analyser base64 file interface
 static int fs_stat_base64(const char *path, size_t *size, time_t *mtime)
 {
@@ -283,7 +830,7 @@ static int fs_stat_base64(const char *path, size_t *size, time_t *mtime)
     }
     if (mtime)
         *mtime = t++;
-    return (get_param_int(ARG_NSAMP) * 2);
+    return (get_param_int(ARG_NSAMP) ? MG_FS_READ : 0);
 }
 
 // Return status of logic analyser binary file interface
@@ -297,22 +844,67 @@ static int fs_stat_bin(const char *path, size_t *size, time_t *mtime)
     }
     if (mtime)
         *mtime = t++;
-    return (get_param_int(ARG_NSAMP) * 2);
+    return (get_param_int(ARG_NSAMP) ? MG_FS_READ : 0);
 }
 
-// Start analyser file transfer, binary mode
-static void *fs_open_bin(const char *path, int flags) 
+// Return size of compressed capture data, and coding mode if non-null
+// using previous values if unchanged
+static int cmp_data_len(int *flagsp)
+{
+    static uint32_t last_seq;
+    static int last_nsamp = -1, last_len, last_flags;
+    int nsamp = get_param_int(ARG_NSAMP);
+
+    if (nsamp != last_nsamp || cap_seq != last_seq)
+    {
+        last_flags = cmp_mode(&samples[XSAMP_PRE], nsamp, cap_filtered ? CMP_WIDE : 0);
+        last_len = cmp_size(&samples[XSAMP_PRE], nsamp, last_flags);
+        last_nsamp = nsamp;
+        last_seq = cap_seq;
+    }
+    if (flagsp)
+        *flagsp = last_flags;
+    return (last_len);
+}
+
+// Return status of compressed data file interface
+static int fs_stat_cmp(const char *path, size_t *size, time_t *mtime)
+{
+    static time_t t = 0;
+    int len = cmp_data_len(NULL);
+    if (size)
+    {
+        *size = len;
+        xprintf("Stat  file %s size %u\n", path, *size);
+    }
+    if (mtime)
+        *mtime = t++;
+    return (len ? MG_FS_READ : 0);
+}
+
+// Return status of speed test file interface
+static int fs_stat_speed(const char *path, size_t *size, time_t *mtime)
+{
+    static time_t t = 0;
+    if (size)
+        *size = speed_len;
+    if (mtime)
+        *mtime = t++;
+    return (speed_len);
+}
+
+// Allocate file structure, return null if none free
+static FILESTRUCT *fs_new(const char *path)
 {
-    (void) flags;
-    if (strstr(path, ".gz"))
-        return NULL;
     for (int i = 0; i < MAXCONNS; i++)
     {
         if (!filestructs[i].inuse) 
         {
             FILESTRUCT *fptr = &filestructs[i];
             fptr->inuse = true;
-            fptr->base64 = false;            
+            fptr->base64 = fptr->speed = fptr->cmp = false;
+            fptr->gzp = NULL;
+            fptr->conn = NULL;
             fptr->outlen = fptr->inlen = get_param_int(ARG_NSAMP) * 2;
             fptr->outpos = fptr->inpos = 0;
             fptr->index = i;
@@ -324,7 +916,17 @@ static void *fs_open_bin(const char *path, int flags)
     return(NULL);
 }
 
+// Start analyser file transfer, binary mode
+static void *fs_open_bin(const char *path, int flags) 
+{
+    (void) flags;
+    if (strstr(path, ".gz"))
+        return NULL;
+    return (fs_new(path));
+}
+
 // Start analyser file transfer, base64 mode
+// Gzip encoding is done by a separate stream, so a '.gz' path isn't opened
 static void *fs_open_base64(const char *path, int flags) 
 {
     FILESTRUCT *fptr = (FILESTRUCT *)fs_open_bin(path, flags);
@@ -337,6 +939,34 @@ static void *fs_open_base64(const char *path, int flags)
     return (void *)fptr;
 }
 
+// Start analyser file transfer, compressed mode
+static void *fs_open_cmp(const char *path, int flags) 
+{
+    FILESTRUCT *fptr = (FILESTRUCT *)fs_open_bin(path, flags);
+    int mode;
+    
+    if (fptr)
+    {
+        fptr->outlen = cmp_data_len(&mode);
+        fptr->cmp = 1;
+        cmp_init(&fptr->enc, &samples[XSAMP_PRE], get_param_int(ARG_NSAMP), mode);
+    }
+    return (void *)fptr;
+}
+
+// Start speed test file transfer
+static void *fs_open_speed(const char *path, int flags) 
+{
+    FILESTRUCT *fptr = (FILESTRUCT *)fs_open_bin(path, flags);
+    
+    if (fptr)
+    {
+        fptr->outlen = fptr->inlen = speed_len;
+        fptr->speed = 1;
+    }
+    return (void *)fptr;
+}
+
 // Close file
 static void fs_close(void *fp) 
 {
@@ -346,11 +976,36 @@ static void fs_close(void *fp)
     uint speed = dt ? (fptr->outlen * 1000) / dt : 0;
     xprintf("Close file %u, %u msec, %u of %u bytes, %u bytes/sec\n", 
         fptr->index, dt, fptr->outpos, fptr->outlen, speed);
+    if (fptr->speed && fptr->outpos >= fptr->outlen)
+        set_param_int(ARG_SPEED, speed);
     fptr->outpos = fptr->outlen = fptr->inuse = 0;
+    if (fptr->gzp)
+        fptr->gzp->inuse = false;
+    fptr->gzp = NULL;
     base64_textblock[0] = 0;
     startval += XSAMP_DEFAULT / 100;
 }
 
+// Update the metric values that aren't counted as they occur
+void metrics_update(struct mg_connection *c)
+{
+    int n = 0;
+#if !WICAP_HOST
+    struct mg_tcpip_if *ifp = c->mgr->priv;
+
+    METRIC_SET(METRIC_RX_FRAMES, ifp->nrecv);
+    METRIC_SET(METRIC_TX_FRAMES, ifp->nsent);
+    METRIC_SET(METRIC_DROP_FRAMES, ifp->ndrop);
+    METRIC_SET(METRIC_NET_ERRORS, ifp->nerr);
+#endif
+    for (int i = 0; i < MAXCONNS; i++)
+        n += filestructs[i].inuse;
+    METRIC_SET(METRIC_TRANSFERS, n);
+    METRIC_SET(METRIC_UPTIME, (mg_millis() - start_msec) / 1000);
+    METRIC_SET(METRIC_LINK_UP, link_check());
+    METRIC_SET(METRIC_JOIN_RETRIES, join_retries());
+}
+
 // Check for old (unused) file pointers
 void fs_check(void) 
 {
@@ -360,6 +1015,9 @@ void fs_check(void)
         if (fptr->inuse && mg_millis() - fptr->millis > 30000) 
         {
             fptr->outpos = fptr->outlen = fptr->inuse = 0;
+            if (fptr->gzp)
+                fptr->gzp->inuse = false;
+            fptr->gzp = NULL;
             xprintf("Closing unused file transfer\n");
         }
     }
@@ -380,6 +1038,7 @@ static size_t fs_read_base64(void *fd, void *buf, size_t length)
 {
     FILESTRUCT *fptr = fd;
     int outlen = 0, end = (fptr->outpos + length >= fptr->outlen);
+    PROF_SCOPE(PROF_FS_BASE64);
     
     if (length && length < BASE64_TEXTBLOCKLEN && !base64_textblock[0])
     {
@@ -407,6 +1066,7 @@ static size_t fs_read_base64(void *fd, void *buf, size_t length)
 #if DISP_BLOCKS    
     xprintf("Read  file %u req %4d dlen %4d pos %d len %d\n", fptr->index, length, outlen, fptr->outpos, fptr->len);
 #endif    
+    METRIC_ADD(METRIC_BYTES_BASE64, outlen);
     fptr->outpos += outlen;
     return(outlen);
 }
@@ -416,12 +1076,43 @@ static size_t fs_read_bin(void *fd, void *buf, size_t length)
 {
     FILESTRUCT *fptr = fd;
     int outlen = MIN(fptr->outlen - fptr->outpos, length);
+    PROF_SCOPE(PROF_FS_BIN);
     
     fs_bin_data(fptr, buf, outlen);
 #if DISP_BLOCKS    
     xprintf("Read  file %u req %4d dlen %4d pos %d len %d\n", 
         fptr->index, length, outlen, fptr->outpos, fptr->len);
 #endif
+    METRIC_ADD(METRIC_BYTES_BIN, outlen);
+    fptr->inpos += outlen;
+    fptr->outpos += outlen;
+    return (outlen);
+}
+
+// Read data stream, returning compressed data
+static size_t fs_read_cmp(void *fd, void *buf, size_t length) 
+{
+    FILESTRUCT *fptr = fd;
+    int outlen;
+    PROF_SCOPE(PROF_FS_CMP);
+    
+    outlen = cmp_read(&fptr->enc, buf, MIN(fptr->outlen - fptr->outpos, length));
+    METRIC_ADD(METRIC_BYTES_CMP, outlen);
+    fptr->inpos = fptr->enc.inpos * 2;
+    fptr->outpos += outlen;
+    return (outlen);
+}
+
+// Read speed test data stream, repeating the sample buffer contents
+static size_t fs_read_speed(void *fd, void *buf, size_t length) 
+{
+    FILESTRUCT *fptr = fd;
+    uint oset = fptr->outpos % sizeof(samples);
+    int outlen = MIN(fptr->outlen - fptr->outpos, length);
+    
+    outlen = MIN(outlen, (int)(sizeof(samples) - oset));
+    memcpy(buf, (uint8_t *)samples + oset, outlen);
+    METRIC_ADD(METRIC_BYTES_SPEED, outlen);
     fptr->inpos += outlen;
     fptr->outpos += outlen;
     return (outlen);
@@ -451,15 +1142,130 @@ struct mg_fs mg_fs_bin =
     fs_write,  fs_seek, fs_rename, fs_remove, fs_mkdir
  };
 
+// Pointers to logic analyser compressed file functions
+struct mg_fs mg_fs_cmp = 
+{
+    fs_stat_cmp,  fs_list,  fs_open_cmp,  fs_close, fs_read_cmp,
+    fs_write,  fs_seek, fs_rename, fs_remove, fs_mkdir
+ };
+
+// Pointers to speed test file functions
+struct mg_fs mg_fs_speed = 
+{
+    fs_stat_speed,  fs_list,  fs_open_speed,  fs_close, fs_read_speed,
+    fs_write,  fs_seek, fs_rename, fs_remove, fs_mkdir
+ };
+
+// Return true if client accepts gzip encoding
+static bool gz_accepted(struct mg_http_message *hm)
+{
+    struct mg_str *ae = mg_http_get_header(hm, "Accept-Encoding");
+    
+    return (ae && mg_match(*ae, mg_str("*gzip*"), NULL));
+}
+
+// Send text reply, gzip-encoded if the client accepts it, and an encoder is free
+static void gz_reply(struct mg_connection *c, struct mg_http_message *hm, 
+                     const char *headers, char *text, int len)
+{
+    GZ_ENC *gzp = gz_accepted(hm) ? gz_alloc() : NULL;
+    int pos = 0;
+    
+    if (!gzp)
+    {
+        mg_http_reply(c, 200, headers, "%.*s", len, text);
+        return;
+    }
+    mg_printf(c, "HTTP/1.1 200 OK\r\n%sContent-Encoding: gzip\r\nContent-Length: %d\r\n\r\n",
+        headers, gz_size(gzp, GZ_FIXED, text, len));
+    do
+    {
+        int chunk = MIN(len - pos, GZ_CHUNK), n;
+        n = gz_compress(gzp, &text[pos], chunk, pos + chunk >= len, gzp->out);
+        mg_send(c, gzp->out, n);
+        METRIC_ADD(METRIC_BYTES_GZIP, n);
+        pos += chunk;
+    } while (pos < len);
+    gzp->inuse = false;
+}
+
+// Top up the send buffer with gzip-encoded data, close file when complete
+static void gz_stream_send(FILESTRUCT *fptr)
+{
+    struct mg_connection *c = fptr->conn;
+    GZ_ENC *gzp = fptr->gzp;
+    PROF_SCOPE(PROF_GZ_SEND);
+
+    while (c->send.len < MG_IO_SIZE && fptr->inuse)
+    {
+        int n = gz_base64_next(fptr, gzp->out);
+        if (n > 0)
+            mg_http_write_chunk(c, (char *)gzp->out, n);
+        METRIC_ADD(METRIC_BYTES_GZIP, n);
+        fptr->outpos += n;
+        if (fptr->inpos >= fptr->inlen)
+        {
+            mg_http_write_chunk(c, "", 0);
+            fptr->outlen = fptr->outpos;
+            fs_close(fptr);
+            c->is_draining = 1;
+        }
+    }
+}
+
+// Start gzip-encoded base64 capture data, using chunked encoding, as the
+// compressed length isn't known in advance. Return false if no encoder free
+static bool gz_stream_start(struct mg_connection *c)
+{
+    GZ_ENC *gzp = gz_alloc();
+    FILESTRUCT *fptr = gzp ? fs_new(LA_FNAME_BASE64 ".gz") : NULL;
+
+    if (!fptr)
+    {
+        if (gzp)
+            gzp->inuse = false;
+        return (false);
+    }
+    fptr->base64 = 1;
+    fptr->gzp = gzp;
+    fptr->conn = c;
+    gz_init(gzp, GZ_BASE64);
+    mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS TEXT_PLAIN 
+        "Content-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n");
+    gz_stream_send(fptr);
+    return (true);
+}
+
+// Handle gzip stream connection events
+static void gz_stream_event(struct mg_connection *c, int ev)
+{
+    for (int i = 0; i < MAXCONNS; i++)
+    {
+        FILESTRUCT *fptr = &filestructs[i];
+        if (fptr->inuse && fptr->conn == c)
+        {
+            if (ev == MG_EV_POLL || ev == MG_EV_WRITE)
+                gz_stream_send(fptr);
+            else if (ev == MG_EV_CLOSE)
+                fs_close(fptr);
+        }
+    }
+}
+
 // Connection callback
 //void listener(struct mg_connection *c, int ev, void *ev_data, void *fn_data)
 void listener(struct mg_connection *c, int ev, void *ev_data)
 {
+#if !WICAP_HOST
     struct mg_mgr *mgrp = c->mgr;
     //struct mg_mgr *mgrp = (struct mg_mgr *)fn_data;
     struct mg_tcpip_if *ifp = mgrp->priv;
+#endif
     struct mg_http_serve_opts opts = {.extra_headers = NO_CACHE ALLOW_CORS};
 
+    if (bench_event(c, ev, ev_data))
+        return;
+    gz_stream_event(c, ev);
     if (ev == MG_EV_HTTP_MSG) 
     {
         struct mg_http_message *hm = (struct mg_http_message *) ev_data;
@@ -476,16 +1282,18 @@ void listener(struct mg_connection *c, int ev, void *ev_data)
             xprintf("Command %d\n", cmd);
             if (cmd == CMD_SINGLE || cmd == CMD_MULTI)
             {
+                METRIC_ADD(METRIC_CAPTURES, 1);
+                if (get_param_int(ARG_STATE) == STATE_CAPTURING)
+                    METRIC_ADD(METRIC_RESTARTS, 1);
                 cap_set_state(STATE_CAPTURING);
-                int n = MIN(get_param_int(ARG_XSAMP), XSAMP_MAX) + XSAMP_PRE;
-                cap_start(samples, n);
+                cap_msg_put(MSG(MSG_CAP_START, ++cap_seq));
             }
             if (cmd == CMD_SINGLE)
                 set_param_int(ARG_CMD, 0);
             else if (cmd == CMD_STOP)
             {
                 cap_set_state(STATE_ERROR);
-                cap_end();
+                cap_msg_put(MSG(MSG_CAP_STOP, cap_seq));
             }
         }
         if (mg_match(hm->uri, mg_str(ROOT_FILENAME), NULL))
@@ -494,12 +1302,25 @@ void listener(struct mg_connection *c, int ev, void *ev_data)
         }
         else if (mg_match(hm->uri, mg_str(STATUS_FILENAME), NULL))
         {
-            json_status(temps, sizeof(temps) - 1, 0);
+            len = status_json(temps, sizeof(temps));
             //xprintf("%s\n", temps);
-            mg_http_reply(c, 200, NO_CACHE ALLOW_CORS, "%s", temps); 
+            gz_reply(c, hm, NO_CACHE ALLOW_CORS, temps, len);
+        }
+        else if (mg_match(hm->uri, mg_str(STATUS_BIN_NAME), NULL))
+        {
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", 
+                (int)sizeof(STATUS_REC));
+            mg_send(c, status_get(), sizeof(STATUS_REC));
+        }
+        else if (mg_match(hm->uri, mg_str(WS_FILENAME), NULL))
+        {
+            mg_ws_upgrade(c, hm, NULL);
         }
         else if (mg_match(hm->uri, mg_str(LA_FNAME_BASE64), NULL))
         {
+            if (gz_accepted(hm) && gz_stream_start(c))
+                return;
             opts.fs = &mg_fs_base64;
             mg_http_serve_dir(c, hm, &opts);
             c->is_draining = 1;
@@ -510,11 +1331,185 @@ void listener(struct mg_connection *c, int ev, void *ev_data)
             mg_http_serve_dir(c, hm, &opts);
             c->is_draining = 1;
         }
+        else if (mg_match(hm->uri, mg_str(LA_FNAME_CMP), NULL))
+        {
+            opts.fs = &mg_fs_cmp;
+            opts.mime_types = "cmp=application/octet-stream";
+            mg_http_serve_dir(c, hm, &opts);
+            c->is_draining = 1;
+        }
+        else if (mg_match(hm->uri, mg_str(SPEED_FILENAME), NULL))
+        {
+            // Length is set for each request, and copied by the file open
+            speed_len = SPEED_DEFAULT_LEN;
+            if (mg_http_get_var(&hm->query, "size", temps, sizeof(temps)) > 0)
+                speed_len = MIN(strtoul(temps, NULL, 10), SPEED_MAX_LEN);
+            opts.fs = &mg_fs_speed;
+            mg_http_serve_dir(c, hm, &opts);
+            c->is_draining = 1;
+        }
+        else if (mg_match(hm->uri, mg_str(METRICS_FILENAME), NULL))
+        {
+            int len;
+            char *s;
+            metrics_update(c);
+            s = metrics_render(&len);
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE 
+                "Content-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\n\r\n", len);
+            mg_send(c, s, len);
+        }
+#if PROF_ENABLE
+        else if (mg_match(hm->uri, mg_str(PROFILE_FILENAME), NULL))
+        {
+            char s[8];
+            prof_json(temps, sizeof(temps) - 1);
+            if (mg_http_get_var(&hm->query, "reset", s, sizeof(s)) > 0)
+                prof_reset();
+            mg_http_reply(c, 200, NO_CACHE ALLOW_CORS, "%s", temps); 
+        }
+#endif
+        else if (mg_match(hm->uri, mg_str(MEASURE_FILENAME), NULL))
+        {
+            len = measure_json(temps, sizeof(temps));
+            gz_reply(c, hm, NO_CACHE ALLOW_CORS "Content-Type: application/json\r\n", temps, len);
+        }
+        else if (mg_match(hm->uri, mg_str(MEASURE_BIN_NAME), NULL))
+        {
+            MEAS_HDR hdr;
+            MEAS_RESULT *mp;
+            int len = measure_get(&hdr, &mp);
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", len);
+            mg_send(c, &hdr, sizeof(hdr));
+            mg_send(c, mp, sizeof(MEAS_RESULT));
+        }
+        else if (mg_match(hm->uri, mg_str(DECODE_JSON_NAME), NULL))
+        {
+            DECODE_FRAME *frames;
+            int nframes = decode_get(&frames);
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n");
+            mg_http_printf_chunk(c, "{\"proto\":\"%s\",\"rate\":%u,\"nframes\":%d,\"frames\":[",
+                decode_proto_name(get_param_int(ARG_DPROTO)), cap_rate(), nframes);
+            for (int i = 0; i < nframes; i++)
+            {
+                char hex[DECODE_MAXBYTES * 2 + 1] = "";
+                for (int n = 0; n < frames[i].nbytes; n++)
+                    sprintf(&hex[n * 2], "%02x", frames[i].data[n]);
+                mg_http_printf_chunk(c, "%s{\"t\":%u,\"ch\":%u,\"d\":\"%s\",\"e\":%u}",
+                    i ? "," : "", frames[i].sample, frames[i].chan, hex, frames[i].errs);
+            }
+            mg_http_printf_chunk(c, "]}");
+            mg_http_write_chunk(c, "", 0);
+        }
+        else if (mg_match(hm->uri, mg_str(DECODE_BIN_NAME), NULL))
+        {
+            DECODE_FRAME *frames;
+            DECODE_HDR hdr = {.magic=DECODE_MAGIC, .version=DECODE_VERSION, 
+                .recsize=sizeof(DECODE_FRAME), .rate=cap_rate()};
+            hdr.nframes = decode_get(&frames);
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", 
+                (int)(sizeof(hdr) + hdr.nframes * sizeof(DECODE_FRAME)));
+            mg_send(c, &hdr, sizeof(hdr));
+            mg_send(c, frames, hdr.nframes * sizeof(DECODE_FRAME));
+        }
+        else if (mg_match(hm->uri, mg_str(PERSIST_FILENAME), NULL))
+        {
+            PERSIST_HDR hdr;
+            uint16_t *counts;
+            int len = persist_get(&hdr, &counts);
+            char s[8];
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", len);
+            mg_send(c, &hdr, sizeof(hdr));
+            mg_send(c, counts, len - sizeof(hdr));
+            if (mg_http_get_var(&hm->query, "reset", s, sizeof(s)) > 0)
+                cap_msg_put(MSG(MSG_PERSIST_RESET, 0));
+        }
+        else if (mg_match(hm->uri, mg_str(MASK_FILENAME), NULL))
+        {
+            MASK_HDR hdr;
+            uint16_t *bounds;
+            int len;
+            if (hm->body.len > 0)
+            {
+                bool ok = mask_set(hm->body.buf, hm->body.len);
+                if (ok)
+                    cap_msg_put(MSG(MSG_MASK_LOAD, 0));
+                mg_http_reply(c, ok ? 200 : 400, TEXT_PLAIN ALLOW_CORS,
+                    ok ? "OK\n" : "Invalid mask, or load pending\n");
+            }
+            else
+            {
+                len = mask_get(&hdr, &bounds);
+                mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                    "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", len);
+                mg_send(c, &hdr, sizeof(hdr));
+                mg_send(c, bounds, len - sizeof(hdr));
+            }
+        }
+        else if (mg_match(hm->uri, mg_str(MASK_JSON_NAME), NULL))
+        {
+            char s[8];
+            len = mask_json(temps, sizeof(temps));
+            gz_reply(c, hm, NO_CACHE ALLOW_CORS "Content-Type: application/json\r\n", temps, len);
+            if (mg_http_get_var(&hm->query, "reset", s, sizeof(s)) > 0)
+                cap_msg_put(MSG(MSG_MASK_RESET, 0));
+        }
+        else if (mg_match(hm->uri, mg_str(MASK_FAIL_NAME), NULL))
+        {
+            MASK_HDR hdr;
+            MASK_FAIL *fails;
+            WORD *samps;
+            int len = mask_fails(&hdr, &fails, &samps);
+            char s[8];
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", len);
+            mg_send(c, &hdr, sizeof(hdr));
+            mg_send(c, fails, hdr.nfails * sizeof(MASK_FAIL));
+            mg_send(c, samps, hdr.nfails * hdr.npts * sizeof(WORD));
+            if (mg_http_get_var(&hm->query, "reset", s, sizeof(s)) > 0)
+                cap_msg_put(MSG(MSG_MASK_RESET, 0));
+        }
+        else if (mg_match(hm->uri, mg_str(SPECTRUM_FILENAME), NULL))
+        {
+            uint16_t *mags;
+            int nbins = spectrum_get(&mags);
+            char s[8];
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", nbins * 2);
+            mg_send(c, mags, nbins * 2);
+            if (mg_http_get_var(&hm->query, "reset", s, sizeof(s)) > 0)
+                spectrum_reset();
+        }
+#if TRACE_ENABLE
+        else if (mg_match(hm->uri, mg_str(TRACE_FILENAME), NULL))
+        {
+            TRACE_HDR hdr;
+            TRACE_REC *recs1, *recs2;
+            int n1, n2, len = trace_get(&hdr, &recs1, &n1, &recs2, &n2);
+            char s[8];
+            mg_printf(c, "HTTP/1.1 200 OK\r\n" NO_CACHE ALLOW_CORS 
+                "Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n", len);
+            mg_send(c, &hdr, sizeof(hdr));
+            mg_send(c, recs1, n1 * sizeof(TRACE_REC));
+            mg_send(c, recs2, n2 * sizeof(TRACE_REC));
+            if (mg_http_get_var(&hm->query, "reset", s, sizeof(s)) > 0)
+                trace_reset();
+        }
+#endif
         else 
         {
             mg_http_reply(c, 404, "", "Not Found\n");
         }
     }
+    else if (ev == MG_EV_WS_OPEN || ev == MG_EV_WS_MSG)
+    {
+        // Send status on connection, or when polled by client
+        mg_ws_send(c, status_get(), sizeof(STATUS_REC), WEBSOCKET_OP_BINARY);
+    }
+#if !WICAP_HOST
     else 
     {
         char *s = state_change(ifp->state);
@@ -529,6 +1524,14 @@ void listener(struct mg_connection *c, int ev, void *ev_data)
         else if (ifp->state != MG_TCPIP_STATE_READY && mstimeout(&ready_ticks, JOIN_DOWN_MS))
             force_down = !force_down;
     }
+#endif
+}
+
+// Convert parameter value, hex if it has a 0x prefix, otherwise decimal
+// (not octal, so leading zeros are ignored)
+static int web_param_val(const char *s)
+{
+    return (strtol(s, NULL, s[0] == '0' && (s[1] == 'x' || s[1] == 'X') ? 16 : 10));
 }
 
 // Get HTTP query parameter values, including a command value (if present)
@@ -538,7 +1541,7 @@ void web_get_params(struct mg_http_message *hm, SERVER_PARAM *args, int *cmdp)
     {
         if (args->type==ARG_VAL_T && 
             mg_http_get_var(&hm->query, args->name, temps, sizeof(temps)) > 0)
-            args->val = strtol(temps, NULL, 10);
+            args->val = web_param_val(temps);
         else if (args->type == ARG_CMD_T && cmdp &&
             mg_http_get_var(&hm->query, args->name, temps, sizeof(temps)) > 0)
             *cmdp = args->val = strtol(temps, NULL, 10);
@@ -546,25 +1549,11 @@ void web_get_params(struct mg_http_message *hm, SERVER_PARAM *args, int *cmdp)
     }
 }
 
-// Return server status as json string
-int json_status(char *buff, int maxlen, int typ) 
-{
-    SERVER_PARAM *arg = server_params;
-    int i = 0, n = sprintf(buff, "{");
-    
-    while (arg[i].name[0] && n < maxlen - 20)
-    {
-        if ((typ == 0 && i < ARG_SECURITY) || arg[i].type == typ)
-            n += sprintf(&buff[n], "%s\"%s\":%d", n > 2 ? "," : "", 
-                arg[i].name, arg[i].val);
-        i++;
-    }
-    return (n += sprintf(&buff[n], "}"));
-}
-
+#if !WICAP_HOST
 int mkdir(const char *s, mode_t m)
 {
     return 0;
 }
+#endif
 
 // EOF
\ No newline at end of file